@@ -0,0 +1,75 @@
+// Copyright 2026 Rik Essenius
+// 
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file
+// except in compliance with the License. You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#include <gtest/gtest.h>
+#include <thread>
+#include "../esp32-mock/BytePipe.h"
+
+namespace esp32_mock_test {
+	TEST(BytePipeTest, WriteReadTest) {
+		BytePipe pipe(10);
+		EXPECT_EQ(pipe.capacity(), 16u) << "Capacity rounded up to a power of two";
+		uint8_t buffer[32] = {};
+		EXPECT_EQ(pipe.read(buffer, sizeof buffer), 0u) << "Nothing to read";
+		const uint8_t data[] = "abcdefghijklmnopqrstuvwxyz";
+		EXPECT_EQ(pipe.write(data, 12), 12u) << "Wrote 12";
+		EXPECT_EQ(pipe.read(buffer, 8), 8u) << "Read 8";
+		EXPECT_EQ(memcmp(buffer, "abcdefgh", 8), 0) << "Read the front";
+		EXPECT_EQ(pipe.write(data + 12, 14), 12u) << "Only 12 fit";
+		EXPECT_EQ(pipe.droppedBytes(), 2u) << "2 bytes lost";
+		EXPECT_EQ(pipe.size(), 16u) << "Pipe full";
+		EXPECT_EQ(pipe.read(buffer, sizeof buffer), 16u) << "Read across the wrap";
+		EXPECT_EQ(memcmp(buffer, "ijklmnopqrstuvwx", 16), 0) << "Data intact";
+		EXPECT_EQ(pipe.size(), 0u) << "Pipe empty";
+	}
+
+	TEST(BytePipeTest, SinkSourceTest) {
+		BytePipe pipe;
+		pipe.sink().write("hello", 5);
+		pipe.sink().flush();
+		uint8_t buffer[10] = {};
+		EXPECT_EQ(pipe.source().read(buffer, sizeof buffer), 5u) << "Read what the sink wrote";
+		EXPECT_EQ(memcmp(buffer, "hello", 5), 0) << "Data intact";
+	}
+
+	TEST(BytePipeTest, ThreadTest) {
+		constexpr size_t kTotal = 8 * 1024 * 1024;
+		BytePipe pipe(4096);
+		std::thread writer([&pipe] {
+			uint8_t chunk[1000];
+			size_t sent = 0;
+			while (sent < kTotal) {
+				const size_t length = std::min(sizeof chunk, kTotal - sent);
+				for (size_t i = 0; i < length; i++) chunk[i] = static_cast<uint8_t>((sent + i) % 251);
+				// only write what fits, so nothing gets lost
+				const size_t room = pipe.capacity() - pipe.size();
+				const size_t written = pipe.write(chunk, std::min(length, room));
+				sent += written;
+				if (written == 0) std::this_thread::yield();
+			}
+		});
+		uint8_t buffer[1500];
+		size_t received = 0;
+		size_t mismatches = 0;
+		while (received < kTotal) {
+			const size_t length = pipe.read(buffer, sizeof buffer);
+			for (size_t i = 0; i < length; i++) {
+				if (buffer[i] != static_cast<uint8_t>((received + i) % 251)) mismatches++;
+			}
+			received += length;
+			if (length == 0) std::this_thread::yield();
+		}
+		writer.join();
+		EXPECT_EQ(received, kTotal) << "Received everything";
+		EXPECT_EQ(mismatches, 0u) << "In order and intact";
+		EXPECT_EQ(pipe.droppedBytes(), 0u) << "Nothing lost";
+	}
+}
@@ -0,0 +1,73 @@
+// Copyright 2026 Rik Essenius
+// 
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file
+// except in compliance with the License. You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#include <gtest/gtest.h>
+#include "../esp32-mock/ByteRing.h"
+
+namespace esp32_mock_test {
+	TEST(ByteRingTest, PushPopTest) {
+		ByteRing ring;
+		EXPECT_TRUE(ring.empty()) << "Empty at start";
+		EXPECT_EQ(ring.peek(), -1) << "Nothing to peek";
+		EXPECT_EQ(ring.find('a'), ByteRing::npos) << "Nothing to find";
+		const uint8_t data[] = "abcdefghij";
+		ring.push(data, 10);
+		EXPECT_EQ(ring.size(), 10u) << "Size after push";
+		EXPECT_EQ(ring.capacity(), 64u) << "Minimum capacity";
+		uint8_t buffer[100] = {};
+		EXPECT_EQ(ring.pop(buffer, 4), 4u) << "Popped 4";
+		EXPECT_EQ(memcmp(buffer, "abcd", 4), 0) << "Popped the front";
+		EXPECT_EQ(ring.peek(), 'e') << "Peek next";
+		EXPECT_EQ(ring.discard(2), 2u) << "Discarded 2";
+		EXPECT_EQ(ring.find('i'), 2u) << "Found i";
+		EXPECT_EQ(ring.find('i', 2), ByteRing::npos) << "i beyond limit";
+		EXPECT_EQ(ring.peek(buffer, 3, 1), 3u) << "Peeked 3 at offset 1";
+		EXPECT_EQ(memcmp(buffer, "hij", 3), 0) << "Peeked without removing";
+		EXPECT_EQ(ring.peek(buffer, 3, 4), 0u) << "Nothing to peek beyond the end";
+		EXPECT_EQ(ring.pop(buffer, 100), 4u) << "Popped the rest";
+		EXPECT_TRUE(ring.empty()) << "Empty again";
+	}
+
+	TEST(ByteRingTest, WrapAndGrowTest) {
+		ByteRing ring;
+		uint8_t data[48];
+		for (uint8_t i = 0; i < sizeof data; i++) data[i] = i;
+		ring.push(data, 48);
+		uint8_t buffer[200] = {};
+		ring.pop(buffer, 40);
+		ring.push(data, 48);
+		EXPECT_EQ(ring.capacity(), 64u) << "Wrapped without growing";
+		EXPECT_EQ(ring.find(20), 8u + 20u) << "Found in the wrapped segment";
+		EXPECT_EQ(ring.find(20, 28), ByteRing::npos) << "Limit applies to the wrapped segment";
+		ring.push(data, 48);
+		EXPECT_EQ(ring.capacity(), 128u) << "Grew";
+		EXPECT_EQ(ring.size(), 104u) << "Size after growing";
+		EXPECT_EQ(ring.pop(buffer, sizeof buffer), 104u) << "Popped all";
+		EXPECT_EQ(buffer[0], 40) << "Order kept after growing";
+		EXPECT_EQ(buffer[8], 0) << "Second push follows";
+		EXPECT_EQ(buffer[103], 47) << "Third push at the end";
+	}
+
+	TEST(ByteRingTest, EraseTest) {
+		ByteRing ring;
+		ring.push(reinterpret_cast<const uint8_t*>("0123456789"), 10);
+		ring.erase(3, 4);
+		EXPECT_EQ(ring.size(), 6u) << "4 bytes removed";
+		uint8_t buffer[10] = {};
+		ring.pop(buffer, 2);
+		ring.erase(2, 10);
+		EXPECT_EQ(ring.size(), 2u) << "Erase stops at the end";
+		ring.erase(5, 1);
+		EXPECT_EQ(ring.size(), 2u) << "Erase beyond the end does nothing";
+		ring.pop(buffer + 2, 2);
+		EXPECT_EQ(memcmp(buffer, "0127", 4), 0) << "Remaining bytes in order";
+	}
+}
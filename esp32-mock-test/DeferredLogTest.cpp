@@ -0,0 +1,113 @@
+// Copyright 2026 Rik Essenius
+// 
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file
+// except in compliance with the License. You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#include <gtest/gtest.h>
+#include "../esp32-mock/ESP.h"
+
+namespace esp32_mock_test {
+	class StringSink : public SerialSink {
+	public:
+		void write(const char* data, const size_t length) override { text.append(data, length); }
+		void flush() override { flushCount++; }
+		std::string text;
+		int flushCount = 0;
+	};
+
+	TEST(DeferredLogTest, FormatTest) {
+		DeferredLog log;
+		const std::string name = "sensor";
+		const size_t size = 42;
+		const int value = -7;
+		log.record(LogLevel::Info, 100, nullptr, "%s: %d items of %zu, %5.2f%% %c %x", name.c_str(), value, size, 99.5, 'k', 255u);
+		log.record(LogLevel::Error, 250, nullptr, "[%*d] [%-4s] [%.*s]", 4, 12, "ab", 3, "abcdef");
+		log.record(LogLevel::Debug, 300, "app", "no arguments, %s missing");
+		EXPECT_EQ(log.count(), 3u) << "Three records";
+		EXPECT_STREQ(log.format().c_str(),
+			"[I] sensor: -7 items of 42, 99.50% k ff\n"
+			"[E] [  12] [ab  ] [abc]\n"
+			"[D] app: no arguments, (null) missing\n") << "Formatted like printf";
+		EXPECT_STREQ(log.format(true).c_str(),
+			"100 [I] sensor: -7 items of 42, 99.50% k ff\n"
+			"250 [E] [  12] [ab  ] [abc]\n"
+			"300 [D] app: no arguments, (null) missing\n") << "Formatted with timestamps";
+	}
+
+	TEST(DeferredLogTest, StringCopyTest) {
+		DeferredLog log;
+		{
+			std::string temporary = "temporary";
+			log.record(LogLevel::Warning, 0, nullptr, "%s", temporary.c_str());
+			temporary = "overwritten";
+		}
+		EXPECT_STREQ(log.format().c_str(), "[W] temporary\n") << "String copied when recorded";
+		const std::string longString(1000, 'x');
+		log.clear();
+		log.record(LogLevel::Warning, 0, nullptr, "%s", longString.c_str());
+		EXPECT_LT(log.format().size(), 600u) << "Long string truncated";
+		log.clear();
+		log.record(LogLevel::Warning, 0, nullptr, "[%s]", "");
+		EXPECT_STREQ(log.format().c_str(), "[W] []\n") << "Empty string as the last argument";
+	}
+
+	TEST(DeferredLogTest, RingFullTest) {
+		DeferredLog log(64);
+		for (int i = 0; i < 50; i++) {
+			log.record(LogLevel::Info, i, nullptr, "record %d", i);
+		}
+		EXPECT_LE(log.bytesUsed(), 64u) << "Stays within capacity";
+		EXPECT_EQ(log.count() + log.droppedRecords(), 50u) << "All records accounted for";
+		EXPECT_GT(log.droppedRecords(), 0u) << "Some records dropped";
+		const std::string text = log.format();
+		EXPECT_EQ(text.find("record 0"), std::string::npos) << "Oldest record gone";
+		EXPECT_NE(text.find("record 49\n"), std::string::npos) << "Newest record kept";
+		EXPECT_NE(log.format(true).find(std::to_string(50 - log.count()) + " [I] record " + std::to_string(50 - log.count()) + "\n"), std::string::npos) <<
+			"Oldest kept record has the right timestamp";
+	}
+
+	TEST(DeferredLogTest, CompactTest) {
+		DeferredLog log;
+		for (int i = 0; i < 100; i++) {
+			log.record(LogLevel::Debug, 1000 + i * 10, "sensor", "reading %d of %u: %d", i, 100u, -i);
+		}
+		EXPECT_EQ(log.count(), 100u) << "All records kept";
+		const std::string text = log.format(true);
+		EXPECT_NE(text.find("1990 [D] sensor: reading 99 of 100: -99\n"), std::string::npos) << "Last record formatted";
+		EXPECT_LT(log.bytesUsed() * 4, text.size()) << "Records take a fraction of the formatted size";
+	}
+
+	TEST(DeferredLogTest, TooBigTest) {
+		DeferredLog log(8);
+		log.record(LogLevel::Error, 0, nullptr, "%s", "a string that doesn't fit in the ring");
+		EXPECT_EQ(log.count(), 0u) << "Record not stored";
+		EXPECT_EQ(log.droppedRecords(), 1u) << "Record counted as dropped";
+		EXPECT_EQ(log.bytesUsed(), 0u) << "Nothing used";
+	}
+
+	TEST(DeferredLogTest, LogPrintfTest) {
+		testSetRealTime(false);
+		delay(5);
+		DeferredLog log;
+		testSetDeferredLog(&log);
+		Serial.testClearOutput();
+		log_e("error %d", 1);
+		log_v("verbose %d", 2);
+		delay(1);
+		log_w("warning %s", "two");
+		testSetDeferredLog(nullptr);
+		EXPECT_STREQ(Serial.testGetOutput(), "") << "Nothing printed while deferred";
+		EXPECT_EQ(log.count(), 2u) << "Filtered call not recorded";
+		StringSink sink;
+		log.dump(sink, true);
+		EXPECT_STREQ(sink.text.c_str(), "5000 [E] error 1\n6000 [W] warning two\n") << "Dumped with timestamps";
+		EXPECT_EQ(sink.flushCount, 1) << "Sink flushed";
+		EXPECT_EQ(log.count(), 0u) << "Dump clears the log";
+	}
+}
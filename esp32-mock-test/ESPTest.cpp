@@ -9,7 +9,9 @@
 // is distributed on an "AS IS" BASIS WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 // See the License for the specific language governing permissions and limitations under the License.
 
+#include <chrono>
 #include <gtest/gtest.h>
+#include <thread>
 #include "../esp32-mock/ESP.h"
 
 namespace esp32_mock_test {
@@ -73,6 +75,31 @@ namespace esp32_mock_test {
 		testSetRealTime(false);
 	}
 
+	TEST(ESPTest, pacedRealtimeTest) {
+		testSetPacedRealTime(true, 10.0);
+		testResetPacingStatistics();
+		const auto wallStart = std::chrono::steady_clock::now();
+		delay(100);
+		const auto wallElapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - wallStart).count();
+		EXPECT_TRUE(micros() >= 100000L) << "Clock moved by the full delay";
+		EXPECT_TRUE(wallElapsed >= 10 && wallElapsed < 100) << "Slept a tenth of the delay at 10x speed";
+		delayMicroseconds(500);
+		auto statistics = testGetPacingStatistics();
+		EXPECT_EQ(statistics.sleepCount, 2UL) << "Both delays slept";
+		EXPECT_TRUE(statistics.maxDriftNanos >= 0) << "Absolute deadline never wakes up early";
+		EXPECT_TRUE(statistics.totalDriftNanos >= statistics.maxDriftNanos) << "Total drift includes max drift";
+		testDisableDelay(true);
+		delay(100);
+		testDisableDelay(false);
+		EXPECT_EQ(testGetPacingStatistics().sleepCount, 2UL) << "Disabled delay does not sleep";
+		testResetPacingStatistics();
+		statistics = testGetPacingStatistics();
+		EXPECT_EQ(statistics.sleepCount, 0UL) << "Statistics reset";
+		testSetRealTime(false);
+		delay(1000);
+		EXPECT_EQ(testGetPacingStatistics().sleepCount, 0UL) << "Switching off real time switches off pacing";
+	}
+
 	TEST(ESPTest, SerialTest) {
 		Serial.begin(115200);
 		Serial.setTimeout(1000);
@@ -82,13 +109,169 @@ namespace esp32_mock_test {
 		Serial.println(" There");
 		EXPECT_STREQ(Serial.testGetOutput(), "Hello There\n");
 		EXPECT_EQ(Serial.available(), 0);
-		EXPECT_EQ(Serial.read(), 0);
+		EXPECT_EQ(Serial.read(), -1);
 		Serial.testSetInput("Hello");
 		EXPECT_EQ(Serial.read(), 'H');
 		EXPECT_EQ(Serial.read(), 'e');
 		EXPECT_EQ(Serial.available(), 3);
 	}
 
+	TEST(ESPTest, SerialInputTest) {
+		Serial.begin(115200);
+		EXPECT_EQ(Serial.peek(), -1) << "Nothing to peek";
+		constexpr uint8_t kBinary[] = { 'a', 0, 'b', '\n', 'c', 'd', '\n', 'e' };
+		Serial.testSetInput(kBinary, sizeof kBinary);
+		EXPECT_EQ(Serial.available(), 8) << "Null bytes count";
+		EXPECT_EQ(Serial.peek(), 'a') << "peek first byte";
+		EXPECT_EQ(Serial.read(), 'a') << "read first byte";
+		EXPECT_EQ(Serial.read(), 0) << "read null byte";
+		char buffer[10] = {};
+		EXPECT_EQ(Serial.readBytesUntil('\n', buffer, sizeof buffer), 1u) << "read until newline";
+		EXPECT_STREQ(buffer, "b") << "terminator not copied";
+		EXPECT_EQ(Serial.available(), 4) << "terminator consumed";
+		EXPECT_EQ(Serial.readBytesUntil('\n', buffer, 1), 1u) << "length reached before terminator";
+		EXPECT_EQ(buffer[0], 'c');
+		EXPECT_STREQ(Serial.readStringUntil('\n').c_str(), "d") << "readStringUntil";
+		EXPECT_STREQ(Serial.readStringUntil('\n').c_str(), "e") << "readStringUntil without terminator reads the rest";
+		EXPECT_EQ(Serial.available(), 0) << "all read";
+
+		Serial.testSetInput("0123456789");
+		uint8_t bytes[20] = {};
+		EXPECT_EQ(Serial.readBytes(bytes, 4), 4u) << "readBytes limited by length";
+		EXPECT_EQ(memcmp(bytes, "0123", 4), 0);
+		EXPECT_EQ(Serial.readBytes(reinterpret_cast<char*>(bytes), sizeof bytes), 6u) << "readBytes limited by available";
+		EXPECT_EQ(memcmp(bytes, "456789", 6), 0);
+		Serial.testSetInput("x");
+		Serial.testClearInput();
+		EXPECT_EQ(Serial.available(), 0) << "Input cleared";
+	}
+
+	TEST(ESPTest, UartTransmitTimingTest) {
+		testSetRealTime(false);
+		Serial.begin(115200);
+		Serial.testSetUartTiming(true);
+		EXPECT_EQ(Serial.baudRate(), 115200u) << "Baud rate";
+		EXPECT_EQ(Serial.availableForWrite(), 128) << "TX buffer empty";
+		const std::string block(100, 'x');
+		Serial.print(block.c_str());
+		EXPECT_EQ(Serial.availableForWrite(), 28) << "100 bytes in the TX buffer";
+		EXPECT_EQ(Serial.testGetUartStatistics().txStallMicros, 0u) << "No stall while the TX buffer has room";
+		Serial.print(block.c_str());
+		// 10 bits per byte at 115200 baud is 86.806 us, and we need to wait until 72 bytes have gone out
+		EXPECT_EQ(Serial.testGetUartStatistics().txStallMicros, 6251u) << "Stalled until the rest fit";
+		EXPECT_EQ(Serial.availableForWrite(), 0) << "TX buffer full";
+		Serial.flush();
+		EXPECT_EQ(Serial.availableForWrite(), 128) << "flush waits until everything is sent";
+		EXPECT_EQ(micros(), 17362u + 50u) << "Clock moved by the time 200 bytes take";
+		EXPECT_EQ(Serial.testGetUartStatistics().bytesWritten, 200u) << "Bytes written";
+
+		Serial.begin(9600, SERIAL_8N2);
+		Serial.setTxBufferSize(1);
+		Serial.print("ab");
+		// 1 start bit, 8 data bits, 2 stop bits at 9600 baud
+		EXPECT_EQ(Serial.testGetUartStatistics().txStallMicros, 1146u) << "Stall with 11 bit frames";
+		Serial.begin(9600, SERIAL_7E1);
+		Serial.print("ab");
+		EXPECT_EQ(Serial.testGetUartStatistics().txStallMicros, 1042u) << "Stall with 10 bit frames";
+		Serial.setTxBufferSize(0);
+		Serial.flush();
+		EXPECT_EQ(Serial.availableForWrite(), 128) << "Back to the default buffer size";
+		Serial.testSetUartTiming(false);
+		Serial.begin(115200);
+	}
+
+	TEST(ESPTest, UartReceiveTimingTest) {
+		testSetRealTime(false);
+		Serial.begin(115200);
+		Serial.testSetUartTiming(true);
+		Serial.testSetInput("hello\n");
+		EXPECT_EQ(Serial.available(), 0) << "Nothing arrived yet";
+		delayMicroseconds(200);
+		EXPECT_EQ(Serial.available(), 2) << "Two bytes arrived after 200 us";
+		EXPECT_STREQ(Serial.readStringUntil('\n').c_str(), "hello") << "readStringUntil waits for the rest";
+		EXPECT_EQ(Serial.testGetUartStatistics().bytesRead, 6u) << "Bytes read including the terminator";
+		EXPECT_EQ(micros(), 521u + 50u) << "Clock moved until the terminator arrived";
+
+		Serial.setRxBufferSize(4);
+		Serial.testSetInput("0123456789");
+		delay(2);
+		EXPECT_EQ(Serial.available(), 4) << "RX buffer full";
+		EXPECT_EQ(Serial.testGetUartStatistics().rxOverflowBytes, 6u) << "The rest got lost";
+		EXPECT_STREQ(Serial.readStringUntil('\n').c_str(), "0123") << "Bytes that fit are intact";
+		Serial.setRxBufferSize(0);
+		Serial.testSetUartTiming(false);
+		Serial.testSetInput("abc");
+		EXPECT_EQ(Serial.available(), 3) << "Without timing everything is there at once";
+		Serial.begin(115200);
+	}
+
+	TEST(ESPTest, SerialLinkTest) {
+		EXPECT_EQ(Serial.uartNumber(), 0) << "Serial is UART 0";
+		EXPECT_EQ(Serial2.uartNumber(), 2) << "Serial2 is UART 2";
+		Serial1.begin(9600, SERIAL_8N1, 16, 17);
+		Serial2.begin(9600);
+		{
+			const SerialLink link(Serial1, Serial2);
+			Serial1.print("$GPGGA,123519\n");
+			EXPECT_EQ(Serial2.available(), 14) << "Serial2 received what Serial1 sent";
+			EXPECT_STREQ(Serial2.readStringUntil('\n').c_str(), "$GPGGA,123519") << "Line intact";
+			Serial2.printf("AT+%s\r", "CSQ");
+			EXPECT_EQ(Serial1.available(), 7) << "Serial1 received what Serial2 sent";
+			char buffer[10] = {};
+			EXPECT_EQ(Serial1.readBytesUntil('\r', buffer, sizeof buffer), 6u) << "Read until CR";
+			EXPECT_STREQ(buffer, "AT+CSQ") << "Command intact";
+			EXPECT_STREQ(Serial1.testGetOutput(), "") << "Output not captured while linked";
+			EXPECT_EQ(link.droppedBytes(), 0u) << "Nothing lost";
+		}
+		Serial1.print("x");
+		EXPECT_EQ(Serial2.available(), 0) << "Disconnected";
+		EXPECT_STREQ(Serial1.testGetOutput(), "x") << "Output captured again";
+		Serial1.testClearOutput();
+	}
+
+	TEST(ESPTest, SerialPrintTest) {
+		Serial.testClearOutput();
+		Stream& stream = Serial;
+		stream.print(42);
+		stream.print(' ');
+		stream.print(0x2a, HEX);
+		stream.print(' ');
+		stream.println(2.5, 1);
+		const uint8_t data[] = { 'o', 'k' };
+		EXPECT_EQ(stream.write(data, sizeof data), 2u) << "Bulk write";
+		EXPECT_STREQ(Serial.testGetOutput(), "42 2A 2.5\nok") << "Printed via Stream";
+		Serial.testClearOutput();
+	}
+
+	TEST(ESPTest, SerialOutputTest) {
+		Serial.begin(115200);
+		const std::string line(99, 'x');
+		for (int i = 0; i < 1000; i++) {
+			Serial.println(line.c_str());
+		}
+		EXPECT_EQ(strlen(Serial.testGetOutput()), 100000u) << "Output is not capped";
+		EXPECT_EQ(Serial.testGetDroppedOutput(), 0u) << "Nothing dropped without a limit";
+
+		const std::string longText(1000, 'y');
+		Serial.testClearOutput();
+		EXPECT_EQ(Serial.printf("%s%d", longText.c_str(), 42), 1002) << "printf longer than the stack buffer";
+		EXPECT_EQ(std::string(Serial.testGetOutput()), longText + "42") << "Long printf output intact";
+
+		Serial.testClearOutput();
+		Serial.testSetOutputLimit(10);
+		for (int i = 0; i < 10; i++) {
+			Serial.printf("%d;", i);
+		}
+		EXPECT_EQ(Serial.testGetDroppedOutput(), 10u) << "Oldest output dropped";
+		EXPECT_STREQ(Serial.testGetOutput(), "5;6;7;8;9;") << "Most recent output kept";
+		Serial.print("a");
+		EXPECT_STREQ(Serial.testGetOutput(), ";6;7;8;9;a") << "Still at the limit";
+		EXPECT_EQ(Serial.testGetDroppedOutput(), 11u) << "One more dropped";
+		Serial.testSetOutputLimit(0);
+		Serial.testClearOutput();
+		EXPECT_EQ(Serial.testGetDroppedOutput(), 0u) << "Clear resets dropped count";
+	}
+
 	TEST(ESPTest, LogLevelTest) {
 		EXPECT_STREQ(toString(LogLevel::Error), "E");
 		EXPECT_STREQ(toString(LogLevel::Warning), "W");
@@ -98,6 +281,65 @@ namespace esp32_mock_test {
 		EXPECT_EQ(toString(static_cast<LogLevel>(6)), nullptr);
 	}
 
+	TEST(ESPTest, LogFilterTest) {
+		Serial.testClearOutput();
+		int evaluations = 0;
+		auto count = [&evaluations] { return ++evaluations; };
+		setLogLevel(LogLevel::Warning);
+		log_e("error %d", count());
+		log_w("warning %d", count());
+		log_i("info %d", count());
+		log_v("verbose %d", count());
+		EXPECT_STREQ(Serial.testGetOutput(), "[E] error 1\n[W] warning 2\n") << "Only error and warning logged";
+		EXPECT_EQ(evaluations, 2) << "Arguments of skipped calls not evaluated";
+		setLogLevel(LogLevel::Info);
+		Serial.testClearOutput();
+	}
+
+	namespace {
+		LogRecord lastRecord{};
+
+		void rememberRecord(const LogRecord& record) {
+			lastRecord = record;
+		}
+	}
+
+	TEST(ESPTest, LogTaskTest) {
+		testSetRealTime(false);
+		delay(3);
+		Serial.testClearOutput();
+		testSetLogListener(rememberRecord);
+		std::thread task([] {
+			testSetCurrentTask(reinterpret_cast<TaskHandle_t>(1234), 1);
+			log_e("from task %d", 1);
+		});
+		task.join();
+		testSetLogListener(nullptr);
+		EXPECT_STREQ(Serial.testGetOutput(), "[E] from task 1\n") << "Printed";
+		EXPECT_EQ(lastRecord.task, reinterpret_cast<TaskHandle_t>(1234)) << "Task of the thread";
+		EXPECT_EQ(lastRecord.core, 1) << "Core of the thread";
+		EXPECT_EQ(lastRecord.timestamp, 3000) << "Timestamp from the mock clock";
+		EXPECT_EQ(lastRecord.level, LogLevel::Error) << "Level";
+		Serial.testClearOutput();
+	}
+
+	namespace {
+		void warnOnError(const LogRecord& record) {
+			if (record.level == LogLevel::Error) {
+				log_w("seen: %s", record.message);
+			}
+		}
+	}
+
+	TEST(ESPTest, LogFromListenerTest) {
+		Serial.testClearOutput();
+		testSetLogListener(warnOnError);
+		log_e("failed");
+		testSetLogListener(nullptr);
+		EXPECT_STREQ(Serial.testGetOutput(), "[E] failed\n[W] seen: failed\n") << "Listener logged after the record";
+		Serial.testClearOutput();
+	}
+
 	TEST(ESPTest, TimerTest) {
 		yield(); // just make sure we can run it
 		const auto result = timerBegin(1, 2, true);
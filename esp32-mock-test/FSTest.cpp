@@ -10,13 +10,19 @@
 // See the License for the specific language governing permissions and limitations under the License.
 
 #include <gtest/gtest.h>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
 #include "../esp32-mock/FS.h"
+#include "../esp32-mock/LittleFS.h"
 
 namespace esp32_mock_test {
 	class FSTest : public testing::Test {
 	public:
 		void SetUp() override {
 			File::testDeleteFiles();
+			SPIFFS.testSetCapacity(FileStore::kDefaultCapacity);
 		}
 
 		static void expectNextChar(File& file, const char expected, const int remaining) {
@@ -31,7 +37,14 @@ namespace esp32_mock_test {
 			EXPECT_EQ(dir.fileSize(), expectedSize);
 		}
 
-		static void expectFileMetadata(const File& file, const bool isOpen, const size_t expectedSize, const size_t expectedAvailable,
+		static void expectNextChild(File& folder, const char* expectedPath, const bool expectedIsDirectory) {
+			auto child = folder.openNextFile();
+			EXPECT_TRUE(child) << "Child " << expectedPath << " found";
+			EXPECT_STREQ(child.path(), expectedPath) << "Child path";
+			EXPECT_EQ(child.isDirectory(), expectedIsDirectory) << "Child " << expectedPath << " is folder";
+		}
+
+		static void expectFileMetadata(File& file, const bool isOpen, const size_t expectedSize, const int expectedAvailable,
 		                               const char* label) {
 			if (isOpen) {
 				EXPECT_TRUE(file) << "File should be valid for " << label;
@@ -62,7 +75,7 @@ namespace esp32_mock_test {
 		EXPECT_EQ(writeFile.position(), 0) << "write position 0";
 		writeFile.close();
 
-		const auto nonExistingFile = SPIFFS.open("/nonExisting.txt", "r");
+		auto nonExistingFile = SPIFFS.open("/nonExisting.txt", "r");
 		expectFileMetadata(nonExistingFile, false, 0, 0, "non-existing file");
 	}
 
@@ -177,6 +190,53 @@ namespace esp32_mock_test {
 		EXPECT_FALSE(dir.next());
 	}
 
+	TEST_F(FSTest, ReadUntilTest) {
+		File::testDefineFile(kFileName, "name,value\nalpha,1\nbeta,22\n\nlast");
+		SPIFFS.begin();
+		auto file = SPIFFS.open(kFileName, "r");
+		EXPECT_STREQ(file.readStringUntil('\n').c_str(), "name,value") << "Header";
+		EXPECT_STREQ(file.readStringUntil(',').c_str(), "alpha") << "Field";
+		char buffer[10] = {};
+		EXPECT_EQ(file.readBytesUntil('\n', buffer, sizeof buffer), 1u) << "Bytes until terminator";
+		EXPECT_EQ(buffer[0], '1') << "Value";
+		EXPECT_EQ(file.readBytesUntil('\n', buffer, 3), 3u) << "Stops at the length";
+		EXPECT_EQ(file.peek(), 'a') << "Stopped after three bytes";
+		EXPECT_TRUE(file.find("22\n")) << "Found";
+		EXPECT_STREQ(file.readStringUntil('\n').c_str(), "") << "Empty line";
+		EXPECT_STREQ(file.readStringUntil('\n').c_str(), "last") << "Last line without terminator";
+		EXPECT_STREQ(file.readStringUntil('\n').c_str(), "") << "Nothing left";
+		EXPECT_EQ(file.readBytesUntil('\n', buffer, sizeof buffer), 0u) << "Nothing left for bytes";
+
+		file.seek(0, SeekSet);
+		EXPECT_TRUE(file.find("a,")) << "Found after a partial match";
+		EXPECT_EQ(file.peek(), '1') << "Right after the target";
+		EXPECT_FALSE(file.find("name")) << "Not found after the position";
+		EXPECT_EQ(file.available(), 0) << "Everything read when not found";
+		auto writer = SPIFFS.open(kFileName, "a");
+		EXPECT_FALSE(writer.find("a")) << "Can't search in a write only file";
+		EXPECT_STREQ(writer.readStringUntil('\n').c_str(), "") << "Can't read a write only file";
+	}
+
+	TEST_F(FSTest, ReadLinesTest) {
+		constexpr int kLines = 50000;
+		SPIFFS.begin();
+		auto csv = SPIFFS.open("/fixture.csv", "w");
+		for (int i = 0; i < kLines; i++) {
+			csv.printf("%d,sensor%d,%d.5\n", i, i % 10, i * 3);
+		}
+		csv.close();
+		csv = SPIFFS.open("/fixture.csv", "r");
+		int lines = 0;
+		long long sum = 0;
+		while (csv.available() > 0) {
+			sum += atoi(csv.readStringUntil(',').c_str());
+			csv.readStringUntil('\n');
+			lines++;
+		}
+		EXPECT_EQ(lines, kLines) << "All lines read";
+		EXPECT_EQ(sum, static_cast<long long>(kLines) * (kLines - 1) / 2) << "All first fields parsed";
+	}
+
 	TEST_F(FSTest, SeekTest) {
 		constexpr auto fileName = "/ca.crt";
 		SPIFFS.begin();
@@ -200,6 +260,584 @@ namespace esp32_mock_test {
 		EXPECT_EQ(file.position(), 6) << "Seek past EOF returns last position";
 	}
 
+	TEST_F(FSTest, SharedContentTest) {
+		SPIFFS.begin();
+		File::testDefineFile(kFileName, "original");
+		auto reader = SPIFFS.open(kFileName, "r");
+		auto updater = SPIFFS.open(kFileName, "r+");
+		updater.write("changed!", 8);
+		EXPECT_STREQ(reader.readString().c_str(), "changed!") << "Reader sees the changes of another handle";
+		EXPECT_EQ(SPIFFS.usedBytes(), 8u) << "Same size, so used bytes didn't change";
+		updater.write("more", 4);
+		EXPECT_EQ(SPIFFS.usedBytes(), 12u) << "Used bytes include what isn't flushed yet";
+		updater.flush();
+		EXPECT_EQ(SPIFFS.usedBytes(), 12u) << "Flushed";
+		updater.close();
+		auto newReader = SPIFFS.open(kFileName, "r");
+		EXPECT_STREQ(newReader.readString().c_str(), "changed!more") << "New reader sees the saved changes";
+
+		auto appender = SPIFFS.open(kFileName, "a");
+		auto copy = appender;
+		auto other = SPIFFS.open(kFileName, "a");
+		appender.write("1", 1);
+		copy.write("2", 1);
+		other.write("3", 1);
+		copy.close();
+		EXPECT_EQ(appender.size(), 15u) << "All handles append to the same file";
+		appender.close();
+		other.close();
+		EXPECT_STREQ(SPIFFS.open(kFileName, "r").readString().c_str(), "changed!more123") << "No append lost";
+
+		auto created = SPIFFS.open("/new.txt", "w");
+		EXPECT_TRUE(SPIFFS.exists("/new.txt")) << "Created files exist right away";
+		auto truncater = SPIFFS.open(kFileName, "w");
+		EXPECT_EQ(newReader.size(), 0u) << "Truncating affects all handles";
+		truncater.print("gone");
+		SPIFFS.remove(kFileName);
+		truncater.close();
+		EXPECT_FALSE(SPIFFS.exists(kFileName)) << "Closing a removed file doesn't bring it back";
+		newReader.seek(0, SeekSet);
+		EXPECT_STREQ(newReader.readString().c_str(), "gone") << "Handles keep a removed file's content";
+		created.close();
+
+		File::testDefineFile(kFileName, "redefined");
+		auto stillOpen = SPIFFS.open(kFileName, "r");
+		File::testDefineFile(kFileName, "again");
+		EXPECT_STREQ(stillOpen.readString().c_str(), "redefined") << "Redefining doesn't change open files";
+	}
+
+	TEST_F(FSTest, ChunkedReadWriteTest) {
+		constexpr size_t ChunkSize = 4096;
+		constexpr size_t ChunkCount = 16;
+		constexpr int Passes = 250;
+		SPIFFS.begin();
+		uint8_t chunk[ChunkSize];
+		auto writer = SPIFFS.open(kFileName, "w");
+		for (size_t i = 0; i < ChunkCount; i++) {
+			memset(chunk, static_cast<int>('a' + i), ChunkSize);
+			EXPECT_EQ(writer.write(chunk, ChunkSize), ChunkSize) << "Chunk " << i << " written";
+		}
+		writer.seek(ChunkSize - 2, SeekSet);
+		writer.write(reinterpret_cast<const uint8_t*>("XYZ"), 3);
+		EXPECT_EQ(writer.size(), ChunkSize * ChunkCount) << "Overwrite across chunks doesn't grow the file";
+		writer.close();
+
+		auto reader = SPIFFS.open(kFileName, "r");
+		EXPECT_EQ(reader.peek(), 'a') << "Peek at start";
+		size_t totalRead = 0;
+		for (int pass = 0; pass < Passes; pass++) {
+			reader.seek(0, SeekSet);
+			for (size_t i = 0; i < ChunkCount; i++) {
+				totalRead += reader.read(chunk, ChunkSize);
+				ASSERT_EQ(chunk[ChunkSize - 1], i == 0 ? 'Y' : 'a' + i) << "Last byte of chunk " << i;
+				ASSERT_EQ(chunk[0], i == 1 ? 'Z' : 'a' + i) << "First byte of chunk " << i;
+			}
+			ASSERT_EQ(reader.read(chunk, ChunkSize), 0u) << "Nothing left after the last chunk";
+		}
+		EXPECT_EQ(totalRead, ChunkSize * ChunkCount * Passes) << "All chunks read in full";
+
+		reader.seek(-100, SeekEnd);
+		EXPECT_EQ(reader.readBytes(reinterpret_cast<char*>(chunk), ChunkSize), 100u) << "Short read at the end";
+		EXPECT_EQ(chunk[99], 'a' + ChunkCount - 1) << "Short read content";
+	}
+
+	TEST_F(FSTest, HostRootTest) {
+		constexpr size_t ChunkSize = 4096;
+		constexpr size_t ChunkCount = 50;
+		SPIFFS.begin();
+		SPIFFS.testSetHostRoot("hostRootTest");
+		uint8_t chunk[ChunkSize];
+		auto writer = SPIFFS.open("/data.bin", "w");
+		ASSERT_TRUE(writer) << "Host file (and folder) created";
+		for (size_t i = 0; i < ChunkCount; i++) {
+			memset(chunk, static_cast<int>(i), ChunkSize);
+			writer.write(chunk, ChunkSize);
+		}
+		EXPECT_EQ(writer.size(), ChunkSize * ChunkCount) << "Size includes buffered writes";
+		writer.close();
+
+		FILE* hostFile = std::fopen("hostRootTest/data.bin", "rb");
+		ASSERT_NE(hostFile, nullptr) << "File exists on the host";
+		std::fseek(hostFile, 0, SEEK_END);
+		EXPECT_EQ(std::ftell(hostFile), static_cast<long>(ChunkSize * ChunkCount)) << "Host file size";
+		std::fclose(hostFile);
+
+		auto reader = SPIFFS.open("/data.bin", "r");
+		EXPECT_EQ(reader.available(), static_cast<int>(ChunkSize * ChunkCount)) << "All available";
+		reader.seek(ChunkSize * 10, SeekSet);
+		EXPECT_EQ(reader.peek(), 10) << "Peek after seek";
+		EXPECT_EQ(reader.read(chunk, ChunkSize), ChunkSize) << "Chunk read";
+		EXPECT_EQ(chunk[ChunkSize - 1], 10) << "Chunk content";
+		EXPECT_EQ(reader.write(chunk, 1), 0u) << "Can't write in read mode";
+		reader.close();
+
+		auto updater = SPIFFS.open("/data.bin", "r+");
+		updater.seek(ChunkSize - 1, SeekSet);
+		updater.write(reinterpret_cast<const uint8_t*>("ab"), 2);
+		updater.seek(-1, SeekEnd);
+		updater.write(reinterpret_cast<const uint8_t*>("yz"), 2);
+		updater.seek(ChunkSize - 2, SeekSet);
+		EXPECT_EQ(updater.readBytes(reinterpret_cast<char*>(chunk), 4), 4u) << "Read back in the same handle";
+		EXPECT_EQ(memcmp(chunk, "\0ab\1", 4), 0) << "Overwrite is visible";
+		EXPECT_EQ(updater.size(), ChunkSize * ChunkCount + 1) << "Writing past the end grows the file";
+		updater.seek(-2, SeekEnd);
+		EXPECT_STREQ(updater.readString().c_str(), "yz") << "Growth visible";
+		updater.close();
+
+		auto appender = SPIFFS.open("/folder/small.txt", "w");
+		appender.print("hello");
+		appender.close();
+		appender = SPIFFS.open("/folder/small.txt", "a");
+		appender.print(" world");
+		appender.close();
+		EXPECT_STREQ(SPIFFS.open("/folder/small.txt", "r").readString().c_str(), "hello world") << "Appended";
+
+		auto dir = SPIFFS.openDir("/");
+		expectNextFile(dir, "/data.bin", ChunkSize * ChunkCount + 1);
+		expectNextFile(dir, "/folder/small.txt", 11);
+		EXPECT_FALSE(dir.next()) << "No more files";
+		EXPECT_FALSE(SPIFFS.open("/missing.txt", "r")) << "Missing host file";
+		auto root = SPIFFS.open("/", "r");
+		EXPECT_TRUE(root.isDirectory()) << "Host root is a folder";
+		expectNextChild(root, "/data.bin", false);
+		auto folder = root.openNextFile();
+		EXPECT_TRUE(folder.isDirectory()) << "Host subfolder";
+		EXPECT_FALSE(root.openNextFile()) << "No more in host root";
+		expectNextChild(folder, "/folder/small.txt", false);
+		EXPECT_FALSE(folder.openNextFile()) << "No more in host folder";
+
+		EXPECT_EQ(SPIFFS.usedBytes(), ChunkSize * ChunkCount + 12) << "Used bytes on the host";
+		EXPECT_TRUE(SPIFFS.exists("/folder")) << "Host folder exists";
+		EXPECT_TRUE(SPIFFS.mkdir("/empty/sub")) << "Host folders made";
+		EXPECT_FALSE(SPIFFS.rmdir("/empty")) << "Host folder not empty";
+		EXPECT_TRUE(SPIFFS.rmdir("/empty/sub")) << "Host folder removed";
+		EXPECT_TRUE(SPIFFS.rmdir("/empty")) << "Parent removed";
+		EXPECT_FALSE(SPIFFS.rename("/data.bin", "/folder/small.txt")) << "Host target exists";
+		EXPECT_TRUE(SPIFFS.rename("/data.bin", "/folder/data.bin")) << "Host file renamed";
+		EXPECT_FALSE(SPIFFS.remove("/folder")) << "remove doesn't remove host folders";
+		EXPECT_TRUE(SPIFFS.remove("/folder/data.bin")) << "Host file removed";
+		EXPECT_FALSE(SPIFFS.exists("/folder/data.bin")) << "Removed host file is gone";
+
+		SPIFFS.testSetHostRoot("");
+		EXPECT_FALSE(SPIFFS.open("/data.bin", "r")) << "Back to the file store";
+		(void)std::remove("hostRootTest/folder/small.txt");
+		(void)std::remove("hostRootTest/folder");
+		(void)std::remove("hostRootTest");
+	}
+
+	TEST_F(FSTest, HostSharedTest) {
+		SPIFFS.begin();
+		SPIFFS.testSetHostRoot("hostSharedTest");
+		std::vector<uint8_t> data(1000000, 'x');
+		auto writer = SPIFFS.open("/data.bin", "w");
+		ASSERT_EQ(writer.write(data.data(), data.size()), data.size()) << "Written";
+		writer.close();
+		SPIFFS.testSetCapacity(1000);
+		EXPECT_EQ(SPIFFS.usedBytes(), data.size()) << "Used bytes of the host files";
+		EXPECT_EQ(SPIFFS.totalBytes(), data.size()) << "Capacity doesn't limit host files, so the total covers them";
+		SPIFFS.testSetCapacity(FileStore::kDefaultCapacity);
+
+		auto reader = SPIFFS.open("/data.bin", "r");
+		EXPECT_EQ(reader.read(data.data(), data.size()), data.size()) << "Read, so the file is mapped";
+		auto truncater = SPIFFS.open("/data.bin", "w");
+		truncater.print("short");
+		truncater.flush();
+		EXPECT_EQ(reader.size(), 5u) << "Reader sees the truncation";
+		reader.seek(900000, SeekSet);
+		EXPECT_EQ(reader.position(), 5u) << "Seek beyond the new end stops at the end";
+		EXPECT_EQ(reader.read(), -1) << "Stale reader doesn't fault";
+		reader.seek(0, SeekSet);
+		EXPECT_STREQ(reader.readString().c_str(), "short") << "Reader sees the new content";
+
+		auto appender = SPIFFS.open("/data.bin", "a");
+		appender.print(" and more");
+		EXPECT_EQ(reader.available(), 0) << "Buffered append not visible yet";
+		appender.flush();
+		EXPECT_EQ(reader.available(), 9) << "Flushed append visible";
+		EXPECT_STREQ(reader.readString().c_str(), " and more") << "Appended content";
+		appender.close();
+		truncater.close();
+		reader.close();
+
+		SPIFFS.testSetHostRoot("");
+		(void)std::remove("hostSharedTest/data.bin");
+		(void)std::remove("hostSharedTest");
+	}
+
+	TEST_F(FSTest, FolderTest) {
+		SPIFFS.begin();
+		for (const auto path : {"/a.txt", "/logs/1.txt", "/logs/2.txt", "/logs/old/3.txt", "/logs-x.txt", "/z.txt"}) {
+			File::testDefineFile(path, path);
+		}
+		auto root = SPIFFS.open("/", "r");
+		EXPECT_TRUE(root) << "Root opened";
+		EXPECT_TRUE(root.isDirectory()) << "Root is a folder";
+		EXPECT_EQ(root.read(), -1) << "Nothing to read from a folder";
+		expectNextChild(root, "/a.txt", false);
+		expectNextChild(root, "/logs-x.txt", false);
+		auto logs = root.openNextFile();
+		EXPECT_STREQ(logs.path(), "/logs") << "Subfolder reported once";
+		EXPECT_STREQ(logs.name(), "logs") << "Name without path";
+		EXPECT_TRUE(logs.isDirectory()) << "Subfolder is a folder";
+		expectNextChild(root, "/z.txt", false);
+		EXPECT_FALSE(root.openNextFile()) << "No more entries in root";
+		root.rewindDirectory();
+		expectNextChild(root, "/a.txt", false);
+
+		auto first = logs.openNextFile();
+		EXPECT_STREQ(first.name(), "1.txt") << "File name without path";
+		EXPECT_STREQ(first.readString().c_str(), "/logs/1.txt") << "Child file opened for reading";
+		EXPECT_FALSE(first.isDirectory()) << "A file isn't a folder";
+		EXPECT_FALSE(first.openNextFile()) << "A file has no children";
+		File::testDefineFile("/logs/10.txt", "new");
+		expectNextChild(logs, "/logs/10.txt", false);
+		expectNextChild(logs, "/logs/2.txt", false);
+		expectNextChild(logs, "/logs/old", true);
+		EXPECT_FALSE(logs.openNextFile()) << "No more entries in logs";
+
+		EXPECT_TRUE(SPIFFS.open("/logs/", "r").isDirectory()) << "Trailing slash";
+		EXPECT_FALSE(SPIFFS.open("/log", "r")) << "A partial name isn't a folder";
+		EXPECT_FALSE(SPIFFS.open("/logs", "r+").isDirectory()) << "Folders only open for reading";
+
+		auto dir = SPIFFS.openDir("/logs/");
+		expectNextFile(dir, "/logs/1.txt", 11);
+		File::testDefineFile("/logs/11.txt", "added");
+		expectNextFile(dir, "/logs/10.txt", 3);
+		expectNextFile(dir, "/logs/11.txt", 5);
+		expectNextFile(dir, "/logs/2.txt", 11);
+		expectNextFile(dir, "/logs/old/3.txt", 15);
+		EXPECT_FALSE(dir.next()) << "Listing stops at the end of the prefix";
+	}
+
+	TEST_F(FSTest, FileSystemApiTest) {
+		SPIFFS.begin();
+		LittleFS.begin();
+		LittleFS.testDeleteFiles();
+		File::testDefineFile(kFileName, "spiffs");
+		EXPECT_TRUE(SPIFFS.exists(kFileName)) << "File in SPIFFS";
+		EXPECT_FALSE(LittleFS.exists(kFileName)) << "LittleFS has its own files";
+		LittleFS.testDefineFile(kFileName, "littlefs");
+		EXPECT_STREQ(LittleFS.open(kFileName, "r").readString().c_str(), "littlefs") << "LittleFS content";
+		EXPECT_STREQ(SPIFFS.open(kFileName, "r").readString().c_str(), "spiffs") << "SPIFFS content unchanged";
+
+		EXPECT_TRUE(SPIFFS.mkdir("/logs")) << "mkdir";
+		auto root = SPIFFS.open("/", "r");
+		expectNextChild(root, "/ca.crt", false);
+		expectNextChild(root, "/logs", true);
+		EXPECT_FALSE(root.openNextFile()) << "No more in root";
+		auto logs = SPIFFS.open("/logs", "r");
+		EXPECT_TRUE(logs.isDirectory()) << "Empty folder opens";
+		EXPECT_FALSE(logs.openNextFile()) << "Empty folder has no children";
+
+		EXPECT_TRUE(SPIFFS.rename(kFileName, "/logs/ca.crt")) << "Renamed into folder";
+		EXPECT_FALSE(SPIFFS.exists(kFileName)) << "Old name gone";
+		EXPECT_FALSE(SPIFFS.rmdir("/logs")) << "Folder not empty";
+		auto dir = SPIFFS.openDir("/");
+		expectNextFile(dir, "/logs/ca.crt", 6);
+		EXPECT_FALSE(dir.next()) << "Folder entries aren't listed by Dir";
+		EXPECT_TRUE(SPIFFS.remove("/logs/ca.crt")) << "Removed";
+		EXPECT_FALSE(SPIFFS.remove("/logs/ca.crt")) << "Already removed";
+		EXPECT_TRUE(SPIFFS.rmdir("/logs")) << "Removed empty folder";
+		EXPECT_FALSE(SPIFFS.exists("/logs")) << "Folder gone";
+		LittleFS.testDeleteFiles();
+	}
+
+	TEST_F(FSTest, CapacityTest) {
+		SPIFFS.begin();
+		SPIFFS.testSetCapacity(100);
+		EXPECT_EQ(SPIFFS.totalBytes(), 100u) << "Total bytes";
+		File::testDefineFile("/other.txt", "0123456789");
+		EXPECT_EQ(SPIFFS.usedBytes(), 10u) << "Used bytes";
+		uint8_t buffer[150] = {};
+		auto file = SPIFFS.open(kFileName, "w");
+		EXPECT_EQ(file.write(buffer, 50), 50u) << "Fits";
+		EXPECT_EQ(file.write(buffer, 50), 40u) << "Cut short";
+		EXPECT_EQ(file.write(buffer, 1), 0u) << "Full";
+		file.seek(0, SeekSet);
+		EXPECT_EQ(file.write(buffer, 10), 10u) << "Overwriting takes no extra space";
+		file.close();
+		EXPECT_EQ(SPIFFS.usedBytes(), 100u) << "Partition full";
+		EXPECT_EQ(SPIFFS.open("/new.txt", "a").write(buffer, 1), 0u) << "No room for another file";
+		EXPECT_TRUE(SPIFFS.remove("/other.txt")) << "Make room";
+		file = SPIFFS.open(kFileName, "a");
+		EXPECT_EQ(file.write(buffer, 20), 10u) << "Room again";
+		file.close();
+		EXPECT_EQ(SPIFFS.usedBytes(), 100u) << "Full again";
+	}
+
+	TEST_F(FSTest, CapacityOpenFilesTest) {
+		SPIFFS.begin();
+		SPIFFS.testSetCapacity(1000);
+		uint8_t buffer[800] = {};
+		auto first = SPIFFS.open("/a.txt", "w");
+		auto second = SPIFFS.open("/b.txt", "w");
+		EXPECT_EQ(first.write(buffer, 800), 800u) << "First writer fits";
+		EXPECT_EQ(second.write(buffer, 800), 200u) << "Second writer gets what the first one left, before it flushed";
+		EXPECT_EQ(SPIFFS.usedBytes(), 1000u) << "Used bytes include both writers";
+		EXPECT_TRUE(SPIFFS.remove("/a.txt")) << "Removed while open";
+		EXPECT_EQ(first.write(buffer, 10), 10u) << "Removed file no longer counts";
+		EXPECT_EQ(second.write(buffer, 800), 800u) << "Room again";
+		first.close();
+		second.close();
+		EXPECT_EQ(SPIFFS.usedBytes(), 1000u) << "Only the second file left";
+		SPIFFS.testDeleteFiles();
+
+		// writers on their own files, each with a snapshot so their content is a copy that isn't published yet
+		constexpr int kWriters = 4;
+		std::vector<std::thread> threads;
+		std::vector<size_t> written(kWriters, 0);
+		for (int i = 0; i < kWriters; i++) {
+			threads.emplace_back([i, &written] {
+				auto file = SPIFFS.open(("/w" + std::to_string(i) + ".txt").c_str(), "w");
+				const uint8_t chunk[7] = {};
+				size_t length;
+				while ((length = file.write(chunk, sizeof chunk)) > 0) {
+					written[i] += length;
+					if (written[i] % 70 == 0) {
+						SPIFFS.testSnapshot();
+					}
+				}
+				file.close();
+			});
+		}
+		for (auto& thread : threads) {
+			thread.join();
+		}
+		size_t total = 0;
+		for (const auto count : written) {
+			total += count;
+		}
+		EXPECT_EQ(total, 1000u) << "Writers together filled the capacity exactly";
+		EXPECT_EQ(SPIFFS.usedBytes(), 1000u) << "Used bytes after closing";
+	}
+
+	TEST_F(FSTest, CapacityDroppedFileTest) {
+		SPIFFS.begin();
+		SPIFFS.testDefineFile("/a.txt", "abc");
+		const auto fixture = SPIFFS.testSnapshot();
+		for (int i = 0; i < 3; i++) {
+			SPIFFS.testRestore(fixture);
+			{
+				// the fixture shares the content, so the handle writes to a copy that it drops without closing
+				auto file = SPIFFS.open("/a.txt", "a");
+				EXPECT_EQ(file.print("0123456789"), 10u) << "Written";
+			}
+			SPIFFS.testRestore(fixture);
+			EXPECT_EQ(SPIFFS.usedBytes(), 3u) << "Dropped handle gave its growth back";
+		}
+		SPIFFS.testSetCapacity(50);
+		auto file = SPIFFS.open("/b.txt", "w");
+		const uint8_t buffer[40] = {};
+		EXPECT_EQ(file.write(buffer, sizeof buffer), 40u) << "Capacity still all there";
+		file.close();
+	}
+
+	TEST_F(FSTest, SnapshotTest) {
+		SPIFFS.begin();
+		File::testDefineFile(kFileName, "fixture");
+		File::testDefineFile("/config.json", "{}");
+		const auto fixture = SPIFFS.testSnapshot();
+		auto file = SPIFFS.open(kFileName, "a");
+		file.print(" changed");
+		file.close();
+		SPIFFS.remove("/config.json");
+		auto openFile = SPIFFS.open(kFileName, "r");
+
+		SPIFFS.testRestore(fixture);
+		EXPECT_STREQ(SPIFFS.open(kFileName, "r").readString().c_str(), "fixture") << "Content restored";
+		EXPECT_TRUE(SPIFFS.exists("/config.json")) << "Removed file restored";
+		EXPECT_STREQ(openFile.readString().c_str(), "fixture changed") << "Open file keeps its content";
+
+		LittleFS.begin();
+		LittleFS.testRestore(fixture);
+		EXPECT_EQ(LittleFS.usedBytes(), 9u) << "Snapshot restored into another FS";
+		LittleFS.testDeleteFiles();
+		EXPECT_TRUE(SPIFFS.exists(kFileName)) << "Deleting the other FS's files doesn't affect this one";
+	}
+
+	TEST_F(FSTest, ConcurrentTest) {
+		constexpr int kTasks = 4;
+		constexpr int kRecords = 2000;
+		constexpr auto kLog = "/shared.log";
+		SPIFFS.begin();
+		auto reader = SPIFFS.open(kLog, "w+");
+		std::vector<std::thread> tasks;
+		for (int task = 0; task < kTasks; task++) {
+			tasks.emplace_back([task] {
+				auto log = SPIFFS.open(kLog, "a");
+				const auto ownName = "/task" + std::to_string(task) + ".log";
+				auto own = SPIFFS.open(ownName.c_str(), "w");
+				char record[9];
+				for (int i = 0; i < kRecords; i++) {
+					snprintf(record, sizeof record, "%d%06d\n", task, i);
+					log.write(reinterpret_cast<const uint8_t*>(record), 8);
+					own.write(reinterpret_cast<const uint8_t*>(record), 8);
+					if (i % 500 == 0) {
+						log.flush();
+						SPIFFS.exists(ownName.c_str());
+					}
+				}
+				log.close();
+				own.close();
+			});
+		}
+		while (reader.size() < static_cast<size_t>(8 * kTasks * kRecords) && reader.size() % 8 == 0) {
+			std::this_thread::yield();
+		}
+		for (auto& task : tasks) {
+			task.join();
+		}
+		EXPECT_EQ(reader.size(), static_cast<size_t>(8 * kTasks * kRecords)) << "Reader saw all appends, in whole records";
+
+		int next[kTasks] = {};
+		int failures = 0;
+		for (int i = 0; i < kTasks * kRecords; i++) {
+			char record[9] = {};
+			reader.read(reinterpret_cast<uint8_t*>(record), 8);
+			const auto task = record[0] - '0';
+			if (task < 0 || task >= kTasks || atoi(record + 1) != next[task]++ || record[7] != '\n') failures++;
+		}
+		EXPECT_EQ(failures, 0) << "Records of each task intact and in order";
+		EXPECT_EQ(SPIFFS.usedBytes(), static_cast<size_t>(2 * 8 * kTasks * kRecords)) << "Used bytes";
+	}
+
+	TEST_F(FSTest, StatisticsTest) {
+		class StringSink : public SerialSink {
+		public:
+			void write(const char* data, const size_t length) override { output.append(data, length); }
+			void flush() override {}
+			std::string output;
+		};
+
+		SPIFFS.begin();
+		SPIFFS.testResetStatistics();
+		LittleFS.testResetStatistics();
+		File::testDefineFile(kFileName, "abc\ndef\n");
+		for (int i = 0; i < 3; i++) {
+			auto file = SPIFFS.open(kFileName, "a+");
+			file.print("x");
+			file.seek(0, SeekSet);
+			file.readStringUntil('\n');
+			file.read();
+			file.close();
+		}
+		auto folder = SPIFFS.open("/", "r");
+		auto child = folder.openNextFile();
+		child.close();
+		folder.close();
+
+		const auto statistics = SPIFFS.testStatistics(kFileName);
+		EXPECT_EQ(statistics.opens, 4u) << "Opened three times, and once via the folder";
+		EXPECT_EQ(statistics.closes, 4u) << "Closes";
+		EXPECT_EQ(statistics.writes, 3u) << "Writes";
+		EXPECT_EQ(statistics.bytesWritten, 3u) << "Bytes written";
+		EXPECT_EQ(statistics.seeks, 3u) << "Seeks";
+		EXPECT_EQ(statistics.reads, 6u) << "Reads";
+		EXPECT_EQ(statistics.bytesRead, 15u) << "Bytes read";
+		EXPECT_EQ(statistics.largestSize, 11u) << "Largest size";
+		EXPECT_EQ(SPIFFS.testStatistics().opens, 4u) << "Folders don't count";
+		EXPECT_EQ(SPIFFS.testStatistics("/other").opens, 0u) << "Never opened";
+		EXPECT_EQ(LittleFS.testStatistics().opens, 0u) << "Other FS has its own statistics";
+
+		StringSink sink;
+		SPIFFS.testDumpStatistics(sink);
+		EXPECT_EQ(sink.output,
+		          "/ca.crt: opens 4, closes 4, reads 6 (15 bytes), writes 3 (3 bytes), seeks 3, largest 11 bytes\n"
+		          "total: opens 4, closes 4, reads 6 (15 bytes), writes 3 (3 bytes), seeks 3, largest 11 bytes\n") << "Dump";
+
+		const std::string longPath = "/" + std::string(400, 'p');
+		const auto line = FileStatistics{}.format(longPath.c_str());
+		EXPECT_EQ(line, longPath + ": opens 0, closes 0, reads 0 (0 bytes), writes 0 (0 bytes), seeks 0, largest 0 bytes\n") <<
+			"Long path not truncated";
+
+		auto open = SPIFFS.open(kFileName, "r");
+		SPIFFS.testResetStatistics();
+		open.read();
+		open.close();
+		EXPECT_EQ(SPIFFS.testStatistics(kFileName).reads, 1u) << "Open files keep counting after a reset";
+		EXPECT_EQ(SPIFFS.testStatistics(kFileName).opens, 0u) << "Opens reset";
+
+		SPIFFS.testResetStatistics();
+		auto original = SPIFFS.open(kFileName, "r");
+		auto copy = original;
+		copy.close();
+		original.close();
+		EXPECT_EQ(SPIFFS.testStatistics(kFileName).closes, 1u) << "Closing copies of a handle counts one close";
+
+		constexpr auto kDumpFile = "statisticsTest.txt";
+		std::remove(kDumpFile);
+		{
+			FS fs;
+			fs.begin();
+			fs.testDumpStatisticsAtExit(kDumpFile);
+			fs.open("/a.txt", "w").close();
+		}
+		const auto dump = HostFile::open(kDumpFile, false, false);
+		ASSERT_NE(dump, nullptr) << "Dumped when the FS went away";
+		EXPECT_EQ(std::string(reinterpret_cast<const char*>(dump->data()), dump->size()),
+		          "/a.txt: opens 1, closes 1, reads 0 (0 bytes), writes 0 (0 bytes), seeks 0, largest 0 bytes\n"
+		          "total: opens 1, closes 1, reads 0 (0 bytes), writes 0 (0 bytes), seeks 0, largest 0 bytes\n") << "Dump file";
+		std::remove(kDumpFile);
+	}
+
+	TEST_F(FSTest, ImageTest) {
+		constexpr auto kImage = "imageTest.bin";
+		SPIFFS.begin();
+		File::testDefineFile(kFileName, "in the image");
+		SPIFFS.mkdir("/logs");
+		SPIFFS.testSetCapacity(64 * 4096 + 100);
+		ASSERT_TRUE(SPIFFS.testExportImage(kImage)) << "Exported";
+		std::map<std::string, size_t> written = HostFile::listFiles(".", "/imageTest");
+		EXPECT_EQ(written["/imageTest.bin"], 64u * 4096u) << "Image has whole blocks";
+
+		LittleFS.begin();
+		LittleFS.testDefineFile("/other.txt", "replaced");
+		ASSERT_TRUE(LittleFS.testMountImage(kImage)) << "Mounted";
+		EXPECT_FALSE(LittleFS.exists("/other.txt")) << "Files replaced";
+		EXPECT_STREQ(LittleFS.open(kFileName, "r").readString().c_str(), "in the image") << "Content from image";
+		EXPECT_TRUE(LittleFS.exists("/logs")) << "Empty folder from image";
+		EXPECT_EQ(LittleFS.totalBytes(), 64u * 4096u) << "Capacity from image";
+		EXPECT_FALSE(LittleFS.testMountImage("doesNotExist.bin")) << "Missing image";
+		EXPECT_FALSE(LittleFS.testMountImage(kImage, 512)) << "Wrong block size";
+		EXPECT_TRUE(LittleFS.exists(kFileName)) << "Files kept after failed mount";
+		LittleFS.testDeleteFiles();
+		LittleFS.testSetCapacity(FileStore::kDefaultCapacity);
+		std::remove(kImage);
+	}
+
+	TEST_F(FSTest, FlashModelTest) {
+		FlashModel flash;
+		SPIFFS.begin();
+		SPIFFS.testSetFlashModel(&flash);
+		auto file = SPIFFS.open(kFileName, "w");
+		for (int i = 0; i < 4; i++) {
+			file.print("0123456789");
+		}
+		file.close();
+		EXPECT_EQ(flash.statistics().bytesWritten, 40u) << "Bytes written";
+		EXPECT_EQ(flash.statistics().blockErases, 0u) << "Small writes program erased bytes of the same page";
+
+		file = SPIFFS.open(kFileName, "a");
+		file.print("x");
+		file.close();
+		EXPECT_EQ(flash.statistics().blockErases, 0u) << "Appending too";
+
+		file = SPIFFS.open(kFileName, "r+");
+		file.seek(5, SeekSet);
+		file.print("x");
+		file.close();
+		EXPECT_EQ(flash.statistics().blockErases, 1u) << "Overwriting needs an erase";
+
+		file = SPIFFS.open(kFileName, "w");
+		file.print("y");
+		file.close();
+		EXPECT_EQ(flash.statistics().blockErases, 1u) << "Truncating gives a fresh block";
+		SPIFFS.testSetFlashModel(nullptr);
+		file = SPIFFS.open(kFileName, "a");
+		file.print("z");
+		EXPECT_EQ(flash.statistics().bytesWritten, 43u) << "No accounting without the model";
+	}
+
 	TEST_F(FSTest, WrongModeTest) {
 		constexpr auto FileName = "/ca.crt";
 		SPIFFS.begin();
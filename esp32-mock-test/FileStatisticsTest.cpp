@@ -0,0 +1,61 @@
+// Copyright 2026 Rik Essenius
+// 
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file
+// except in compliance with the License. You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+#include "../esp32-mock/FileStatistics.h"
+
+namespace esp32_mock_test {
+	TEST(FileStatisticsTest, CountTest) {
+		FileCounters counters;
+		counters.countOpen(10);
+		counters.countRead(4);
+		counters.countRead(6);
+		counters.countSeek();
+		counters.countWrite(5, 15);
+		counters.countWrite(1, 12);
+		counters.countClose();
+		const auto statistics = counters.statistics();
+		EXPECT_EQ(statistics.opens, 1u) << "Opens";
+		EXPECT_EQ(statistics.closes, 1u) << "Closes";
+		EXPECT_EQ(statistics.reads, 2u) << "Reads";
+		EXPECT_EQ(statistics.bytesRead, 10u) << "Bytes read";
+		EXPECT_EQ(statistics.writes, 2u) << "Writes";
+		EXPECT_EQ(statistics.bytesWritten, 6u) << "Bytes written";
+		EXPECT_EQ(statistics.seeks, 1u) << "Seeks";
+		EXPECT_EQ(statistics.largestSize, 15u) << "Largest size stays the largest";
+		EXPECT_EQ(statistics.format("/a.txt"),
+		          "/a.txt: opens 1, closes 1, reads 2 (10 bytes), writes 2 (6 bytes), seeks 1, largest 15 bytes\n") << "Format";
+
+		counters.reset();
+		EXPECT_EQ(counters.statistics().format("x"),
+		          "x: opens 0, closes 0, reads 0 (0 bytes), writes 0 (0 bytes), seeks 0, largest 0 bytes\n") << "Reset";
+	}
+
+	TEST(FileStatisticsTest, ConcurrentTest) {
+		FileCounters counters;
+		std::vector<std::thread> tasks;
+		for (int task = 0; task < 4; task++) {
+			tasks.emplace_back([&counters, task] {
+				for (int i = 0; i < 10000; i++) {
+					counters.countWrite(2, static_cast<size_t>(task * 10000 + i));
+				}
+			});
+		}
+		for (auto& task : tasks) {
+			task.join();
+		}
+		EXPECT_EQ(counters.statistics().writes, 40000u) << "No writes lost";
+		EXPECT_EQ(counters.statistics().bytesWritten, 80000u) << "No bytes lost";
+		EXPECT_EQ(counters.statistics().largestSize, 39999u) << "Largest size";
+	}
+}
@@ -0,0 +1,178 @@
+// Copyright 2026 Rik Essenius
+// 
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file
+// except in compliance with the License. You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#include <gtest/gtest.h>
+#include <cstring>
+#include "../esp32-mock/FileStore.h"
+
+namespace esp32_mock_test {
+	namespace {
+		std::shared_ptr<FileData> content(const char* text) {
+			return std::make_shared<FileData>(text, text + strlen(text));
+		}
+	}
+
+	TEST(FileStoreTest, StoreRemoveTest) {
+		FileStore store(100);
+		EXPECT_EQ(store.capacity(), 100u) << "Capacity";
+		store.store("/a.txt", content("12345"));
+		store.store("/b/c.txt", content("123"));
+		EXPECT_EQ(store.usedBytes(), 8u) << "Used bytes";
+		EXPECT_EQ(store.find("/a.txt")->size(), 5u) << "Found a.txt";
+		EXPECT_EQ(store.find("/b"), nullptr) << "A folder isn't a file";
+		EXPECT_TRUE(store.exists("/b")) << "Implicit folder exists";
+		EXPECT_FALSE(store.exists("/c")) << "c doesn't exist";
+		EXPECT_EQ(store.maxFileSize("/a.txt"), 97u) << "Room for a.txt: all but the other file";
+		EXPECT_EQ(store.maxFileSize("/new.txt"), 92u) << "Room for a new file";
+
+		store.store("/a.txt", content("1"));
+		EXPECT_EQ(store.usedBytes(), 4u) << "Replacing updates used bytes";
+		EXPECT_TRUE(store.remove("/a.txt")) << "Removed a.txt";
+		EXPECT_FALSE(store.remove("/a.txt")) << "Can't remove twice";
+		EXPECT_FALSE(store.remove("/b")) << "remove doesn't remove folders";
+		EXPECT_EQ(store.usedBytes(), 3u) << "Used bytes after remove";
+		store.setCapacity(2);
+		EXPECT_EQ(store.maxFileSize("/x"), 0u) << "Over capacity";
+		store.clear();
+		EXPECT_EQ(store.usedBytes(), 0u) << "Cleared";
+		EXPECT_TRUE(store.files().empty()) << "No files left";
+	}
+
+	TEST(FileStoreTest, FolderTest) {
+		FileStore store;
+		EXPECT_TRUE(store.isFolder("/")) << "Root always exists";
+		EXPECT_TRUE(store.makeFolder("/logs")) << "Made logs";
+		EXPECT_TRUE(store.makeFolder("/logs/")) << "Making it again is fine";
+		EXPECT_EQ(store.files().size(), 1u) << "One folder entry";
+		EXPECT_TRUE(store.isFolder("/logs")) << "Empty folder exists";
+		EXPECT_EQ(store.usedBytes(), 0u) << "Folders take no space";
+		store.store("/logs/1.txt", content("one"));
+		store.store("/file", content("f"));
+		EXPECT_FALSE(store.makeFolder("/file")) << "Can't make a folder over a file";
+		EXPECT_FALSE(store.removeFolder("/logs")) << "Can't remove a folder with files";
+		EXPECT_FALSE(store.removeFolder("/nope")) << "Can't remove a non-existing folder";
+
+		EXPECT_TRUE(store.rename("/logs", "/old")) << "Renamed folder";
+		EXPECT_FALSE(store.exists("/logs")) << "Old folder gone";
+		EXPECT_EQ(store.find("/old/1.txt")->size(), 3u) << "File moved with the folder";
+		EXPECT_EQ(store.usedBytes(), 4u) << "Used bytes unchanged";
+		EXPECT_FALSE(store.rename("/old", "/file")) << "Target exists";
+		EXPECT_FALSE(store.rename("/missing", "/x")) << "Source doesn't exist";
+		EXPECT_FALSE(store.rename("/", "/x")) << "Can't rename the root";
+		EXPECT_TRUE(store.rename("/old/1.txt", "/1.txt")) << "Renamed file";
+		EXPECT_EQ(store.find("/old/1.txt"), nullptr) << "Old name gone";
+		EXPECT_TRUE(store.isFolder("/old")) << "Made folder stays when emptied";
+		EXPECT_TRUE(store.removeFolder("/old")) << "Removed empty folder";
+		EXPECT_FALSE(store.isFolder("/old")) << "Folder gone";
+	}
+
+	TEST(FileStoreTest, SnapshotTest) {
+		FileStore store;
+		for (int i = 0; i < 500; i++) {
+			store.store("/fixture/" + std::to_string(i), content("data"));
+		}
+		store.makeFolder("/empty");
+		const auto shared = store.find("/fixture/7");
+		const auto snapshot = store.snapshot();
+		EXPECT_FALSE(snapshot.empty()) << "Snapshot taken";
+
+		store.store("/fixture/7", content("changed"));
+		store.remove("/fixture/8");
+		store.rename("/fixture/9", "/moved");
+		store.removeFolder("/empty");
+		store.store("/new", content("new"));
+		EXPECT_EQ(store.find("/fixture/7")->size(), 7u) << "Store changed";
+		EXPECT_EQ(store.usedBytes(), 499u * 4 + 3 + 3) << "Used bytes after changes";
+
+		store.restore(snapshot);
+		EXPECT_EQ(store.find("/fixture/7"), shared) << "Content is shared, not copied";
+		EXPECT_NE(store.find("/fixture/8"), nullptr) << "Removed file back";
+		EXPECT_NE(store.find("/fixture/9"), nullptr) << "Renamed file back";
+		EXPECT_EQ(store.find("/moved"), nullptr) << "Rename undone";
+		EXPECT_EQ(store.find("/new"), nullptr) << "New file gone";
+		EXPECT_TRUE(store.isFolder("/empty")) << "Removed folder back";
+		EXPECT_EQ(store.usedBytes(), 2000u) << "Used bytes restored";
+
+		store.remove("/fixture/0");
+		store.restore(snapshot);
+		EXPECT_NE(store.find("/fixture/0"), nullptr) << "A snapshot can be restored more than once";
+
+		FileStore other;
+		other.restore(snapshot);
+		other.clear();
+		EXPECT_EQ(other.usedBytes(), 0u) << "Other store cleared";
+		EXPECT_EQ(store.usedBytes(), 2000u) << "Clearing another store that restored the snapshot doesn't affect it";
+		store.restore(FileStore::Snapshot());
+		EXPECT_TRUE(store.files().empty()) << "Restoring an empty snapshot clears";
+	}
+
+	TEST(FileStoreTest, OpenTest) {
+		FileStore store;
+		store.store("/a.txt", content("abc"));
+		EXPECT_EQ(store.open("/none.txt", false, false), nullptr) << "Not created";
+		EXPECT_EQ(store.open("/", true, false), nullptr) << "Can't open a folder as a file";
+		const auto node = store.open("/a.txt", false, false);
+		ASSERT_NE(node, nullptr) << "Opened";
+		EXPECT_EQ(node->content, store.find("/a.txt")) << "Content shared with the store";
+		EXPECT_EQ(store.open("/a.txt", true, false), node) << "Handles on the same path share the node";
+
+		const auto created = store.open("/new/b.txt", true, false);
+		EXPECT_NE(store.find("/new/b.txt"), nullptr) << "Created file stored right away";
+		created->content = content("bb");
+		store.publish(*created);
+		EXPECT_EQ(store.usedBytes(), 5u) << "Published";
+
+		EXPECT_TRUE(store.rename("/new", "/old")) << "Renamed folder with an open file";
+		EXPECT_EQ(created->path, "/old/b.txt") << "Open file moved along";
+		EXPECT_EQ(store.open("/old/b.txt", false, false), created) << "Found under the new path";
+
+		EXPECT_TRUE(store.remove("/a.txt")) << "Removed open file";
+		EXPECT_FALSE(node->linked) << "Unlinked";
+		store.publish(*node);
+		EXPECT_FALSE(store.exists("/a.txt")) << "Unlinked files aren't published";
+		store.clear();
+		EXPECT_FALSE(created->linked) << "Clear unlinks";
+		EXPECT_NE(store.open("/old/b.txt", true, false), created) << "Reopening after clear gives a new node";
+	}
+
+	TEST(FileStoreTest, WriteInPlaceTest) {
+		FileStore store;
+		auto initial = std::make_shared<FileData>(1000, 'x');
+		initial->reserve(100000);
+		const auto data = initial->data();
+		store.store("/log.txt", std::move(initial));
+		const auto node = store.open("/log.txt", false, false);
+		const uint8_t line[] = { 'l', 'i', 'n', 'e', '\n' };
+		std::unique_lock<std::mutex> lock(node->mutex);
+		for (int i = 0; i < 1000; i++) {
+			ASSERT_EQ(store.write(*node, node->content->size(), line, sizeof line), sizeof line) << "Appended";
+			store.publish(*node);
+		}
+		EXPECT_EQ(node->content->data(), data) << "Appending and publishing doesn't copy the content";
+		EXPECT_EQ(store.usedBytes(), 6000u) << "Used bytes follow the writes in place";
+
+		const auto snapshot = store.snapshot();
+		EXPECT_EQ(store.write(*node, 0, line, 4), 4u) << "Overwritten";
+		EXPECT_NE(node->content->data(), data) << "Copied, since the snapshot has the content";
+		EXPECT_EQ(snapshot.files().at("/log.txt")->at(0), 'x') << "Snapshot unchanged";
+		store.publish(*node);
+		EXPECT_EQ(store.usedBytes(), 6000u) << "Same size after publishing the copy";
+
+		const auto copy = node->content->data();
+		EXPECT_EQ(store.write(*node, 4, line, 4), 4u) << "Overwritten again";
+		EXPECT_EQ(node->content->data(), copy) << "In place again, since only the store has the copy";
+
+		const auto held = store.find("/log.txt");
+		EXPECT_EQ(store.write(*node, 8, line, 4), 4u) << "Overwritten while held";
+		EXPECT_NE(node->content->data(), copy) << "Copied, since a caller of find has the content";
+		EXPECT_EQ(held->at(8), 'x') << "Held content unchanged";
+	}
+}
@@ -0,0 +1,102 @@
+// Copyright 2026 Rik Essenius
+// 
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file
+// except in compliance with the License. You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#include <gtest/gtest.h>
+#include "../esp32-mock/ESP.h"
+#include "../esp32-mock/FlashModel.h"
+
+namespace esp32_mock_test {
+	TEST(FlashModelTest, SequentialWriteTest) {
+		FlashModel flash;
+		EXPECT_EQ(flash.blockCount(), 256u) << "Default block count";
+		const auto start = testPeekMicros();
+		for (size_t offset = 0; offset < 8192; offset += 256) {
+			flash.write("/log.txt", offset, 256);
+		}
+		const auto& statistics = flash.statistics();
+		EXPECT_EQ(statistics.bytesWritten, 8192u) << "Bytes written";
+		EXPECT_EQ(statistics.pagesProgrammed, 32u) << "Each page programmed once";
+		EXPECT_EQ(statistics.blockErases, 0u) << "Fresh blocks need no erase";
+		EXPECT_DOUBLE_EQ(statistics.writeAmplification(), 1.0) << "Page aligned writes don't amplify";
+		EXPECT_EQ(statistics.busyMicros, 32u * 700u) << "Program time";
+		EXPECT_EQ(testPeekMicros() - start, 32 * 700) << "Program time charged to the clock";
+	}
+
+	TEST(FlashModelTest, RewriteTest) {
+		FlashModel flash;
+		flash.write("/data.bin", 0, 1024);
+		EXPECT_EQ(flash.statistics().pagesProgrammed, 4u) << "Four pages programmed";
+		const auto start = testPeekMicros();
+		flash.write("/data.bin", 300, 10);
+		const auto& statistics = flash.statistics();
+		EXPECT_EQ(statistics.blockErases, 1u) << "Rewriting a page erases its block";
+		EXPECT_EQ(flash.eraseCount(0), 1u) << "First block erased";
+		EXPECT_EQ(statistics.pagesProgrammed, 8u) << "Rewritten page and the three others that hold data";
+		EXPECT_EQ(testPeekMicros() - start, 45000 + 4 * 700) << "Erase and program time charged";
+		EXPECT_EQ(statistics.bytesProgrammed, 2048u) << "Rewritten bytes and the rest of the data";
+		EXPECT_DOUBLE_EQ(statistics.writeAmplification(), 2048.0 / 1034) << "Write amplification";
+
+		flash.write("/data.bin", 4000, 200);
+		EXPECT_EQ(flash.statistics().pagesProgrammed, 10u) << "Write across a block boundary programs two pages";
+		EXPECT_EQ(flash.statistics().blockErases, 1u) << "Both pages were erased already";
+	}
+
+	TEST(FlashModelTest, SmallAppendTest) {
+		FlashModel flash;
+		for (size_t record = 0; record < 10; record++) {
+			flash.write("/log.txt", record * 20, 20);
+		}
+		const auto& statistics = flash.statistics();
+		EXPECT_EQ(statistics.blockErases, 0u) << "Appends program erased bytes of the same page";
+		EXPECT_EQ(statistics.pagesProgrammed, 10u) << "A page program per append";
+		EXPECT_DOUBLE_EQ(statistics.writeAmplification(), 1.0) << "Only the appended bytes programmed";
+		EXPECT_EQ(statistics.busyMicros, 10u * 700u) << "Program time per append";
+
+		flash.write("/log.txt", 100, 1);
+		EXPECT_EQ(flash.statistics().blockErases, 1u) << "Overwriting a byte erases the block";
+		EXPECT_EQ(flash.statistics().pagesProgrammed, 11u) << "The data is in one page";
+		EXPECT_EQ(flash.statistics().bytesProgrammed, 400u) << "All data programmed again";
+	}
+
+	TEST(FlashModelTest, ProgramSizeTest) {
+		FlashModel flash(256, 4096, 256, 16);
+		EXPECT_EQ(flash.programSize(), 16u) << "Program size";
+		for (size_t record = 0; record < 4; record++) {
+			flash.write("/log.txt", record * 32, 32);
+		}
+		EXPECT_EQ(flash.statistics().blockErases, 0u) << "Appends of whole units need no erase";
+		flash.write("/log.txt", 128, 10);
+		flash.write("/log.txt", 138, 10);
+		EXPECT_EQ(flash.statistics().blockErases, 1u) << "Appending to a unit that was programmed erases";
+		EXPECT_EQ(flash.statistics().bytesProgrammed, 128u + 16u + 128u + 32u) << "Programmed in whole units";
+	}
+
+	TEST(FlashModelTest, ReleaseTest) {
+		FlashModel flash(2);
+		flash.write("/a.txt", 0, 256);
+		flash.write("/a.txt", 0, 256);
+		EXPECT_EQ(flash.eraseCount(0), 1u) << "Block 0 erased once";
+		flash.release("/a.txt");
+		flash.write("/b.txt", 0, 256);
+		EXPECT_EQ(flash.eraseCount(1), 0u) << "Unused block 1 was less worn, so it is picked";
+		flash.write("/c.txt", 0, 256);
+		EXPECT_EQ(flash.eraseCount(0), 2u) << "Reusing released block 0 erases it first";
+		flash.write("/c.txt", 4096, 1);
+		EXPECT_EQ(flash.blockCount(), 3u) << "Blocks added when they run out";
+		EXPECT_EQ(flash.eraseCount(5), 0u) << "Non-existing block";
+
+		flash.reset();
+		EXPECT_EQ(flash.blockCount(), 2u) << "Back to the initial block count";
+		EXPECT_EQ(flash.statistics().blockErases, 0u) << "Statistics cleared";
+		EXPECT_EQ(flash.eraseCount(0), 0u) << "Erase counters cleared";
+		EXPECT_DOUBLE_EQ(flash.statistics().writeAmplification(), 0.0) << "Nothing written";
+	}
+}
@@ -0,0 +1,158 @@
+// Copyright 2026 Rik Essenius
+// 
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file
+// except in compliance with the License. You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstring>
+#include "../esp32-mock/LittleFSImage.h"
+
+namespace esp32_mock_test {
+	namespace {
+		std::shared_ptr<FileData> content(const char* text) {
+			return std::make_shared<FileData>(text, text + strlen(text));
+		}
+
+		std::shared_ptr<FileData> pattern(const size_t size) {
+			const auto result = std::make_shared<FileData>(size);
+			for (size_t i = 0; i < size; i++) {
+				(*result)[i] = static_cast<uint8_t>(i * 7 + i / 251);
+			}
+			return result;
+		}
+
+		// CRC-32 without the final inversion, as LittleFS uses it
+		uint32_t crc32(uint32_t crc, const uint8_t* data, const size_t size) {
+			for (size_t i = 0; i < size; i++) {
+				crc ^= data[i];
+				for (int bit = 0; bit < 8; bit++) {
+					crc = (crc >> 1) ^ (0xedb88320 & (0 - (crc & 1)));
+				}
+			}
+			return crc;
+		}
+
+		void writeLe32(uint8_t* data, const uint32_t value) {
+			for (int i = 0; i < 4; i++) {
+				data[i] = static_cast<uint8_t>(value >> (8 * i));
+			}
+		}
+
+		// change a little endian value in the first metadata block, and fix the CRC of the commit that has it
+		bool patchMetadata(std::vector<uint8_t>& image, const uint32_t from, const uint32_t to) {
+			uint8_t old[4];
+			writeLe32(old, from);
+			const auto end = image.begin() + 4096;
+			const auto found = std::search(image.begin(), end, old, old + 4);
+			if (found == end) return false;
+			const auto position = static_cast<size_t>(found - image.begin());
+
+			// the commit CRC is the first value after it that matches the CRC of everything before it
+			auto crc = crc32(0xffffffff, image.data(), position + 4);
+			for (auto offset = position + 4; offset + 4 <= 4096; offset++) {
+				if (crc == (image[offset] | image[offset + 1] << 8 | image[offset + 2] << 16 |
+					static_cast<uint32_t>(image[offset + 3]) << 24)) {
+					writeLe32(image.data() + position, to);
+					writeLe32(image.data() + offset, crc32(0xffffffff, image.data(), offset));
+					return true;
+				}
+				crc = crc32(crc, image.data() + offset, 1);
+			}
+			return false;
+		}
+	}
+
+	TEST(LittleFSImageTest, SuperblockTest) {
+		const FileStore store;
+		std::vector<uint8_t> image;
+		ASSERT_TRUE(LittleFSImage::write(store, 512, 1024, image)) << "Empty store written";
+		ASSERT_EQ(image.size(), 512u * 1024u) << "Image size";
+
+		// the superblock as shown in the LittleFS specification: the revision, then the tags xor-ed with the previous one
+		const uint8_t expected[] = {
+			0x01, 0x00, 0x00, 0x00, 0xf0, 0x0f, 0xff, 0xf7, 'l', 'i', 't', 't', 'l', 'e', 'f', 's', 0x2f, 0xe0, 0x00, 0x10,
+			0x00, 0x00, 0x02, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00
+		};
+		EXPECT_EQ(memcmp(image.data(), expected, sizeof expected), 0) << "Superblock layout";
+		EXPECT_EQ(image[512], 0xff) << "Second block of the pair is erased";
+		EXPECT_EQ(image.back(), 0xff) << "Unused blocks are erased";
+
+		FileStore result;
+		result.store("/old.txt", content("old"));
+		EXPECT_TRUE(LittleFSImage::read(image.data(), image.size(), 512, result)) << "Read back";
+		EXPECT_TRUE(result.files().empty()) << "Old files gone";
+		EXPECT_EQ(result.capacity(), 512u * 1024u) << "Capacity from superblock";
+	}
+
+	TEST(LittleFSImageTest, RoundTripTest) {
+		FileStore store;
+		store.store("/config.json", content("{\"a\":1}"));
+		store.store("/empty.txt", std::make_shared<FileData>());
+		store.store("/logs/2026/01.log", pattern(3 * 4096 + 17));
+		store.store("/logs/2026/02.log", pattern(100000));
+		store.store("/logs/latest.txt", content("02"));
+		store.makeFolder("/spare");
+		for (int i = 0; i < 120; i++) {
+			const auto name = "/many/file" + std::to_string(i) + ".txt";
+			store.store(name, content(name.c_str()));
+		}
+		std::vector<uint8_t> image;
+		ASSERT_TRUE(LittleFSImage::write(store, 4096, 64, image)) << "Written";
+
+		FileStore result;
+		ASSERT_TRUE(LittleFSImage::read(image.data(), image.size(), 4096, result)) << "Read back";
+		EXPECT_EQ(result.usedBytes(), store.usedBytes()) << "Same used bytes";
+		// folders are explicit in an image, so the implicit ones in the store become folder entries
+		EXPECT_EQ(result.files().size(), store.files().size() + 3) << "Files, the spare folder and the implicit folders";
+		for (const auto& entry : store.files()) {
+			ASSERT_TRUE(result.exists(entry.first)) << entry.first << " exists";
+			if (entry.second == nullptr) {
+				EXPECT_TRUE(result.isFolder(entry.first)) << entry.first << " is a folder";
+				continue;
+			}
+			const auto file = result.find(entry.first);
+			ASSERT_NE(file, nullptr) << entry.first << " is a file";
+			EXPECT_EQ(*file, *entry.second) << entry.first << " has the same content";
+		}
+		EXPECT_EQ(result.capacity(), 64u * 4096u) << "Capacity";
+	}
+
+	TEST(LittleFSImageTest, FailTest) {
+		FileStore store;
+		store.store("/big.bin", pattern(20000));
+		std::vector<uint8_t> image;
+		EXPECT_FALSE(LittleFSImage::write(store, 4096, 4, image)) << "Doesn't fit";
+		store.store("/" + std::string(40, 'n'), content("long"));
+		EXPECT_FALSE(LittleFSImage::write(store, 4096, 64, image)) << "Name too long";
+
+		store.clear();
+		store.store("/a.txt", content("a"));
+		ASSERT_TRUE(LittleFSImage::write(store, 4096, 8, image)) << "Written";
+		FileStore result;
+		result.store("/keep.txt", content("keep"));
+		EXPECT_FALSE(LittleFSImage::read(image.data(), image.size(), 512, result)) << "Wrong block size";
+		EXPECT_FALSE(LittleFSImage::read(image.data(), 4096, 4096, result)) << "Truncated image";
+		image[50] ^= 0x01;
+		EXPECT_FALSE(LittleFSImage::read(image.data(), image.size(), 4096, result)) << "Corrupt metadata";
+		const std::vector<uint8_t> garbage(8 * 4096, 0x5a);
+		EXPECT_FALSE(LittleFSImage::read(garbage.data(), garbage.size(), 4096, result)) << "Not an image";
+
+		// a file size that the image can't hold, which must fail before allocating for it
+		store.clear();
+		store.store("/big.bin", pattern(0x12345));
+		ASSERT_TRUE(LittleFSImage::write(store, 4096, 64, image)) << "Big file written";
+		ASSERT_TRUE(LittleFSImage::read(image.data(), image.size(), 4096, result)) << "Big file read";
+		ASSERT_TRUE(patchMetadata(image, 0x12345, 0xfffffff0)) << "Size patched";
+		result.clear();
+		result.store("/keep.txt", content("keep"));
+		EXPECT_FALSE(LittleFSImage::read(image.data(), image.size(), 4096, result)) << "Corrupt file size";
+		EXPECT_NE(result.find("/keep.txt"), nullptr) << "Store unchanged after failures";
+	}
+}
@@ -0,0 +1,89 @@
+// Copyright 2026 Rik Essenius
+// 
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file
+// except in compliance with the License. You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#include <gtest/gtest.h>
+#include "../esp32-mock/ESP.h"
+
+namespace esp32_mock_test {
+	void addRecord(LogCapture& capture, const LogLevel level, const char* tag, const char* message, const int64_t timestamp) {
+		const LogRecord record{ level, nullptr, 0, timestamp, tag, message, strlen(message) };
+		capture.add(record);
+	}
+
+	TEST(LogCaptureTest, QueryTest) {
+		LogCapture capture;
+		EXPECT_EQ(capture.mark(), 0u) << "Mark 0 at start";
+		addRecord(capture, LogLevel::Info, "wifi", "connecting", 10);
+		addRecord(capture, LogLevel::Error, "wifi", "connect failed", 20);
+		const size_t mark = capture.mark();
+		addRecord(capture, LogLevel::Info, "mqtt", "connecting", 30);
+		addRecord(capture, LogLevel::Error, nullptr, "broker down", 40);
+		addRecord(capture, LogLevel::Error, "mqtt", "connect failed", 50);
+		EXPECT_EQ(mark, 2u) << "Mark after two entries";
+		EXPECT_EQ(capture.size(), 5u) << "Five entries";
+		EXPECT_EQ(capture.count(LogLevel::Error), 3u) << "Three errors";
+		EXPECT_EQ(capture.count(LogLevel::Error, mark), 2u) << "Two errors since mark";
+		EXPECT_EQ(capture.count(LogLevel::Warning), 0u) << "No warnings";
+
+		const LogEntry* entry = capture.find("connect failed");
+		ASSERT_NE(entry, nullptr) << "Found";
+		EXPECT_EQ(entry->timestamp, 20) << "First match";
+		EXPECT_EQ(entry->tag, "wifi") << "Tag kept";
+		entry = capture.find("connect failed", mark);
+		ASSERT_NE(entry, nullptr) << "Found since mark";
+		EXPECT_EQ(entry->timestamp, 50) << "First match since mark";
+		entry = capture.find("connecting", 0, "mqtt");
+		ASSERT_NE(entry, nullptr) << "Found with tag";
+		EXPECT_EQ(entry->timestamp, 30) << "Match with the tag";
+		entry = capture.find(LogLevel::Error, "down");
+		ASSERT_NE(entry, nullptr) << "Found via level index";
+		EXPECT_EQ(entry->tag, "") << "No tag";
+		EXPECT_EQ(capture.find(LogLevel::Info, "failed"), nullptr) << "No info entry with failed";
+		EXPECT_EQ(capture.find("nothing"), nullptr) << "Not found";
+
+		capture.clear(mark);
+		EXPECT_EQ(capture.size(), 3u) << "Three left";
+		EXPECT_EQ(capture.count(LogLevel::Error), 2u) << "Two errors left";
+		EXPECT_EQ(capture.find("connect failed")->timestamp, 50) << "Older match cleared";
+		EXPECT_EQ(capture.find(LogLevel::Info, "connecting")->timestamp, 30) << "Level index updated";
+		EXPECT_EQ(capture.mark(), 5u) << "Mark keeps counting";
+		capture.clear();
+		EXPECT_EQ(capture.size(), 0u) << "Cleared";
+		EXPECT_EQ(capture.count(LogLevel::Info), 0u) << "Index cleared";
+	}
+
+	TEST(LogCaptureTest, LogMacroTest) {
+		testSetRealTime(false);
+		Serial.testClearOutput();
+		LogCapture capture;
+		testSetLogCapture(&capture);
+		static const char* tag = "sensor";
+		ESP_LOGE(tag, "read failed: %d", -3);
+		ESP_LOGV(tag, "filtered");
+		log_w("low battery");
+		EXPECT_STREQ(Serial.testGetOutput(), "[E] sensor: read failed: -3\n[W] low battery\n") << "Printed with tag";
+		EXPECT_EQ(capture.count(LogLevel::Error), 1u) << "Error captured";
+		EXPECT_EQ(capture.count(LogLevel::Verbose), 0u) << "Verbose filtered";
+		ASSERT_NE(capture.find("read failed", 0, "sensor"), nullptr) << "Found by tag";
+		EXPECT_EQ(capture.find("read failed")->message, "read failed: -3") << "Message without prefix";
+
+		Serial.testClearOutput();
+		testSetLogCapture(&capture, false);
+		const size_t mark = capture.mark();
+		ESP_LOGI(tag, "quiet");
+		EXPECT_STREQ(Serial.testGetOutput(), "") << "Not printed";
+		EXPECT_NE(capture.find(LogLevel::Info, "quiet", mark), nullptr) << "But captured";
+		testSetLogCapture(nullptr);
+		log_i("printed again");
+		EXPECT_STREQ(Serial.testGetOutput(), "[I] printed again\n") << "Printing back on";
+		Serial.testClearOutput();
+	}
+}
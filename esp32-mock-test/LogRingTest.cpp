@@ -0,0 +1,129 @@
+// Copyright 2026 Rik Essenius
+// 
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file
+// except in compliance with the License. You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+#include "../esp32-mock/ESP.h"
+
+namespace esp32_mock_test {
+	struct ReceivedRecord {
+		LogLevel level;
+		TaskHandle_t task;
+		BaseType_t core;
+		int64_t timestamp;
+		const char* tag;
+		std::string message;
+	};
+
+	std::vector<ReceivedRecord> received;
+
+	void collect(const LogRecord& record) {
+		EXPECT_EQ(strlen(record.message), record.length) << "Length matches";
+		received.push_back({ record.level, record.task, record.core, record.timestamp, record.tag, record.message });
+	}
+
+	TEST(LogRingTest, SingleThreadTest) {
+		received.clear();
+		LogRing ring(collect, 3);
+		EXPECT_EQ(ring.slotCount(), 4u) << "Slot count rounded up to a power of two";
+		const auto task = reinterpret_cast<TaskHandle_t>(7);
+		for (int i = 0; i < 10; i++) {
+			ring.log(LogLevel::Info, task, 1, i * 10, "main", "message %d", i);
+		}
+		ASSERT_EQ(received.size(), 10u) << "All records handled right away";
+		EXPECT_EQ(received[3].message, "message 3") << "Message formatted";
+		EXPECT_EQ(received[3].timestamp, 30) << "Timestamp kept";
+		EXPECT_EQ(received[3].task, task) << "Task kept";
+		EXPECT_EQ(received[3].core, 1) << "Core kept";
+		EXPECT_STREQ(received[3].tag, "main") << "Tag kept";
+		const std::string longText(1000, 'y');
+		ring.log(LogLevel::Error, task, 0, 0, nullptr, "long %s", longText.c_str());
+		ASSERT_EQ(received.size(), 11u) << "Long record handled";
+		EXPECT_EQ(received[10].message, "long " + longText) << "Long message intact";
+	}
+
+	TEST(LogRingTest, ConcurrentTest) {
+		received.clear();
+		constexpr int kThreads = 4;
+		constexpr int kMessages = 20000;
+		{
+			LogRing ring(collect, 8);
+			std::vector<std::thread> threads;
+			for (int thread = 0; thread < kThreads; thread++) {
+				threads.emplace_back([&ring, thread] {
+					const auto task = reinterpret_cast<TaskHandle_t>(static_cast<uintptr_t>(100 + thread));
+					for (int i = 0; i < kMessages; i++) {
+						ring.log(LogLevel::Debug, task, thread % 2, i, nullptr, "task %d message %d end", thread, i);
+					}
+				});
+			}
+			for (auto& thread : threads) {
+				thread.join();
+			}
+		}
+		ASSERT_EQ(received.size(), static_cast<size_t>(kThreads * kMessages)) << "Nothing lost";
+		int next[kThreads] = {};
+		int failures = 0;
+		for (const auto& record : received) {
+			int thread = -1;
+			int message = -1;
+			char end[4] = {};
+			const bool parsed = sscanf(record.message.c_str(), "task %d message %d %3s", &thread, &message, end) == 3;
+			if (!parsed || thread < 0 || thread >= kThreads || strcmp(end, "end") != 0 || message != next[thread] ||
+				record.task != reinterpret_cast<TaskHandle_t>(static_cast<uintptr_t>(100 + thread)) ||
+				record.core != thread % 2 || record.timestamp != message) {
+				failures++;
+				continue;
+			}
+			next[thread]++;
+		}
+		EXPECT_EQ(failures, 0) << "Records intact, tagged and in order per task";
+	}
+
+	namespace {
+		LogRing* echoRing = nullptr;
+		int echoCount = 0;
+
+		// logs from the handler, like a listener that reports what it received
+		void echo(const LogRecord& record) {
+			collect(record);
+			if (strcmp(record.tag, "outer") == 0) {
+				for (int i = 0; i < echoCount; i++) {
+					echoRing->log(record.level, record.task, record.core, record.timestamp, "inner", "echo %d of %s", i, record.message);
+				}
+			}
+		}
+	}
+
+	TEST(LogRingTest, HandlerLogsTest) {
+		received.clear();
+		LogRing ring(echo, 4);
+		echoRing = &ring;
+		echoCount = 1;
+		ring.log(LogLevel::Info, nullptr, 0, 1, "outer", "first");
+		ring.log(LogLevel::Info, nullptr, 0, 2, "outer", "second");
+		ASSERT_EQ(received.size(), 4u) << "Records logged by the handler handled too";
+		EXPECT_EQ(received[1].message, "echo 0 of first") << "Echo after the record that caused it";
+		EXPECT_STREQ(received[1].tag, "inner") << "Echo tagged";
+		EXPECT_EQ(received[3].message, "echo 0 of second") << "Second echo last";
+
+		// more than the ring holds, so the handler has to make room itself
+		received.clear();
+		echoCount = 10;
+		ring.log(LogLevel::Info, nullptr, 0, 3, "outer", "third");
+		ASSERT_EQ(received.size(), 11u) << "All echoes handled";
+		for (int i = 0; i < 10; i++) {
+			EXPECT_EQ(received[i + 1].message, "echo " + std::to_string(i) + " of third") << "Echoes in order";
+		}
+		echoRing = nullptr;
+	}
+}
@@ -9,6 +9,8 @@
 // is distributed on an "AS IS" BASIS WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 // See the License for the specific language governing permissions and limitations under the License.
 
+#include <cmath>
+#include <cstring>
 #include <fstream>
 #include <gtest/gtest.h>
 #include "../esp32-mock/Preferences.h"
@@ -76,4 +78,233 @@ namespace esp32_mock_test {
 		preferences.testReset();
 	}
 
+	TEST(PreferencesTest, CacheTest) {
+		Preferences::testReset();
+		Preferences writer;
+		writer.begin("first");
+		writer.putUInt("count", 1);
+		writer.end();
+		writer.begin("second");
+		writer.putString("name", "value");
+		writer.end();
+		std::ifstream existing("preferences.txt");
+		EXPECT_TRUE(existing.good()) << "Changes written at end";
+		existing.close();
+
+		(void)std::remove("preferences.txt");
+		Preferences reader;
+		for (int i = 0; i < 3; i++) {
+			reader.begin("first");
+			EXPECT_EQ(reader.getUInt("count", 0), 1u) << "Value from the cache";
+			reader.putUInt("count", 1);
+			reader.end();
+		}
+		std::ifstream untouched("preferences.txt");
+		EXPECT_FALSE(untouched.good()) << "Nothing written if nothing changed";
+		untouched.close();
+
+		reader.begin("first");
+		reader.putUInt("count", 2);
+		EXPECT_EQ(writer.getUInt("count", 0), 0u) << "Ended instance does not read";
+		writer.begin("first");
+		EXPECT_EQ(writer.getUInt("count", 0), 2u) << "Other instance sees the change before it is saved";
+		writer.end();
+		Preferences::testCommit();
+		reader.end();
+
+		Preferences::testReload();
+		reader.begin("second");
+		EXPECT_STREQ(reader.getString("name").c_str(), "value") << "Unchanged namespace kept";
+		reader.end();
+		reader.begin("first");
+		EXPECT_EQ(reader.getUInt("count", 0), 2u) << "Changed namespace saved";
+		reader.putUInt("count", 3);
+		reader.end();
+
+		Preferences::testReload();
+		reader.begin("first");
+		EXPECT_EQ(reader.getUInt("count", 0), 3u) << "Change saved at end after reload";
+		reader.clear();
+		reader.end();
+		Preferences::testReload();
+		reader.begin("first");
+		EXPECT_FALSE(reader.isKey("count")) << "Clear saved";
+		reader.end();
+		Preferences::testReset();
+	}
+
+	TEST(PreferencesTest, TypesTest) {
+		Preferences::testReset();
+		Preferences preferences;
+		ASSERT_TRUE(preferences.begin("types")) << "Started";
+		EXPECT_FALSE(preferences.begin("other")) << "Can't start twice";
+		EXPECT_EQ(preferences.putChar("i8", -8), 1u) << "putChar size";
+		EXPECT_EQ(preferences.putUChar("u8", 200), 1u) << "putUChar size";
+		EXPECT_EQ(preferences.putShort("i16", -16000), 2u) << "putShort size";
+		EXPECT_EQ(preferences.putUShort("u16", 60000), 2u) << "putUShort size";
+		EXPECT_EQ(preferences.putInt("i32", -2000000000), 4u) << "putInt size";
+		EXPECT_EQ(preferences.putUInt("u32", 4000000000u), 4u) << "putUInt size";
+		EXPECT_EQ(preferences.putLong64("i64", -9000000000000000000LL), 8u) << "putLong64 size";
+		EXPECT_EQ(preferences.putULong64("u64", 18000000000000000000ULL), 8u) << "putULong64 size";
+		EXPECT_EQ(preferences.putFloat("float", 1.5f), sizeof(float)) << "putFloat size";
+		EXPECT_EQ(preferences.putDouble("double", -0.1), sizeof(double)) << "putDouble size";
+		EXPECT_EQ(preferences.putString("a:u8", "colon"), 5u) << "putString size";
+		constexpr uint8_t blob[] = { 0x00, 0x0a, 0xff, 0x23 };
+		EXPECT_EQ(preferences.putBytes("blob", blob, sizeof blob), sizeof blob) << "putBytes size";
+		preferences.end();
+
+		Preferences::testReload();
+		ASSERT_TRUE(preferences.begin("types", true)) << "Started read only";
+		EXPECT_EQ(preferences.getChar("i8"), -8) << "getChar";
+		EXPECT_EQ(preferences.getUChar("u8"), 200) << "getUChar";
+		EXPECT_EQ(preferences.getShort("i16"), -16000) << "getShort";
+		EXPECT_EQ(preferences.getUShort("u16"), 60000) << "getUShort";
+		EXPECT_EQ(preferences.getInt("i32"), -2000000000) << "getInt";
+		EXPECT_EQ(preferences.getLong("i32"), -2000000000) << "getLong is getInt";
+		EXPECT_EQ(preferences.getUInt("u32"), 4000000000u) << "getUInt";
+		EXPECT_EQ(preferences.getULong("u32"), 4000000000u) << "getULong is getUInt";
+		EXPECT_EQ(preferences.getLong64("i64"), -9000000000000000000LL) << "getLong64";
+		EXPECT_EQ(preferences.getULong64("u64"), 18000000000000000000ULL) << "getULong64";
+		EXPECT_FLOAT_EQ(preferences.getFloat("float"), 1.5f) << "getFloat";
+		EXPECT_DOUBLE_EQ(preferences.getDouble("double"), -0.1) << "getDouble";
+		EXPECT_STREQ(preferences.getString("a:u8").c_str(), "colon") << "Key with a colon stays a string";
+
+		EXPECT_EQ(preferences.getType("u16"), PT_U16) << "getType u16";
+		EXPECT_EQ(preferences.getType("float"), PT_BLOB) << "Floats are blobs";
+		EXPECT_EQ(preferences.getType("a:u8"), PT_STR) << "getType string";
+		EXPECT_EQ(preferences.getType("missing"), PT_INVALID) << "getType missing";
+
+		EXPECT_EQ(preferences.getBytesLength("blob"), sizeof blob) << "getBytesLength";
+		EXPECT_EQ(preferences.getBytesLength("u8"), 0u) << "getBytesLength on a number";
+		uint8_t buffer[8] = {};
+		EXPECT_EQ(preferences.getBytes("blob", buffer, 3), 0u) << "getBytes with a buffer that is too small";
+		EXPECT_EQ(preferences.getBytes("blob", buffer, sizeof buffer), sizeof blob) << "getBytes";
+		EXPECT_EQ(memcmp(buffer, blob, sizeof blob), 0) << "getBytes content";
+		char text[8];
+		EXPECT_EQ(preferences.getString("a:u8", text, 5), 0u) << "getString without room for the terminator";
+		EXPECT_EQ(preferences.getString("a:u8", text, sizeof text), 6u) << "getString into a buffer";
+		EXPECT_STREQ(text, "colon") << "getString buffer content";
+
+		EXPECT_EQ(preferences.getUInt("u8", 7), 7u) << "Another type gives the default";
+		EXPECT_EQ(preferences.getInt("missing", -1), -1) << "Missing key gives the default";
+		EXPECT_TRUE(std::isnan(preferences.getFloat("double"))) << "Double isn't a float";
+		EXPECT_STREQ(preferences.getString("u8", "default").c_str(), "default") << "Number isn't a string";
+
+		EXPECT_EQ(preferences.putUInt("u32", 1), 0u) << "Read only put fails";
+		EXPECT_FALSE(preferences.remove("u32")) << "Read only remove fails";
+		EXPECT_FALSE(preferences.clear()) << "Read only clear fails";
+		preferences.end();
+
+		preferences.begin("types");
+		EXPECT_TRUE(preferences.remove("u32")) << "remove existing key";
+		EXPECT_FALSE(preferences.remove("u32")) << "remove missing key";
+		EXPECT_FALSE(preferences.isKey("u32")) << "Removed";
+		preferences.putString("i8", "now a string");
+		EXPECT_EQ(preferences.getType("i8"), PT_STR) << "Put with another type replaces the value";
+		preferences.end();
+		Preferences::testReset();
+	}
+
+	TEST(PreferencesTest, FreeEntriesTest) {
+		Preferences::testReset();
+		Preferences preferences;
+		const auto initial = preferences.freeEntries();
+		EXPECT_EQ(initial, 504u) << "Empty partition";
+		preferences.begin("entries");
+		EXPECT_EQ(preferences.freeEntries(), initial - 1) << "Namespace takes an entry";
+		preferences.putUInt("number", 1);
+		EXPECT_EQ(preferences.freeEntries(), initial - 2) << "Number takes an entry";
+		preferences.putString("text", std::string(40, 'x').c_str());
+		EXPECT_EQ(preferences.freeEntries(), initial - 5) << "41 bytes string takes 1 + 2 entries";
+		const std::string big(32 * 400, 'b');
+		EXPECT_EQ(preferences.putBytes("big", big.data(), big.size()), big.size()) << "Big blob fits";
+		EXPECT_EQ(preferences.freeEntries(), initial - 406) << "Blob takes 1 + 400 entries";
+		EXPECT_EQ(preferences.putBytes("big2", big.data(), big.size()), 0u) << "Second one doesn't fit";
+		EXPECT_FALSE(preferences.isKey("big2")) << "Not stored";
+		const std::string bigger(32 * 401, 'b');
+		EXPECT_EQ(preferences.putBytes("big", bigger.data(), bigger.size()), bigger.size()) << "Replacing reuses the entries";
+		preferences.remove("big");
+		EXPECT_EQ(preferences.freeEntries(), initial - 5) << "Removing frees the entries";
+		preferences.end();
+		Preferences::testReset();
+	}
+
+	TEST(PreferencesTest, BadDataTest) {
+		std::ofstream stream;
+		stream.open("preferences.txt");
+		stream << "bad\nn1:u32=12x\nn2:i8=\nn3:u64=99999999999999999999\nb1:blob=0g\nb2:blob=123\ns1=#x\ngood:i32=-5\nb3:blob=0aFF\n";
+		stream.close();
+		Preferences::testReload();
+		Preferences preferences;
+		preferences.begin("bad");
+		EXPECT_FALSE(preferences.isKey("n1")) << "Trailing garbage skipped";
+		EXPECT_FALSE(preferences.isKey("n2")) << "Empty number skipped";
+		EXPECT_FALSE(preferences.isKey("n3")) << "Overflow skipped";
+		EXPECT_FALSE(preferences.isKey("b1")) << "Bad hex skipped";
+		EXPECT_FALSE(preferences.isKey("b2")) << "Odd hex skipped";
+		EXPECT_STREQ(preferences.getString("s1").c_str(), "#x") << "Bad line count is a plain string";
+		EXPECT_EQ(preferences.getInt("good"), -5) << "Good number read";
+		EXPECT_EQ(preferences.getBytesLength("b3"), 2u) << "Good blob read";
+		preferences.end();
+		Preferences::testReset();
+	}
+
+	TEST(PreferencesTest, ResetWhileBegunTest) {
+		Preferences::testReset();
+		// like a global instance in the code under test, that stays begun between tests
+		Preferences preferences;
+		preferences.begin("global");
+		preferences.putUInt("count", 5);
+		Preferences::testCommit();
+		Preferences::testReload();
+		EXPECT_EQ(preferences.getUInt("count", 99), 5u) << "Begun instance reads the reloaded cache";
+		preferences.putUInt("count", 6);
+		Preferences::testReset();
+		EXPECT_EQ(preferences.getUInt("count", 99), 99u) << "Begun instance sees the reset";
+		EXPECT_FALSE(preferences.isKey("count")) << "No key after reset";
+		EXPECT_EQ(preferences.putUInt("count", 7), 4u) << "Begun instance can still put";
+		preferences.end();
+		Preferences::testReload();
+		preferences.begin("global");
+		EXPECT_EQ(preferences.getUInt("count", 99), 7u) << "Put after reset saved";
+		preferences.end();
+		Preferences::testReset();
+	}
+
+	TEST(PreferencesTest, LegacyFileTest) {
+		// as written by the mock when it stored everything as text
+		std::ofstream stream;
+		stream.open("preferences.txt");
+		stream << "legacy\nbig=5000000000\nbytes1=1@%:e~\ncount=5\nflag=1\nmultiline=#2\nmulti\nline\nname=value\nnegative=-3\n\n";
+		stream.close();
+		Preferences::testReload();
+		Preferences preferences;
+		preferences.begin("legacy");
+		EXPECT_EQ(preferences.getUInt("count", 99), 5u) << "Legacy putUInt value read as a number";
+		EXPECT_EQ(preferences.getUChar("count", 99), 5) << "Legacy number read as another type it fits in";
+		EXPECT_TRUE(preferences.getBool("flag", false)) << "Legacy putBool value";
+		EXPECT_EQ(preferences.getInt("negative"), -3) << "Legacy negative number";
+		EXPECT_EQ(preferences.getUInt("negative", 7), 7u) << "Negative doesn't fit an unsigned type";
+		EXPECT_EQ(preferences.getLong64("big"), 5000000000LL) << "Legacy 64 bit number";
+		EXPECT_EQ(preferences.getUInt("big", 1), 1u) << "Too big for 32 bits";
+		EXPECT_EQ(preferences.getUInt("name", 2), 2u) << "Text isn't a number";
+		EXPECT_STREQ(preferences.getString("count").c_str(), "5") << "Legacy number still reads as a string";
+		EXPECT_STREQ(preferences.getString("multiline").c_str(), "multi\nline\n") << "Legacy multiline string";
+		EXPECT_EQ(preferences.getType("count"), PT_STR) << "Legacy values are strings";
+		EXPECT_EQ(preferences.getBytesLength("bytes1"), 6u) << "Legacy putBytes value read as a blob";
+		char buffer[6];
+		EXPECT_EQ(preferences.getBytes("bytes1", buffer, sizeof buffer), 6u) << "getBytes on a legacy value";
+		EXPECT_EQ(strncmp(buffer, "1@%:e~", 6), 0) << "Legacy blob content";
+
+		preferences.putUInt("added", 1);
+		preferences.end();
+		Preferences::testReload();
+		preferences.begin("legacy");
+		EXPECT_EQ(preferences.getUInt("count", 99), 5u) << "Legacy value still a number after saving";
+		EXPECT_EQ(preferences.getUInt("added", 99), 1u) << "New value saved";
+		preferences.putUInt("count", 6);
+		EXPECT_EQ(preferences.getType("count"), PT_U32) << "Putting replaces a legacy value with a typed one";
+		preferences.end();
+		Preferences::testReset();
+	}
 }
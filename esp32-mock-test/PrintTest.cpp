@@ -0,0 +1,127 @@
+// Copyright 2026 Rik Essenius
+// 
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file
+// except in compliance with the License. You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#include <gtest/gtest.h>
+#include "../esp32-mock/Print.h"
+
+namespace esp32_mock_test {
+	class StringPrint : public Print {
+	public:
+		using Print::write;
+		size_t write(const uint8_t value) override {
+			text.push_back(static_cast<char>(value));
+			singleWrites++;
+			return 1;
+		}
+
+		size_t write(const uint8_t* buffer, const size_t size) override {
+			text.append(reinterpret_cast<const char*>(buffer), size);
+			bulkWrites++;
+			return size;
+		}
+
+		std::string take() {
+			std::string result;
+			result.swap(text);
+			return result;
+		}
+
+		std::string text;
+		int singleWrites = 0;
+		int bulkWrites = 0;
+	};
+
+	class BytePrint : public Print {
+	public:
+		using Print::write;
+		size_t write(const uint8_t value) override {
+			text.push_back(static_cast<char>(value));
+			return 1;
+		}
+
+		std::string text;
+	};
+
+	TEST(PrintTest, IntegerTest) {
+		StringPrint print;
+		EXPECT_EQ(print.print(0), 1u) << "Length of 0";
+		EXPECT_EQ(print.take(), "0") << "Zero";
+		print.print(-1234);
+		EXPECT_EQ(print.take(), "-1234") << "Negative int";
+		print.print(255, HEX);
+		EXPECT_EQ(print.take(), "FF") << "Hex";
+		print.print(5u, BIN);
+		EXPECT_EQ(print.take(), "101") << "Binary";
+		print.print(8, OCT);
+		EXPECT_EQ(print.take(), "10") << "Octal";
+		print.print(-1, HEX);
+		EXPECT_EQ(print.take(), "FFFFFFFF") << "Negative int in hex shows the bits";
+		print.print(static_cast<unsigned char>(200));
+		EXPECT_EQ(print.take(), "200") << "Unsigned char prints as number";
+		print.print('x');
+		EXPECT_EQ(print.take(), "x") << "Char prints as character";
+		print.print(-9223372036854775807LL - 1);
+		EXPECT_EQ(print.take(), "-9223372036854775808") << "Minimum long long";
+		print.print(18446744073709551615ULL);
+		EXPECT_EQ(print.take(), "18446744073709551615") << "Maximum unsigned long long";
+		print.print(12345678UL);
+		EXPECT_EQ(print.take(), "12345678") << "Unsigned long";
+		print.print(42, 1);
+		EXPECT_EQ(print.take(), "42") << "Invalid base falls back to decimal";
+		EXPECT_EQ(print.singleWrites, 1) << "Only the char used a single byte write";
+	}
+
+	TEST(PrintTest, FloatTest) {
+		StringPrint print;
+		print.print(3.14159);
+		EXPECT_EQ(print.take(), "3.14") << "Two decimals by default";
+		print.print(1.999, 2);
+		EXPECT_EQ(print.take(), "2.00") << "Rounded";
+		print.print(-0.5, 3);
+		EXPECT_EQ(print.take(), "-0.500") << "Negative";
+		print.print(2.5, 0);
+		EXPECT_EQ(print.take(), "3") << "No decimals";
+		print.print(0.0 / 0.0);
+		EXPECT_EQ(print.take(), "nan") << "NaN";
+		print.print(1.0 / 0.0);
+		EXPECT_EQ(print.take(), "inf") << "Infinity";
+		print.print(5e9);
+		EXPECT_EQ(print.take(), "ovf") << "Overflow";
+		print.print(123.456f, 1);
+		EXPECT_EQ(print.take(), "123.5") << "Float";
+		EXPECT_EQ(print.singleWrites, 0) << "No single byte writes";
+	}
+
+	TEST(PrintTest, PrintlnPrintfTest) {
+		StringPrint print;
+		print.println("text");
+		print.println(42);
+		print.println(String("string"));
+		print.println(1.5, 1);
+		print.println();
+		EXPECT_EQ(print.take(), "text\n42\nstring\n1.5\n\n") << "Lines";
+		EXPECT_EQ(print.printf("%s=%d", "a", 1), 3) << "printf length";
+		const std::string longText(300, 'z');
+		print.printf("%s", longText.c_str());
+		EXPECT_EQ(print.take(), "a=1" + longText) << "printf short and long";
+		EXPECT_EQ(print.singleWrites, 0) << "No single byte writes";
+	}
+
+	TEST(PrintTest, DefaultBulkWriteTest) {
+		BytePrint print;
+		const uint8_t data[] = { 'a', 0, 'b' };
+		EXPECT_EQ(print.write(data, sizeof data), 3u) << "Bulk write falls back to single bytes";
+		EXPECT_EQ(print.write("cd"), 2u) << "Write string";
+		EXPECT_EQ(print.write(static_cast<const char*>(nullptr)), 0u) << "Write nullptr";
+		EXPECT_EQ(print.text, std::string("a\0bcd", 5)) << "Binary safe";
+		EXPECT_EQ(print.availableForWrite(), 0) << "availableForWrite default";
+	}
+}
@@ -0,0 +1,67 @@
+// Copyright 2026 Rik Essenius
+// 
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file
+// except in compliance with the License. You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "../esp32-mock/ReadWriteLock.h"
+
+namespace esp32_mock_test {
+	TEST(ReadWriteLockTest, ReadersShareTest) {
+		ReadWriteLock lock;
+		std::atomic<int> inside{0};
+		std::atomic<int> maxInside{0};
+		std::vector<std::thread> readers;
+		for (int i = 0; i < 4; i++) {
+			readers.emplace_back([&] {
+				ReadWriteLock::ReadGuard guard(lock);
+				const auto now = ++inside;
+				for (auto seen = maxInside.load(); now > seen && !maxInside.compare_exchange_weak(seen, now);) {}
+				while (maxInside < 2) {
+					std::this_thread::yield();
+				}
+				--inside;
+			});
+		}
+		for (auto& reader : readers) {
+			reader.join();
+		}
+		EXPECT_GE(maxInside.load(), 2) << "Readers held the lock at the same time";
+	}
+
+	TEST(ReadWriteLockTest, WriterExcludesTest) {
+		ReadWriteLock lock;
+		long long counter = 0;
+		long long consistentReads = 0;
+		std::vector<std::thread> threads;
+		for (int i = 0; i < 4; i++) {
+			threads.emplace_back([&] {
+				for (int j = 0; j < 10000; j++) {
+					std::lock_guard<ReadWriteLock> guard(lock);
+					counter++;
+				}
+			});
+		}
+		threads.emplace_back([&] {
+			for (int j = 0; j < 10000; j++) {
+				ReadWriteLock::ReadGuard guard(lock);
+				const auto first = counter;
+				if (counter == first) consistentReads++;
+			}
+		});
+		for (auto& thread : threads) {
+			thread.join();
+		}
+		EXPECT_EQ(counter, 40000) << "No increments lost";
+		EXPECT_EQ(consistentReads, 10000) << "Writers didn't run while reading";
+	}
+}
@@ -0,0 +1,79 @@
+// Copyright 2026 Rik Essenius
+// 
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file
+// except in compliance with the License. You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#include <fstream>
+#include <sstream>
+#include <gtest/gtest.h>
+#include "../esp32-mock/ESP.h"
+
+namespace esp32_mock_test {
+	class SerialSinkTest : public testing::Test {
+	public:
+		static std::string readFile(const char* path) {
+			const std::ifstream stream(path, std::ios::binary);
+			std::stringstream content;
+			content << stream.rdbuf();
+			return content.str();
+		}
+
+		static constexpr auto kFileName = "serialSinkTest.txt";
+	};
+
+	TEST_F(SerialSinkTest, FileSinkTest) {
+		Serial.begin(115200);
+		{
+			FileSerialSink sink(kFileName, false, 8);
+			EXPECT_TRUE(sink.isOpen()) << "File opened";
+			Serial.testSetOutputSink(&sink, false);
+			Serial.print("abc");
+			EXPECT_EQ(readFile(kFileName), "") << "Small writes are batched";
+			Serial.printf("%d", 123456);
+			EXPECT_EQ(readFile(kFileName), "abc") << "First batch written when the buffer is full";
+			Serial.println("0123456789");
+			EXPECT_EQ(readFile(kFileName), "abc1234560123456789") << "Write larger than the buffer goes out directly";
+			Serial.flush();
+			EXPECT_EQ(readFile(kFileName), "abc1234560123456789\n") << "flush writes the rest";
+			EXPECT_STREQ(Serial.testGetOutput(), "") << "Output not captured";
+
+			Serial.testSetOutputSink(&sink, true);
+			Serial.print("x");
+			EXPECT_STREQ(Serial.testGetOutput(), "x") << "Output captured as well";
+			Serial.testSetOutputSink(nullptr);
+			EXPECT_EQ(readFile(kFileName), "abc1234560123456789\nx") << "Removing the sink flushes it";
+			Serial.print("y");
+		}
+		EXPECT_EQ(readFile(kFileName), "abc1234560123456789\nx") << "Output after removing the sink is not sent to it";
+		{
+			FileSerialSink sink(kFileName, true);
+			sink.write("z", 1);
+		}
+		EXPECT_EQ(readFile(kFileName), "abc1234560123456789\nxz") << "Append mode, flushed on destruction";
+		EXPECT_STREQ(Serial.testGetOutput(), "xy");
+		(void)std::remove(kFileName);
+	}
+
+	TEST_F(SerialSinkTest, StreamSinkTest) {
+		FILE* stream = std::fopen(kFileName, "wb");
+		{
+			FileSerialSink sink(stream);
+			sink.write("stream", 6);
+		}
+		std::fputs("!", stream);
+		std::fclose(stream);
+		EXPECT_EQ(readFile(kFileName), "stream!") << "Stream written, but not closed by the sink";
+		(void)std::remove(kFileName);
+
+		FileSerialSink badSink("nonexisting/folder/file.txt");
+		EXPECT_FALSE(badSink.isOpen()) << "Cannot open file in non-existing folder";
+		badSink.write("x", 1);
+		badSink.flush();
+	}
+}
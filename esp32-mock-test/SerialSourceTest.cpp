@@ -0,0 +1,83 @@
+// Copyright 2026 Rik Essenius
+// 
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file
+// except in compliance with the License. You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#include <fstream>
+#include <gtest/gtest.h>
+#include "../esp32-mock/ESP.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace esp32_mock_test {
+	class SerialSourceTest : public testing::Test {
+	public:
+		static constexpr auto kFileName = "serialSourceTest.txt";
+	};
+
+	TEST_F(SerialSourceTest, FileSourceTest) {
+		std::string content;
+		for (int i = 0; i < 2000; i++) {
+			content += "command " + std::to_string(i) + '\n';
+		}
+		content += std::string("binary\0data", 11);
+		{
+			std::ofstream stream(kFileName, std::ios::binary);
+			stream << content;
+		}
+		Serial.begin(115200);
+		FileSerialSource source(kFileName);
+		EXPECT_TRUE(source.isOpen()) << "File opened";
+		Serial.testSetInputSource(&source);
+		EXPECT_EQ(Serial.available(), 4096) << "First chunk read";
+		for (int i = 0; i < 2000; i++) {
+			const auto line = Serial.readStringUntil('\n');
+			ASSERT_EQ(std::string(line.c_str()), "command " + std::to_string(i)) << "line " << i;
+		}
+		char buffer[20] = {};
+		EXPECT_EQ(Serial.readBytes(buffer, sizeof buffer), 11u) << "Binary tail read";
+		EXPECT_EQ(memcmp(buffer, "binary\0data", 11), 0) << "Null byte kept";
+		EXPECT_EQ(Serial.available(), 0) << "All read";
+		EXPECT_EQ(Serial.read(), -1) << "Nothing left";
+		Serial.testSetInputSource(nullptr);
+		(void)std::remove(kFileName);
+
+		FileSerialSource badSource("nonexisting/folder/file.txt");
+		EXPECT_FALSE(badSource.isOpen()) << "Cannot open file in non-existing folder";
+		uint8_t byte;
+		EXPECT_EQ(badSource.read(&byte, 1), 0u) << "Nothing to read from a source that isn't open";
+	}
+
+#ifndef _WIN32
+	TEST_F(SerialSourceTest, PipeSourceTest) {
+		constexpr auto kPipeName = "serialSourceTest.fifo";
+		(void)std::remove(kPipeName);
+		ASSERT_EQ(mkfifo(kPipeName, 0600), 0) << "Pipe created";
+		FileSerialSource source(kPipeName);
+		ASSERT_TRUE(source.isOpen()) << "Opening a pipe doesn't wait for a writer";
+		const int writer = open(kPipeName, O_WRONLY);
+		ASSERT_GE(writer, 0) << "Writer opened";
+		Serial.begin(115200);
+		Serial.testSetInputSource(&source);
+		EXPECT_EQ(Serial.available(), 0) << "Reading an empty pipe doesn't block";
+		EXPECT_EQ(write(writer, "hello\n", 6), 6);
+		EXPECT_STREQ(Serial.readStringUntil('\n').c_str(), "hello") << "Data from the pipe";
+		EXPECT_EQ(write(writer, "more", 4), 4);
+		EXPECT_EQ(Serial.available(), 4) << "More data arrives later";
+		close(writer);
+		Serial.testSetInputSource(nullptr);
+		Serial.testClearInput();
+		(void)std::remove(kPipeName);
+	}
+#endif
+}
@@ -0,0 +1,55 @@
+// Copyright 2026 Rik Essenius
+// 
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file
+// except in compliance with the License. You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#include <gtest/gtest.h>
+#include "../esp32-mock/Stream.h"
+
+namespace esp32_mock_test {
+	// only implements the single byte operations, so we test the defaults
+	class StringStream : public Stream {
+	public:
+		explicit StringStream(const char* input) : _input(input) {}
+		int available() override { return static_cast<int>(_input.size() - _position); }
+		int peek() override { return _position < _input.size() ? static_cast<uint8_t>(_input[_position]) : -1; }
+		int read() override { return _position < _input.size() ? static_cast<uint8_t>(_input[_position++]) : -1; }
+		size_t write(uint8_t /*value*/) override { return 0; }
+	private:
+		std::string _input;
+		size_t _position = 0;
+	};
+
+	TEST(StreamTest, ReadTest) {
+		StringStream stream("line 1\nline 2\nrest");
+		EXPECT_EQ(stream.getTimeout(), 1000ul) << "Default timeout";
+		stream.setTimeout(10);
+		EXPECT_EQ(stream.getTimeout(), 10ul) << "Timeout set";
+		EXPECT_STREQ(stream.readStringUntil('\n').c_str(), "line 1") << "First line";
+		char buffer[10] = {};
+		EXPECT_EQ(stream.readBytesUntil('\n', buffer, sizeof buffer), 6u) << "Read until terminator";
+		EXPECT_STREQ(buffer, "line 2") << "Second line";
+		uint8_t bytes[2] = {};
+		EXPECT_EQ(stream.readBytes(bytes, sizeof bytes), 2u) << "Read bytes";
+		EXPECT_EQ(bytes[1], 'e') << "Bytes read";
+		EXPECT_STREQ(stream.readString().c_str(), "st") << "The rest";
+		EXPECT_EQ(stream.readBytes(buffer, sizeof buffer), 0u) << "Nothing left";
+		EXPECT_STREQ(stream.readStringUntil('\n').c_str(), "") << "Nothing left until";
+	}
+
+	TEST(StreamTest, FindTest) {
+		StringStream stream("key: aab aaab; end");
+		EXPECT_TRUE(stream.find("aaab")) << "Found after a partial match";
+		EXPECT_EQ(stream.read(), ';') << "Position right after the target";
+		EXPECT_TRUE(stream.find(' ')) << "Found a character";
+		EXPECT_TRUE(stream.find("")) << "Empty target is always found";
+		EXPECT_FALSE(stream.find("x")) << "Not found";
+		EXPECT_EQ(stream.available(), 0) << "Read everything when not found";
+	}
+}
@@ -11,6 +11,7 @@
 
 #include <gtest/gtest.h>
 #include "../esp32-mock/WiFi.h"
+#include "../esp32-mock/WiFiClient.h"
 
 namespace esp32_mock_test {
 	TEST(WifiTest, InitTest) {
@@ -41,6 +42,23 @@ namespace esp32_mock_test {
 		EXPECT_STREQ(WiFi.getHostname(), "hostname") << "Setting hostname to empty string did not succeed";
 	}
 
+	TEST(WifiTest, ClientStreamTest) {
+		WiFiClient client;
+		client.print("GET / HTTP/1.1\r\n");
+		const uint8_t body[] = { 0, 1, 2 };
+		EXPECT_EQ(client.write(body, sizeof body), 3u) << "Bulk write";
+		EXPECT_EQ(client.testGetOutput(), std::string("GET / HTTP/1.1\r\n\0\1\2", 19)) << "Output binary safe";
+		client.testSetInput("HTTP/1.1 200 OK\r\nrest");
+		EXPECT_EQ(client.available(), 21) << "Input available";
+		EXPECT_STREQ(client.readStringUntil('\n').c_str(), "HTTP/1.1 200 OK\r") << "Status line";
+		char buffer[10] = {};
+		EXPECT_EQ(client.readBytes(buffer, sizeof buffer), 4u) << "The rest";
+		EXPECT_STREQ(buffer, "rest") << "Content of the rest";
+		EXPECT_EQ(client.read(), -1) << "Nothing left";
+		Client& base = client;
+		EXPECT_STREQ(base.testGetType(), "WifiClient") << "Polymorphic";
+	}
+
 	TEST(WifiTest, ConnectInTest) {
 		WiFi.testConnectIn(2);
 		EXPECT_FALSE(WiFi.isConnected()) << "First time disconnected";
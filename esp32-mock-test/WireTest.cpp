@@ -73,4 +73,19 @@ namespace esp32_mock_test {
 		EXPECT_EQ(Wire.write(65), 0);
 	}
 
+	TEST(WireTest, BulkWriteTest) {
+		Wire.begin();
+		Wire.beginTransmission(0x12);
+		const uint8_t data[] = { 0x01, 0x02, 0x03 };
+		EXPECT_EQ(Wire.write(data, sizeof data), 3u) << "Bulk write";
+		EXPECT_EQ(Wire.print(255, HEX), 2u) << "Print via Stream";
+		const uint8_t expected[] = { 0x01, 0x02, 0x03, 'F', 'F' };
+		EXPECT_EQ(Wire.testWriteMismatchIndex(expected, sizeof expected), 5) << "All written";
+		EXPECT_EQ(Wire.peek(), 0) << "Peek next result";
+		EXPECT_EQ(Wire.read(), 0) << "Read consumes it";
+		EXPECT_EQ(Wire.peek(), 1) << "Peek the one after";
+		const uint8_t big[2048] = {};
+		EXPECT_EQ(Wire.write(big, sizeof big), 2043u) << "Only what fits";
+	}
+
 }
\ No newline at end of file
@@ -11,6 +11,7 @@
 
 #include <gtest/gtest.h>
 #include "../esp32-mock/freertos/freeRTOS.h"
+#include "../esp32-mock/ESP.h"
 
 namespace esp32_mock_test {
 	class FreeRtosTest : public testing::Test {
@@ -83,6 +84,40 @@ namespace esp32_mock_test {
 		EXPECT_EQ(ulTaskNotifyTake(pdTRUE, portMAX_DELAY), 1u) << "Take returns 1 after give";
 	}
 
+	TEST_F(FreeRtosTest, CurrentTaskTest) {
+		const auto defaultHandle = xTaskGetCurrentTaskHandle();
+		EXPECT_EQ(xPortGetCoreID(), 0) << "Core 0 by default";
+		testSetCurrentTask(reinterpret_cast<TaskHandle_t>(500), 1);
+		EXPECT_EQ(xTaskGetCurrentTaskHandle(), reinterpret_cast<TaskHandle_t>(500)) << "Handle set";
+		EXPECT_EQ(xPortGetCoreID(), 1) << "Core set";
+		testSetCurrentTask(nullptr);
+		EXPECT_EQ(xTaskGetCurrentTaskHandle(), defaultHandle) << "Default handle back";
+		EXPECT_EQ(xPortGetCoreID(), 0) << "Core 0 again";
+	}
+
+	TEST_F(FreeRtosTest, TickTest) {
+		testSetRealTime(false);
+		EXPECT_EQ(pdMS_TO_TICKS(250), 250u) << "ms to ticks";
+		EXPECT_EQ(pdTICKS_TO_MS(250), 250u) << "ticks to ms";
+		EXPECT_EQ(xTaskGetTickCount(), 0u) << "Tick count starts at 0";
+		vTaskDelay(5);
+		EXPECT_EQ(xTaskGetTickCountFromISR(), 5u) << "vTaskDelay moves the tick count";
+
+		TickType_t lastWakeTime = xTaskGetTickCount();
+		constexpr TickType_t kPeriod = 10;
+		constexpr TickType_t kPeriods = 1000000;
+		for (TickType_t i = 0; i < kPeriods; i++) {
+			xTaskDelayUntil(&lastWakeTime, kPeriod);
+		}
+		EXPECT_EQ(lastWakeTime, 5u + kPeriod * kPeriods) << "Wake time moved by the periods";
+		EXPECT_EQ(esp_timer_get_time(), (5LL + kPeriod * kPeriods) * 1000LL + 50) << "Clock did not drift";
+
+		TickType_t staleWakeTime = 0;
+		EXPECT_EQ(xTaskDelayUntil(&staleWakeTime, kPeriod), pdFALSE) << "No delay if the wake time has passed";
+		EXPECT_EQ(staleWakeTime, kPeriod) << "Wake time still moves on";
+		testSetRealTime(false);
+	}
+
 	TEST_F(FreeRtosTest, QueueOverrunTest) {
 		testUxQueueReset();
 		const auto handle = xQueueCreate(kMaxQueues, 2);
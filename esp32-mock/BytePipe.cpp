@@ -0,0 +1,74 @@
+// Copyright 2026 Rik Essenius
+// 
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file
+// except in compliance with the License. You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+// Byte pipe to wire simulated serial endpoints together (not part of the ESP32 API)
+
+#include "BytePipe.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+    size_t roundUpToPowerOfTwo(const size_t value) {
+        size_t result = 1;
+        while (result < value) {
+            result *= 2;
+        }
+        return result;
+    }
+}
+
+constexpr size_t BytePipe::kDefaultCapacity;
+
+BytePipe::BytePipe(const size_t capacity) :
+    _buffer(roundUpToPowerOfTwo(std::max(capacity, static_cast<size_t>(1)))),
+    _sink(*this),
+    _source(*this) {}
+
+size_t BytePipe::size() const {
+    return _tail.load(std::memory_order_acquire) - _head.load(std::memory_order_acquire);
+}
+
+size_t BytePipe::write(const uint8_t* data, const size_t length) {
+    const size_t tail = _tail.load(std::memory_order_relaxed);
+    if (tail - _cachedHead + length > _buffer.size()) {
+        _cachedHead = _head.load(std::memory_order_acquire);
+    }
+    const size_t count = std::min(length, _buffer.size() - (tail - _cachedHead));
+    if (count < length) {
+        _droppedBytes.fetch_add(length - count, std::memory_order_relaxed);
+    }
+    if (count == 0) return 0;
+    const size_t start = tail & mask();
+    const size_t firstLength = std::min(count, _buffer.size() - start);
+    memcpy(&_buffer[start], data, firstLength);
+    memcpy(&_buffer[0], data + firstLength, count - firstLength);
+    _tail.store(tail + count, std::memory_order_release);
+    return count;
+}
+
+size_t BytePipe::read(uint8_t* buffer, const size_t length) {
+    const size_t head = _head.load(std::memory_order_relaxed);
+    if (_cachedTail - head < length) {
+        _cachedTail = _tail.load(std::memory_order_acquire);
+    }
+    const size_t count = std::min(length, _cachedTail - head);
+    if (count == 0) return 0;
+    const size_t start = head & mask();
+    const size_t firstLength = std::min(count, _buffer.size() - start);
+    memcpy(buffer, &_buffer[start], firstLength);
+    memcpy(buffer + firstLength, &_buffer[0], count - firstLength);
+    _head.store(head + count, std::memory_order_release);
+    return count;
+}
+
+void BytePipe::Sink::write(const char* data, const size_t length) {
+    _pipe.write(reinterpret_cast<const uint8_t*>(data), length);
+}
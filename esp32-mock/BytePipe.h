@@ -0,0 +1,106 @@
+// Copyright 2026 Rik Essenius
+// 
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file
+// except in compliance with the License. You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+// Byte pipe to wire simulated serial endpoints together (not part of the ESP32 API)
+
+#ifndef HEADER_BYTE_PIPE
+#define HEADER_BYTE_PIPE
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "SerialSink.h"
+#include "SerialSource.h"
+
+/**
+ * \brief Testing: fixed size lock-free byte queue for one writer and one reader, which may run in different threads.
+ * Use sink() as the output of one serial endpoint and source() as the input of another.
+ */
+class BytePipe {
+public:
+    static constexpr size_t kDefaultCapacity = 65536;
+
+    /**
+     * \param capacity the number of bytes the pipe can hold, rounded up to a power of two
+     */
+    explicit BytePipe(size_t capacity = kDefaultCapacity);
+
+    BytePipe(const BytePipe&) = delete;
+    BytePipe(BytePipe&&) = delete;
+    BytePipe& operator=(const BytePipe&) = delete;
+    BytePipe& operator=(BytePipe&&) = delete;
+    ~BytePipe() = default;
+
+    size_t capacity() const { return _buffer.size(); }
+
+    /**
+     * \brief The number of bytes waiting to be read. Only exact if neither side is busy
+     */
+    size_t size() const;
+
+    /**
+     * \brief Writer side: add as many bytes as fit. What doesn't fit is lost, like with a UART overrun
+     * \return the number of bytes written
+     */
+    size_t write(const uint8_t* data, size_t length);
+
+    /**
+     * \brief Reader side: copy up to length bytes to buffer, and remove them from the pipe
+     * \return the number of bytes read, 0 if the pipe is empty
+     */
+    size_t read(uint8_t* buffer, size_t length);
+
+    /**
+     * \brief The number of bytes lost because the pipe was full
+     */
+    size_t droppedBytes() const { return _droppedBytes.load(std::memory_order_relaxed); }
+
+    SerialSink& sink() { return _sink; }
+    SerialSource& source() { return _source; }
+
+private:
+    class Sink : public SerialSink {
+    public:
+        explicit Sink(BytePipe& pipe) : _pipe(pipe) {}
+        void write(const char* data, size_t length) override;
+        void flush() override { /* everything is in the pipe already */ }
+    private:
+        BytePipe& _pipe;
+    };
+
+    class Source : public SerialSource {
+    public:
+        explicit Source(BytePipe& pipe) : _pipe(pipe) {}
+        size_t read(uint8_t* buffer, size_t length) override { return _pipe.read(buffer, length); }
+    private:
+        BytePipe& _pipe;
+    };
+
+    size_t mask() const { return _buffer.size() - 1; }
+
+    // _head is only written by the reader and _tail only by the writer. They run freely and get masked on access.
+    // Both sides keep a copy of the other side's index, so they only touch the other side's cache line when they run out.
+    static constexpr size_t kCacheLineSize = 64;
+    static constexpr size_t kPaddingSize = kCacheLineSize - sizeof(std::atomic<size_t>) - sizeof(size_t);
+    std::vector<uint8_t> _buffer;
+    std::atomic<size_t> _head{0};
+    size_t _cachedTail = 0;
+    char _readerPadding[kPaddingSize] = {};
+    std::atomic<size_t> _tail{0};
+    size_t _cachedHead = 0;
+    char _writerPadding[kPaddingSize] = {};
+    std::atomic<size_t> _droppedBytes{0};
+    Sink _sink;
+    Source _source;
+};
+
+#endif
@@ -0,0 +1,97 @@
+// Copyright 2026 Rik Essenius
+// 
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file
+// except in compliance with the License. You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+// Byte queue used by the mocks to buffer data (not part of the ESP32 API)
+
+#include "ByteRing.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+    constexpr size_t kMinimumCapacity = 64;
+}
+
+constexpr size_t ByteRing::npos;
+
+size_t ByteRing::discard(const size_t length) {
+    const size_t count = std::min(length, size());
+    _head += count;
+    if (empty()) clear();
+    return count;
+}
+
+void ByteRing::erase(const size_t offset, const size_t length) {
+    if (offset >= size()) return;
+    const size_t count = std::min(length, size() - offset);
+    for (size_t i = _head + offset + count; i != _tail; i++) {
+        _buffer[(i - count) & mask()] = _buffer[i & mask()];
+    }
+    _tail -= count;
+}
+
+size_t ByteRing::find(const uint8_t value, const size_t limit) const {
+    const size_t searchLength = std::min(limit, size());
+    if (searchLength == 0) return npos;
+
+    // the data can wrap around the end of the buffer, so we search at most two contiguous segments
+    const size_t start = _head & mask();
+    const size_t firstLength = std::min(searchLength, _buffer.size() - start);
+    const auto first = static_cast<const uint8_t*>(memchr(&_buffer[start], value, firstLength));
+    if (first != nullptr) return static_cast<size_t>(first - &_buffer[start]);
+    if (firstLength == searchLength) return npos;
+    const auto second = static_cast<const uint8_t*>(memchr(&_buffer[0], value, searchLength - firstLength));
+    if (second != nullptr) return firstLength + static_cast<size_t>(second - &_buffer[0]);
+    return npos;
+}
+
+int ByteRing::peek() const {
+    if (empty()) return -1;
+    return _buffer[_head & mask()];
+}
+
+size_t ByteRing::peek(uint8_t* buffer, const size_t length, const size_t offset) const {
+    if (offset >= size()) return 0;
+    const size_t count = std::min(length, size() - offset);
+    const size_t start = (_head + offset) & mask();
+    const size_t firstLength = std::min(count, _buffer.size() - start);
+    memcpy(buffer, &_buffer[start], firstLength);
+    memcpy(buffer + firstLength, &_buffer[0], count - firstLength);
+    return count;
+}
+
+size_t ByteRing::pop(uint8_t* buffer, const size_t length) {
+    return discard(peek(buffer, length));
+}
+
+void ByteRing::push(const uint8_t* data, const size_t length) {
+    if (length == 0) return;
+    if (size() + length > _buffer.size()) {
+        grow(size() + length);
+    }
+    const size_t start = _tail & mask();
+    const size_t firstLength = std::min(length, _buffer.size() - start);
+    memcpy(&_buffer[start], data, firstLength);
+    memcpy(&_buffer[0], data + firstLength, length - firstLength);
+    _tail += length;
+}
+
+void ByteRing::grow(const size_t required) {
+    size_t newCapacity = std::max(_buffer.size(), kMinimumCapacity);
+    while (newCapacity < required) {
+        newCapacity *= 2;
+    }
+    std::vector<uint8_t> newBuffer(newCapacity);
+    const size_t count = size();
+    pop(newBuffer.data(), count);
+    _buffer.swap(newBuffer);
+    _head = 0;
+    _tail = count;
+}
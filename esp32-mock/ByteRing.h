@@ -0,0 +1,89 @@
+// Copyright 2026 Rik Essenius
+// 
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file
+// except in compliance with the License. You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+// Byte queue used by the mocks to buffer data (not part of the ESP32 API)
+
+#ifndef HEADER_BYTE_RING
+#define HEADER_BYTE_RING
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * \brief Growable circular byte buffer. Binary safe, and size() is O(1)
+ */
+class ByteRing {
+public:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    bool empty() const { return _head == _tail; }
+    size_t size() const { return _tail - _head; }
+    size_t capacity() const { return _buffer.size(); }
+    void clear() { _head = 0; _tail = 0; }
+
+    /**
+     * \brief Remove up to length bytes from the front without copying them
+     * \return the number of bytes removed
+     */
+    size_t discard(size_t length);
+
+    /**
+     * \brief Remove bytes from the middle, moving the bytes behind them forward
+     * \param offset the offset from the front of the first byte to remove
+     * \param length the number of bytes to remove
+     */
+    void erase(size_t offset, size_t length);
+
+    /**
+     * \brief Find the first occurrence of a byte
+     * \param value the byte to look for
+     * \param limit the number of bytes to search from the front
+     * \return the offset of the byte from the front, or npos if it isn't there
+     */
+    size_t find(uint8_t value, size_t limit = npos) const;
+
+    /**
+     * \return the byte at the front, or -1 if the ring is empty
+     */
+    int peek() const;
+
+    /**
+     * \brief Copy up to length bytes to buffer without removing them
+     * \param buffer the buffer to copy to
+     * \param length the maximum number of bytes to copy
+     * \param offset the offset from the front of the first byte to copy
+     * \return the number of bytes copied
+     */
+    size_t peek(uint8_t* buffer, size_t length, size_t offset = 0) const;
+
+    /**
+     * \brief Copy up to length bytes from the front to buffer, and remove them
+     * \return the number of bytes copied
+     */
+    size_t pop(uint8_t* buffer, size_t length);
+
+    /**
+     * \brief Add bytes at the back, growing the ring if needed
+     */
+    void push(const uint8_t* data, size_t length);
+
+private:
+    size_t mask() const { return _buffer.size() - 1; }
+    void grow(size_t required);
+
+    // capacity is always a power of two. _head and _tail run freely and get masked on access
+    std::vector<uint8_t> _buffer;
+    size_t _head = 0;
+    size_t _tail = 0;
+};
+
+#endif
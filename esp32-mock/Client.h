@@ -12,17 +12,28 @@
 #ifndef HEADER_CLIENT_H
 #define HEADER_CLIENT_H
 
+#include "Stream.h"
+
 /**
- * \brief Mock implementation of the network client driver for unit testing (not targeting the ESP32)
+ * \brief Mock implementation of the network client driver for unit testing (not targeting the ESP32).
+ * Without a connection, writes are accepted and dropped, and there is nothing to read.
  */
-class Client {
+class Client : public Stream {
 public:
 	Client() = default;
 	Client(const Client&) = default;
 	Client(Client&&) = default;
 	Client& operator=(const Client&) = default;
 	Client& operator=(Client&&) = default;
-	virtual ~Client() = default;
+	~Client() override = default;
+
+	using Print::write;
+	int available() override { return 0; }
+	int peek() override { return -1; }
+	int read() override { return -1; }
+	size_t write(uint8_t /*value*/) override { return 1; }
+	size_t write(const uint8_t* /*buffer*/, const size_t size) override { return size; }
+
 	virtual const char* testGetType() { return "Client"; }
 };
 
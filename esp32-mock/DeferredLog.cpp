@@ -0,0 +1,370 @@
+// Copyright 2026 Rik Essenius
+// 
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file
+// except in compliance with the License. You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+// Binary log that postpones formatting, for high rate logging in simulations (not part of the ESP32 API)
+
+#include "DeferredLog.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace {
+    constexpr size_t kMaxVarintSize = 10;
+
+    // 7 bits per byte, least significant first, with the high bit set on all but the last byte
+    size_t putVarint(uint8_t* buffer, uint64_t value) {
+        size_t length = 0;
+        while (value >= 0x80) {
+            buffer[length++] = static_cast<uint8_t>(value | 0x80);
+            value >>= 7;
+        }
+        buffer[length++] = static_cast<uint8_t>(value);
+        return length;
+    }
+
+    uint64_t getVarint(const uint8_t* data, size_t size, size_t& position) {
+        uint64_t value = 0;
+        for (unsigned shift = 0; position < size && shift < 64; shift += 7) {
+            const auto byte = data[position++];
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) break;
+        }
+        return value;
+    }
+
+    // small negative numbers get small codes too: 0, -1, 1, -2, 2 become 0, 1, 2, 3, 4
+    uint64_t zigzag(const int64_t value) {
+        return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+    }
+
+    int64_t unzigzag(const uint64_t value) {
+        return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+    }
+
+    // A decoded argument. Formatting converts it to what the conversion specifier expects, so that a mismatch
+    // between the specifier and the argument type (e.g. %d with a size_t) can't read garbage
+    struct Argument {
+        long long signedValue = 0;
+        unsigned long long unsignedValue = 0;
+        double doubleValue = 0;
+        const void* pointerValue = nullptr;
+        std::string stringValue;
+        bool isString = false;
+    };
+
+    template <typename T>
+    void appendFormatted(std::string& output, const std::string& specifier, T value) {
+        char buffer[128];
+        const int length = std::snprintf(buffer, sizeof buffer, specifier.c_str(), value);
+        if (length < 0) return;
+        if (static_cast<size_t>(length) < sizeof buffer) {
+            output.append(buffer, static_cast<size_t>(length));
+            return;
+        }
+        std::string longBuffer(static_cast<size_t>(length) + 1, '\0');
+        std::snprintf(&longBuffer[0], longBuffer.size(), specifier.c_str(), value);
+        output.append(longBuffer.c_str(), static_cast<size_t>(length));
+    }
+}
+
+constexpr size_t DeferredLog::kDefaultCapacity;
+constexpr size_t DeferredLog::Encoder::kMaxArgumentsSize;
+
+DeferredLog::Encoder::Encoder(const LogLevel level, const int64_t timestamp, const char* tag, const char* format) :
+    _level(level), _timestamp(timestamp), _tag(tag), _format(format) {}
+
+bool DeferredLog::Encoder::addArgument(const ArgumentType type, const void* value, const size_t length) {
+    if (_full || _size + 1 + length > kMaxArgumentsSize) {
+        _full = true;
+        return false;
+    }
+    _buffer[_size] = static_cast<uint8_t>(type);
+    memcpy(_buffer + _size + 1, value, length);
+    _size += 1 + length;
+    return true;
+}
+
+void DeferredLog::Encoder::addSigned(const long long value) {
+    uint8_t buffer[kMaxVarintSize];
+    addArgument(ArgumentType::Signed, buffer, putVarint(buffer, zigzag(value)));
+}
+
+void DeferredLog::Encoder::addUnsigned(const unsigned long long value) {
+    uint8_t buffer[kMaxVarintSize];
+    addArgument(ArgumentType::Unsigned, buffer, putVarint(buffer, value));
+}
+
+void DeferredLog::Encoder::addDouble(const double value) {
+    addArgument(ArgumentType::Double, &value, sizeof value);
+}
+
+void DeferredLog::Encoder::addPointer(const void* value) {
+    uint8_t buffer[kMaxVarintSize];
+    addArgument(ArgumentType::Pointer, buffer, putVarint(buffer, reinterpret_cast<uintptr_t>(value)));
+}
+
+void DeferredLog::Encoder::addString(const char* value) {
+    if (value == nullptr) {
+        addPointer(value);
+        return;
+    }
+    // the length goes first, and the string gets truncated to what fits. The length of what fits takes at most 2 bytes
+    const size_t room = kMaxArgumentsSize - std::min(kMaxArgumentsSize, _size + 1 + 2);
+    const auto length = std::min(strlen(value), room);
+    uint8_t buffer[kMaxArgumentsSize];
+    const auto lengthSize = putVarint(buffer, length);
+    memcpy(buffer + lengthSize, value, length);
+    addArgument(ArgumentType::String, buffer, lengthSize + length);
+}
+
+void DeferredLog::clear() {
+    _ring.clear();
+    _count = 0;
+    _droppedRecords = 0;
+    _sites.clear();
+    _siteIds.clear();
+    _baseTimestamp = 0;
+    _lastTimestamp = 0;
+}
+
+// the next record then has the timestamp the dropped one had as its base
+void DeferredLog::dropOldest() {
+    uint64_t length;
+    const auto lengthSize = peekVarint(0, length);
+    uint64_t site;
+    const auto siteSize = peekVarint(lengthSize, site);
+    uint64_t delta;
+    peekVarint(lengthSize + siteSize, delta);
+    _baseTimestamp += unzigzag(delta);
+    _ring.discard(lengthSize + length);
+    _count--;
+    _droppedRecords++;
+}
+
+size_t DeferredLog::peekVarint(const size_t offset, uint64_t& value) const {
+    uint8_t buffer[kMaxVarintSize];
+    const auto available = _ring.peek(buffer, sizeof buffer, offset);
+    size_t position = 0;
+    value = getVarint(buffer, available, position);
+    return position;
+}
+
+uint32_t DeferredLog::siteId(const LogLevel level, const char* tag, const char* format) {
+    const auto key = std::make_tuple(level, tag, format);
+    const auto entry = _siteIds.find(key);
+    if (entry != _siteIds.end()) return entry->second;
+    const auto id = static_cast<uint32_t>(_sites.size());
+    _sites.push_back({ level, tag, format });
+    _siteIds.emplace(key, id);
+    return id;
+}
+
+void DeferredLog::store(const Encoder& encoder) {
+    uint8_t header[3 * kMaxVarintSize];
+    const auto site = siteId(encoder.level(), encoder.tag(), encoder.format());
+    size_t headerSize = kMaxVarintSize;
+    headerSize += putVarint(header + headerSize, site);
+    headerSize += putVarint(header + headerSize, zigzag(encoder.timestamp() - _lastTimestamp));
+    const auto bodyLength = headerSize - kMaxVarintSize + encoder.argumentsSize();
+
+    // the length goes right before the rest of the header
+    uint8_t length[kMaxVarintSize];
+    const auto lengthSize = putVarint(length, bodyLength);
+    const auto start = kMaxVarintSize - lengthSize;
+    memcpy(header + start, length, lengthSize);
+    const auto recordLength = lengthSize + bodyLength;
+    if (recordLength > _capacity) {
+        _droppedRecords++;
+        return;
+    }
+
+    // make room by dropping the oldest records
+    while (_ring.size() + recordLength > _capacity) {
+        dropOldest();
+    }
+    _ring.push(header + start, headerSize - start);
+    _ring.push(encoder.arguments(), encoder.argumentsSize());
+    _lastTimestamp = encoder.timestamp();
+    _count++;
+}
+
+std::string DeferredLog::format(const bool withTimestamps) const {
+    std::string output;
+    int64_t timestamp = _baseTimestamp;
+    size_t offset = 0;
+    while (offset < _ring.size()) {
+        offset = appendRecord(output, offset, timestamp, withTimestamps);
+    }
+    return output;
+}
+
+void DeferredLog::dump(SerialSink& sink, const bool withTimestamps) {
+    // format per record so a large log doesn't need to fit in memory as text
+    std::string line;
+    int64_t timestamp = _baseTimestamp;
+    size_t offset = 0;
+    while (offset < _ring.size()) {
+        line.clear();
+        offset = appendRecord(line, offset, timestamp, withTimestamps);
+        sink.write(line.c_str(), line.size());
+    }
+    sink.flush();
+    clear();
+}
+
+// returns the offset of the next record, and moves timestamp on to the one of this record
+size_t DeferredLog::appendRecord(std::string& output, const size_t offset, int64_t& timestamp, const bool withTimestamps) const {
+    uint64_t length;
+    const auto lengthSize = peekVarint(offset, length);
+    std::vector<uint8_t> data(length);
+    _ring.peek(data.data(), data.size(), offset + lengthSize);
+    size_t position = 0;
+    const auto& site = _sites[getVarint(data.data(), data.size(), position)];
+    timestamp += unzigzag(getVarint(data.data(), data.size(), position));
+
+    // decode the arguments
+    std::vector<Argument> arguments;
+    while (position < data.size()) {
+        Argument argument;
+        const auto type = static_cast<ArgumentType>(data[position++]);
+        switch (type) {
+        case ArgumentType::Signed:
+            argument.signedValue = unzigzag(getVarint(data.data(), data.size(), position));
+            argument.unsignedValue = static_cast<unsigned long long>(argument.signedValue);
+            argument.doubleValue = static_cast<double>(argument.signedValue);
+            break;
+        case ArgumentType::Unsigned:
+            argument.unsignedValue = getVarint(data.data(), data.size(), position);
+            argument.signedValue = static_cast<long long>(argument.unsignedValue);
+            argument.doubleValue = static_cast<double>(argument.unsignedValue);
+            break;
+        case ArgumentType::Double:
+            memcpy(&argument.doubleValue, data.data() + position, sizeof argument.doubleValue);
+            position += sizeof argument.doubleValue;
+            argument.signedValue = static_cast<long long>(argument.doubleValue);
+            argument.unsignedValue = static_cast<unsigned long long>(argument.signedValue);
+            break;
+        case ArgumentType::Pointer:
+            argument.unsignedValue = getVarint(data.data(), data.size(), position);
+            argument.pointerValue = reinterpret_cast<const void*>(static_cast<uintptr_t>(argument.unsignedValue));
+            argument.signedValue = static_cast<long long>(argument.unsignedValue);
+            break;
+        case ArgumentType::String: {
+            const auto stringLength = static_cast<size_t>(getVarint(data.data(), data.size(), position));
+            argument.stringValue.assign(reinterpret_cast<const char*>(data.data() + position), stringLength);
+            argument.isString = true;
+            position += stringLength;
+            break;
+        }
+        }
+        arguments.push_back(std::move(argument));
+    }
+
+    if (withTimestamps) {
+        appendFormatted(output, "%lld ", static_cast<long long>(timestamp));
+    }
+    appendFormatted(output, "[%s] ", toString(site.level));
+    if (site.tag != nullptr) {
+        appendFormatted(output, "%s: ", site.tag);
+    }
+
+    // walk the format string, and format each conversion with the argument converted to what it expects
+    const Argument missing;
+    size_t next = 0;
+    auto nextArgument = [&arguments, &next, &missing]() -> const Argument& {
+        return next < arguments.size() ? arguments[next++] : missing;
+    };
+    const char* current = site.format;
+    while (*current != '\0') {
+        if (*current != '%') {
+            const char* end = strchr(current, '%');
+            if (end == nullptr) end = current + strlen(current);
+            output.append(current, static_cast<size_t>(end - current));
+            current = end;
+            continue;
+        }
+        if (current[1] == '%') {
+            output += '%';
+            current += 2;
+            continue;
+        }
+        std::string specifier = "%";
+        current++;
+        while (*current != '\0' && strchr("-+ #0", *current) != nullptr) {
+            specifier += *current++;
+        }
+        if (*current == '*') {
+            specifier += std::to_string(nextArgument().signedValue);
+            current++;
+        }
+        while (*current >= '0' && *current <= '9') {
+            specifier += *current++;
+        }
+        if (*current == '.') {
+            specifier += *current++;
+            if (*current == '*') {
+                specifier += std::to_string(std::max(0LL, nextArgument().signedValue));
+                current++;
+            }
+            while (*current >= '0' && *current <= '9') {
+                specifier += *current++;
+            }
+        }
+        // the length modifiers get replaced by the ones that match our stored types
+        while (*current != '\0' && strchr("hljztL", *current) != nullptr) {
+            current++;
+        }
+        const char conversion = *current;
+        if (conversion == '\0') break;
+        current++;
+        const Argument& argument = nextArgument();
+        switch (conversion) {
+        case 'd':
+        case 'i':
+            appendFormatted(output, specifier + "lld", argument.signedValue);
+            break;
+        case 'u':
+        case 'o':
+        case 'x':
+        case 'X':
+            appendFormatted(output, specifier + "ll" + conversion, argument.unsignedValue);
+            break;
+        case 'c':
+            appendFormatted(output, specifier + "c", static_cast<int>(argument.signedValue));
+            break;
+        case 'f':
+        case 'F':
+        case 'e':
+        case 'E':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A':
+            appendFormatted(output, specifier + conversion, argument.doubleValue);
+            break;
+        case 's':
+            appendFormatted(output, specifier + "s", argument.isString ? argument.stringValue.c_str() : "(null)");
+            break;
+        case 'p':
+            appendFormatted(output, specifier + "p", argument.pointerValue);
+            break;
+        case 'n':
+            // nothing to write back to at this point
+            break;
+        default:
+            output += specifier + conversion;
+            break;
+        }
+    }
+    output += '\n';
+    return offset + lengthSize + length;
+}
@@ -0,0 +1,188 @@
+// Copyright 2026 Rik Essenius
+// 
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file
+// except in compliance with the License. You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+// Binary log that postpones formatting, for high rate logging in simulations (not part of the ESP32 API)
+
+#ifndef HEADER_DEFERRED_LOG
+#define HEADER_DEFERRED_LOG
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+#include "ByteRing.h"
+#include "SerialSink.h"
+
+// defined in ESP.h
+enum class LogLevel : uint8_t;
+const char* toString(LogLevel level);
+
+/**
+ * \brief Testing: log that stores each call compactly in a binary ring, and only formats it when asked.
+ * A record is its length, the id of the call site (level, tag and format string pointer), the time since the
+ * previous record and the arguments, all varint encoded (doubles and string contents as they are), so a record
+ * is usually a few bytes. String arguments are copied, so they may go out of scope.
+ * Format strings and tags must stay valid until formatting (string literals always do).
+ * When the ring is full, the oldest records make room for new ones.
+ */
+class DeferredLog {
+public:
+    static constexpr size_t kDefaultCapacity = 1024 * 1024;
+
+    /**
+     * \param capacity the number of bytes the ring can hold
+     */
+    explicit DeferredLog(size_t capacity = kDefaultCapacity) : _capacity(capacity) {}
+
+    DeferredLog(const DeferredLog&) = delete;
+    DeferredLog(DeferredLog&&) = delete;
+    DeferredLog& operator=(const DeferredLog&) = delete;
+    DeferredLog& operator=(DeferredLog&&) = delete;
+    ~DeferredLog() = default;
+
+    /**
+     * \brief Store a log call without formatting it
+     * \param level the log level
+     * \param timestamp the time of the call in microseconds
+     * \param tag the component that logs (nullptr if none). Only the pointer gets stored, like the format string
+     * \param format the printf format string. Only the pointer gets stored
+     * \param arguments the printf arguments
+     */
+    template <typename... Arguments>
+    void record(const LogLevel level, const int64_t timestamp, const char* tag, const char* format,
+                Arguments ... arguments) {
+        Encoder encoder(level, timestamp, tag, format);
+        encode(encoder, arguments...);
+        store(encoder);
+    }
+
+    size_t bytesUsed() const { return _ring.size(); }
+    size_t capacity() const { return _capacity; }
+    void clear();
+
+    /**
+     * \brief The number of records in the ring
+     */
+    size_t count() const { return _count; }
+
+    /**
+     * \brief The number of records dropped since the last clear: to make room for newer ones, or because they didn't fit
+     */
+    size_t droppedRecords() const { return _droppedRecords; }
+
+    /**
+     * \brief Format all records, oldest first, the same way log_printf does
+     * \param withTimestamps whether to start each line with the timestamp in microseconds
+     */
+    std::string format(bool withTimestamps = false) const;
+
+    /**
+     * \brief Format all records to a sink (e.g. a file), oldest first, and clear the log
+     * \param sink the sink to write the lines to
+     * \param withTimestamps whether to start each line with the timestamp in microseconds
+     */
+    void dump(SerialSink& sink, bool withTimestamps = false);
+
+private:
+    enum class ArgumentType : uint8_t { Signed, Unsigned, Double, Pointer, String };
+
+    // Serializes the arguments of a record on the stack; arguments that don't fit get dropped and long strings get truncated
+    class Encoder {
+    public:
+        static constexpr size_t kMaxArgumentsSize = 512;
+        Encoder(LogLevel level, int64_t timestamp, const char* tag, const char* format);
+        LogLevel level() const { return _level; }
+        int64_t timestamp() const { return _timestamp; }
+        const char* tag() const { return _tag; }
+        const char* format() const { return _format; }
+        const uint8_t* arguments() const { return _buffer; }
+        size_t argumentsSize() const { return _size; }
+
+        template <typename T>
+        typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type add(const T value) {
+            addSigned(value);
+        }
+
+        template <typename T>
+        typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value>::type add(const T value) {
+            addUnsigned(value);
+        }
+
+        template <typename T>
+        typename std::enable_if<std::is_enum<T>::value>::type add(const T value) {
+            addSigned(static_cast<long long>(value));
+        }
+
+        template <typename T>
+        typename std::enable_if<std::is_floating_point<T>::value>::type add(const T value) {
+            addDouble(value);
+        }
+
+        template <typename T>
+        void add(const T* value) { addPointer(value); }
+
+        void add(const char* value) { addString(value); }
+
+    private:
+        bool addArgument(ArgumentType type, const void* value, size_t length);
+        void addSigned(long long value);
+        void addUnsigned(unsigned long long value);
+        void addDouble(double value);
+        void addPointer(const void* value);
+        void addString(const char* value);
+
+        LogLevel _level;
+        int64_t _timestamp;
+        const char* _tag;
+        const char* _format;
+        uint8_t _buffer[kMaxArgumentsSize];
+        size_t _size = 0;
+        bool _full = false;
+    };
+
+    struct Site {
+        LogLevel level;
+        const char* tag;
+        const char* format;
+    };
+
+    static void encode(Encoder& /*encoder*/) { /* no more arguments */ }
+
+    template <typename T, typename... Rest>
+    static void encode(Encoder& encoder, T first, Rest ... rest) {
+        encoder.add(first);
+        encode(encoder, rest...);
+    }
+
+    void dropOldest();
+    size_t peekVarint(size_t offset, uint64_t& value) const;
+    uint32_t siteId(LogLevel level, const char* tag, const char* format);
+    void store(const Encoder& encoder);
+    size_t appendRecord(std::string& output, size_t offset, int64_t& timestamp, bool withTimestamps) const;
+
+    ByteRing _ring;
+    size_t _capacity;
+    size_t _count = 0;
+    size_t _droppedRecords = 0;
+
+    // the call sites by id, and the other way around
+    std::vector<Site> _sites;
+    std::map<std::tuple<LogLevel, const char*, const char*>, uint32_t> _siteIds;
+
+    // the timestamp that the delta of the oldest record is relative to, and the one of the newest record
+    int64_t _baseTimestamp = 0;
+    int64_t _lastTimestamp = 0;
+};
+
+#endif
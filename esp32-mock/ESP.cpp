@@ -21,8 +21,14 @@
 // SonarQube: cpp:S5817 -  Ignored as we are mimicking existing interface
 
 #include "ESP.h"
+#include <algorithm>
 #include <chrono>
 #include <cstdarg>
+#include <thread>
+#ifdef __linux__
+#include <cerrno>
+#include <ctime>
+#endif
 
 
 
@@ -68,13 +74,60 @@ void pinMode(uint8_t pin, uint8_t mode) {
 // Time functions
 
 namespace {
-    unsigned long espMicros = 0;
-    unsigned long espMicrosSteps = 50;
+    // steady_clock is CLOCK_MONOTONIC on Linux, which is what clock_nanosleep uses for absolute deadlines
+    using EspClock = std::chrono::steady_clock;
+
+    unsigned long long espMicros = 0;
+    unsigned long long espMicrosSteps = 50;
     bool espRealTimeOn = false;
-    auto espStartTime = std::chrono::high_resolution_clock::now();
+    auto espStartTime = EspClock::now();
     bool espDisableDelay = false;
+    bool espPacedOn = false;
+    double espTimeScale = 1.0;
+    PacingStatistics espPacingStatistics{};
 
     long long espMicroShift = 0;
+
+    void sleepUntil(const EspClock::time_point& deadline) {
+#ifdef __linux__
+        const auto sinceEpoch = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline.time_since_epoch()).count();
+        timespec target{};
+        target.tv_sec = static_cast<time_t>(sinceEpoch / 1000000000LL);
+        target.tv_nsec = static_cast<long>(sinceEpoch % 1000000000LL);
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &target, nullptr) == EINTR) { /* interrupted, sleep again */ }
+#else
+        std::this_thread::sleep_until(deadline);
+#endif
+    }
+
+    // An absolute deadline means that time spent before going to sleep or an interrupted sleep doesn't add to the delay
+    void pacedDelay(const unsigned long long delayMicros) {
+        const auto wallNanos = static_cast<long long>(static_cast<double>(delayMicros) * 1000.0 / espTimeScale);
+        const auto deadline = EspClock::now() + std::chrono::nanoseconds(wallNanos);
+        sleepUntil(deadline);
+        const auto drift = std::chrono::duration_cast<std::chrono::nanoseconds>(EspClock::now() - deadline).count();
+        espPacingStatistics.sleepCount++;
+        espPacingStatistics.totalDriftNanos += drift;
+        espPacingStatistics.maxDriftNanos = std::max<long long>(espPacingStatistics.maxDriftNanos, drift);
+    }
+
+    // The clock without moving it forward, which micros() does when not in real time mode
+    long long peekClockNanos() {
+        if (espRealTimeOn) {
+            const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(EspClock::now() - espStartTime).count();
+            return static_cast<long long>(static_cast<double>(elapsed) * espTimeScale) + espMicroShift * 1000;
+        }
+        return static_cast<long long>(espMicros) * 1000;
+    }
+
+    void realTimeDelay(const unsigned long long delayMicros) {
+        if (espPacedOn) {
+            pacedDelay(delayMicros);
+        }
+        else {
+            espMicroShift += static_cast<long long>(delayMicros);
+        }
+    }
 }
 
 void configTime(int /*i*/, int /*i1*/, const char* /*str*/, const char* /*text*/) { /* no-op */}
@@ -85,7 +138,7 @@ void testShiftMicros(long long shift) {
 
 void delayMicroseconds(unsigned long delay) {
     if (espRealTimeOn) {
-        espMicroShift += delay;
+        realTimeDelay(delay);
     }
     else {
         espMicros += delay;
@@ -99,7 +152,7 @@ void testDisableDelay(bool disable) {
 void delay(unsigned long delay) {
     if (espDisableDelay) return;
     if (espRealTimeOn) {
-        espMicroShift += delay * 1000LL;
+        realTimeDelay(delay * 1000ULL);
     }
     else {
         espMicros += delay * 1000UL;
@@ -109,26 +162,46 @@ void delay(unsigned long delay) {
 void testSetRealTime(bool on) {
     espRealTimeOn = on;
     if (espRealTimeOn) {
-        espStartTime = std::chrono::high_resolution_clock::now();
+        espStartTime = EspClock::now();
     }
     else {
         espMicros = 0;
+        espPacedOn = false;
+        espTimeScale = 1.0;
     }
 }
 
+void testSetPacedRealTime(bool on, double timeScale) {
+    espPacedOn = on;
+    espTimeScale = on && timeScale > 0 ? timeScale : 1.0;
+    testSetRealTime(true);
+}
+
+PacingStatistics testGetPacingStatistics() {
+    return espPacingStatistics;
+}
+
+void testResetPacingStatistics() {
+    espPacingStatistics = PacingStatistics{};
+}
+
 unsigned long millis() {
     return micros() / 1000;
 }
 
 unsigned long micros() {
-    if (espRealTimeOn) {
-        const auto now = std::chrono::high_resolution_clock::now();
-        const auto result = static_cast<unsigned long>(
-            std::chrono::duration_cast<std::chrono::microseconds>(now - espStartTime).count() + espMicroShift);
-        return result;
+    return static_cast<unsigned long>(esp_timer_get_time());
+}
+
+int64_t esp_timer_get_time() {
+    if (!espRealTimeOn) {
+        espMicros += espMicrosSteps;
     }
-    espMicros += espMicrosSteps;
-    return espMicros;
+    return peekClockNanos() / 1000;
+}
+
+int64_t testPeekMicros() {
+    return peekClockNanos() / 1000;
 }
 
 void yield() { /* mock */ }
@@ -136,55 +209,317 @@ void yield() { /* mock */ }
 // Serial class
 
 HardwareSerial Serial;
+HardwareSerial Serial1(1);
+HardwareSerial Serial2(2);
+
+namespace {
+    // Nanoseconds are precise enough to keep the byte times of common baud rates from drifting
+    long long divideRoundingUp(const long long value, const long long divisor) {
+        return (value + divisor - 1) / divisor;
+    }
+
+    void delayNanos(const long long nanos) {
+        delayMicroseconds(static_cast<unsigned long>(divideRoundingUp(nanos, 1000)));
+    }
+}
 
 int HardwareSerial::available() {
-    return static_cast<int>(strlen(_inputBufferPointer));
+    return static_cast<int>(readableInput());
 }
 
-void HardwareSerial::begin(int /*speed*/) {
+int HardwareSerial::availableForWrite() {
+    if (!_timingOn) return static_cast<int>(_txBufferSize);
+    const long long inFlight = _txBusyUntilNanos - peekClockNanos();
+    const auto queued = inFlight > 0 ? static_cast<size_t>(divideRoundingUp(inFlight, _byteNanos)) : 0;
+    return static_cast<int>(_txBufferSize - std::min(queued, _txBufferSize));
+}
+
+void HardwareSerial::begin(const unsigned long baud, const uint32_t config, int8_t /*rxPin*/, int8_t /*txPin*/) {
+    _baudRate = static_cast<uint32_t>(baud > 0 ? baud : 115200);
+    const uint32_t dataBits = 5 + ((config >> 2) & 0x3);
+    const uint32_t parityBits = (config & 0x3) != 0 ? 1 : 0;
+    const uint32_t stopCode = (config >> 4) & 0x3;
+    const uint32_t stopHalfBits = stopCode == 3 ? 4 : (stopCode == 2 ? 3 : 2);
+
+    // count in half bits, so 1.5 stop bits works too
+    const uint32_t frameHalfBits = 2 * (1 + dataBits + parityBits) + stopHalfBits;
+    _byteNanos = static_cast<long long>(divideRoundingUp(frameHalfBits * 1000000000LL, 2LL * _baudRate));
+    _txBusyUntilNanos = 0;
+    _uartStatistics = UartStatistics{};
     testClearInput();
     testClearOutput();
 }
 
+size_t HardwareSerial::setRxBufferSize(const size_t size) {
+    _rxBufferSize = size > 0 ? size : kDefaultRxBufferSize;
+    return _rxBufferSize;
+}
+
+size_t HardwareSerial::setTxBufferSize(const size_t size) {
+    _txBufferSize = size > 0 ? size : kDefaultTxBufferSize;
+    return _txBufferSize;
+}
+
+void HardwareSerial::testSetUartTiming(const bool on) {
+    _timingOn = on;
+    _txBusyUntilNanos = 0;
+    _rxArrived = _input.size();
+    _rxLineStartNanos = peekClockNanos();
+}
+
 void HardwareSerial::testClearInput() {
-    _inputBuffer[0] = 0;
-    _inputBufferPointer = _inputBuffer;
+    _input.clear();
+    _rxArrived = 0;
 }
 
 void HardwareSerial::testClearOutput() {
-    _printBuffer[0] = 0;
-    _printBufferPointer = _printBuffer;
+    _output.clear();
+    _droppedOutput = 0;
 }
 
 const char* HardwareSerial::testGetOutput() {
-    return _printBuffer;
+    if (_outputLimit > 0 && _output.size() > _outputLimit) {
+        trimOutput();
+    }
+    return _output.c_str();
+}
+
+void HardwareSerial::testSetOutputLimit(const size_t limit) {
+    _outputLimit = limit;
+}
+
+size_t HardwareSerial::testGetDroppedOutput() const {
+    const size_t pending = _outputLimit > 0 && _output.size() > _outputLimit ? _output.size() - _outputLimit : 0;
+    return _droppedOutput + pending;
 }
 
-void HardwareSerial::print(const char* input) {
-    SafeCString::strcat(_printBuffer, input);
-    _printBufferPointer = _printBuffer + strlen(_printBuffer);
+void HardwareSerial::testSetOutputSink(SerialSink* sink, const bool capture) {
+    flush();
+    _sink = sink;
+    _capture = capture;
 }
 
-void HardwareSerial::println() {
-    print("\n");
+void HardwareSerial::flush() {
+    if (_sink != nullptr) {
+        _sink->flush();
+    }
+    // like on the device, wait until everything has been sent
+    if (_timingOn) {
+        const long long remaining = _txBusyUntilNanos - peekClockNanos();
+        if (remaining > 0) {
+            delayNanos(remaining);
+        }
+    }
 }
 
-void HardwareSerial::println(const char* input) {
-    print(input);
-    println();
+void HardwareSerial::append(const char* data, const size_t length) {
+    // tasks may print concurrently; a single write must not interleave with another one
+    std::lock_guard<std::mutex> lock(_outputMutex);
+    transmit(length);
+    if (_sink != nullptr) {
+        _sink->write(data, length);
+    }
+    if (!_capture) return;
+    _output.append(data, length);
+    // trimming only when we're at twice the limit keeps appending O(1) amortized
+    if (_outputLimit > 0 && _output.size() >= 2 * _outputLimit) {
+        trimOutput();
+    }
 }
 
-char HardwareSerial::read() {
-    if (*_inputBufferPointer == 0) return 0;
-    return *_inputBufferPointer++;
+void HardwareSerial::trimOutput() {
+    const size_t excess = _output.size() - _outputLimit;
+    _output.erase(0, excess);
+    _droppedOutput += excess;
+}
+
+// The TX buffer holds what hasn't gone out yet. If the new bytes don't fit, we stall until they do
+void HardwareSerial::transmit(const size_t length) {
+    if (!_timingOn) return;
+    const long long now = peekClockNanos();
+    const long long busyUntil = std::max(_txBusyUntilNanos, now) + static_cast<long long>(length) * _byteNanos;
+    const long long stall = busyUntil - static_cast<long long>(_txBufferSize) * _byteNanos - now;
+    if (stall > 0) {
+        _uartStatistics.txStallMicros += static_cast<unsigned long long>(divideRoundingUp(stall, 1000));
+        delayNanos(stall);
+    }
+    _txBusyUntilNanos = busyUntil;
+    _uartStatistics.bytesWritten += length;
+}
+
+size_t HardwareSerial::write(const uint8_t value) {
+    append(reinterpret_cast<const char*>(&value), 1);
+    return 1;
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, const size_t size) {
+    append(reinterpret_cast<const char*>(buffer), size);
+    return size;
+}
+
+void HardwareSerial::discardInput(const size_t length) {
+    const size_t count = _input.discard(std::min(length, arrivedInput()));
+    if (_timingOn) {
+        _rxArrived -= count;
+    }
+    _uartStatistics.bytesRead += count;
+}
+
+bool HardwareSerial::fillInput() {
+    if (_source == nullptr) return false;
+    uint8_t chunk[kInputChunkSize];
+    const size_t length = _source->read(chunk, sizeof chunk);
+    receive(chunk, length);
+    return length > 0;
+}
+
+size_t HardwareSerial::popInput(uint8_t* buffer, const size_t length) {
+    const size_t count = _input.pop(buffer, std::min(length, arrivedInput()));
+    if (_timingOn) {
+        _rxArrived -= count;
+    }
+    _uartStatistics.bytesRead += count;
+    return count;
+}
+
+size_t HardwareSerial::readableInput() {
+    if (_input.empty()) {
+        fillInput();
+    }
+    updateArrivals();
+    return arrivedInput();
+}
+
+void HardwareSerial::receive(const uint8_t* data, const size_t length) {
+    // if the line is idle, the new bytes start arriving now. Otherwise, they follow the bytes still on the line
+    if (_timingOn && _input.size() == _rxArrived) {
+        _rxLineStartNanos = peekClockNanos();
+    }
+    _input.push(data, length);
+}
+
+// Bytes that are still on the line arrive one byte time after each other
+void HardwareSerial::updateArrivals() {
+    if (!_timingOn) return;
+    const size_t onTheLine = _input.size() - _rxArrived;
+    if (onTheLine == 0) return;
+    const long long elapsed = peekClockNanos() - _rxLineStartNanos;
+    if (elapsed < _byteNanos) return;
+    size_t arrived = std::min(onTheLine, static_cast<size_t>(elapsed / _byteNanos));
+    _rxLineStartNanos += static_cast<long long>(arrived) * _byteNanos;
+
+    // bytes arriving while the RX buffer is full are lost
+    const size_t room = _rxBufferSize > _rxArrived ? _rxBufferSize - _rxArrived : 0;
+    if (arrived > room) {
+        const size_t lost = arrived - room;
+        _input.erase(_rxArrived + room, lost);
+        _uartStatistics.rxOverflowBytes += lost;
+        arrived = room;
+    }
+    _rxArrived += arrived;
+}
+
+// Input that is still on the line will arrive, so we wait for it (moving the clock). We don't wait for anything else
+bool HardwareSerial::waitForInput() {
+    if (readableInput() > 0) return true;
+    if (!_timingOn || _input.empty()) return false;
+    const long long wait = _rxLineStartNanos + _byteNanos - peekClockNanos();
+    if (wait > 0) {
+        delayNanos(wait);
+    }
+    return readableInput() > 0;
+}
+
+int HardwareSerial::peek() {
+    if (readableInput() == 0) return -1;
+    return _input.peek();
+}
+
+int HardwareSerial::read() {
+    if (readableInput() == 0) return -1;
+    uint8_t value;
+    popInput(&value, 1);
+    return value;
+}
+
+size_t HardwareSerial::readBytes(char* buffer, const size_t length) {
+    const auto target = reinterpret_cast<uint8_t*>(buffer);
+    size_t count = 0;
+    while (count < length && waitForInput()) {
+        count += popInput(target + count, length - count);
+    }
+    return count;
+}
+
+// Like Arduino, the terminator is consumed but not copied into the buffer
+size_t HardwareSerial::readBytesUntil(const char terminator, char* buffer, const size_t length) {
+    const auto target = reinterpret_cast<uint8_t*>(buffer);
+    size_t count = 0;
+    while (count < length && waitForInput()) {
+        const size_t limit = std::min(length - count, arrivedInput());
+        const size_t index = _input.find(static_cast<uint8_t>(terminator), limit);
+        if (index != ByteRing::npos) {
+            count += popInput(target + count, index);
+            discardInput(1);
+            break;
+        }
+        count += popInput(target + count, limit);
+    }
+    return count;
+}
+
+String HardwareSerial::readString() {
+    String result;
+    char chunk[kInputChunkSize];
+    while (waitForInput()) {
+        result.concat(chunk, popInput(reinterpret_cast<uint8_t*>(chunk), sizeof chunk));
+    }
+    return result;
+}
+
+String HardwareSerial::readStringUntil(const char terminator) {
+    String result;
+    char chunk[kInputChunkSize];
+    while (waitForInput()) {
+        const size_t limit = std::min(sizeof chunk, arrivedInput());
+        const size_t index = _input.find(static_cast<uint8_t>(terminator), limit);
+        if (index != ByteRing::npos) {
+            result.concat(chunk, popInput(reinterpret_cast<uint8_t*>(chunk), index));
+            discardInput(1);
+            break;
+        }
+        result.concat(chunk, popInput(reinterpret_cast<uint8_t*>(chunk), limit));
+    }
+    return result;
 }
 
 void HardwareSerial::testSetInput(const char* input) {
-    SafeCString::strcpy(_inputBuffer, input);
-    _inputBufferPointer = _inputBuffer;
+    testSetInput(reinterpret_cast<const uint8_t*>(input), strlen(input));
+}
+
+void HardwareSerial::testSetInput(const uint8_t* input, const size_t length) {
+    testClearInput();
+    receive(input, length);
 }
 
-void HardwareSerial::setTimeout(long /*timeout*/) { /* mock */ }
+void HardwareSerial::testSetInputSource(SerialSource* source) {
+    _source = source;
+}
+
+SerialLink::SerialLink(HardwareSerial& first, HardwareSerial& second, const size_t capacity) :
+    _first(first), _second(second), _firstToSecond(capacity), _secondToFirst(capacity) {
+    _first.testSetOutputSink(&_firstToSecond.sink(), false);
+    _second.testSetInputSource(&_firstToSecond.source());
+    _second.testSetOutputSink(&_secondToFirst.sink(), false);
+    _first.testSetInputSource(&_secondToFirst.source());
+}
+
+SerialLink::~SerialLink() {
+    _first.testSetOutputSink(nullptr);
+    _first.testSetInputSource(nullptr);
+    _second.testSetOutputSink(nullptr);
+    _second.testSetInputSource(nullptr);
+}
 
 const char* toString(LogLevel level) {
     switch (level) {
@@ -218,6 +553,41 @@ void timerEnd(hw_timer_t* /*timer*/) {
 }
 
 LogLevel minLogLevel = LogLevel::Info;
+DeferredLog* deferredLog = nullptr;
+
+namespace {
+    LogRing::Handler logListener = nullptr;
+    LogCapture* logCapture = nullptr;
+    bool logPrintOn = true;
+
+    void printLogRecord(const LogRecord& record) {
+        if (logPrintOn) {
+            if (record.tag != nullptr) {
+                Serial.printf("[%s] %s: %s\n", toString(record.level), record.tag, record.message);
+            }
+            else {
+                Serial.printf("[%s] %s\n", toString(record.level), record.message);
+            }
+        }
+        if (logCapture != nullptr) {
+            logCapture->add(record);
+        }
+        if (logListener != nullptr) {
+            logListener(record);
+        }
+    }
+}
+
+LogRing logRing(printLogRecord);
+
+void testSetLogListener(const LogRing::Handler listener) {
+    logListener = listener;
+}
+
+void testSetLogCapture(LogCapture* capture, const bool print) {
+    logCapture = capture;
+    logPrintOn = print || capture == nullptr;
+}
 
 // test only
 bool testIsTimerAlarmEnabled() { return espTimerAlarmEnabled; }
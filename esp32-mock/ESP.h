@@ -20,8 +20,19 @@
 #define WIN32_LEAN_AND_MEAN
 #define ARDUINO_ISR_ATTR
 #include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
 #include <SafeCString.h>
-    #include "StringArduino.h"
+#include "BytePipe.h"
+#include "ByteRing.h"
+#include "DeferredLog.h"
+#include "LogCapture.h"
+#include "LogRing.h"
+#include "SerialSink.h"
+#include "SerialSource.h"
+#include "Stream.h"
+#include "StringArduino.h"
 
 // ReSharper disable once CppUnusedIncludeDirective -- added on purpose
 #include "freertos/freeRTOS.h"
@@ -57,18 +68,75 @@ private:
 
 extern Esp ESP;
 
+// UART frame formats: bits 2-3 hold the data bits (5-8), bits 0-1 the parity (none, even, odd), bits 4-5 the stop bits (1, 1.5, 2)
+
+constexpr uint32_t SERIAL_5N1 = 0x8000010;
+constexpr uint32_t SERIAL_6N1 = 0x8000014;
+constexpr uint32_t SERIAL_7N1 = 0x8000018;
+constexpr uint32_t SERIAL_8N1 = 0x800001c;
+constexpr uint32_t SERIAL_5N2 = 0x8000030;
+constexpr uint32_t SERIAL_6N2 = 0x8000034;
+constexpr uint32_t SERIAL_7N2 = 0x8000038;
+constexpr uint32_t SERIAL_8N2 = 0x800003c;
+constexpr uint32_t SERIAL_5E1 = 0x8000012;
+constexpr uint32_t SERIAL_6E1 = 0x8000016;
+constexpr uint32_t SERIAL_7E1 = 0x800001a;
+constexpr uint32_t SERIAL_8E1 = 0x800001e;
+constexpr uint32_t SERIAL_5E2 = 0x8000032;
+constexpr uint32_t SERIAL_6E2 = 0x8000036;
+constexpr uint32_t SERIAL_7E2 = 0x800003a;
+constexpr uint32_t SERIAL_8E2 = 0x800003e;
+constexpr uint32_t SERIAL_5O1 = 0x8000013;
+constexpr uint32_t SERIAL_6O1 = 0x8000017;
+constexpr uint32_t SERIAL_7O1 = 0x800001b;
+constexpr uint32_t SERIAL_8O1 = 0x800001f;
+constexpr uint32_t SERIAL_5O2 = 0x8000033;
+constexpr uint32_t SERIAL_6O2 = 0x8000037;
+constexpr uint32_t SERIAL_7O2 = 0x800003b;
+constexpr uint32_t SERIAL_8O2 = 0x800003f;
+
+/**
+ * \brief Testing: what the UART timing model measured since begin()
+ */
+struct UartStatistics {
+    unsigned long long bytesWritten;
+    unsigned long long bytesRead;
+    unsigned long long txStallMicros;
+    unsigned long long rxOverflowBytes;
+};
+
 /**
  * \brief Mock implementation of the HardwareSerial class for unit testing (not targeting the ESP32)
  */
-class HardwareSerial {
+class HardwareSerial : public Stream {
 public:
-    int available();
-    void begin(int speed);
-    void print(const char* input);
-    void println();
-    void println(const char* input);
-    char read();
-    void setTimeout(long timeout);
+    explicit HardwareSerial(const int uartNumber = 0) : _uartNumber(uartNumber) {}
+    HardwareSerial(const HardwareSerial&) = delete;
+    HardwareSerial(HardwareSerial&&) = delete;
+    HardwareSerial& operator=(const HardwareSerial&) = delete;
+    HardwareSerial& operator=(HardwareSerial&&) = delete;
+    ~HardwareSerial() override = default;
+
+    using Print::write;
+    using Stream::readBytes;
+    using Stream::readBytesUntil;
+
+    int available() override;
+    int availableForWrite() override;
+    uint32_t baudRate() const { return _baudRate; }
+    void begin(unsigned long baud, uint32_t config = SERIAL_8N1, int8_t rxPin = -1, int8_t txPin = -1);
+    void flush() override;
+    int peek() override;
+    int read() override;
+    size_t readBytes(char* buffer, size_t length) override;
+    size_t readBytesUntil(char terminator, char* buffer, size_t length) override;
+    String readString() override;
+    String readStringUntil(char terminator) override;
+    size_t setRxBufferSize(size_t size);
+    size_t setTxBufferSize(size_t size);
+    size_t write(uint8_t value) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+    int uartNumber() const { return _uartNumber; }
 
     // test support (i.e. don't use in production code)
     void testClearInput();
@@ -76,24 +144,122 @@ public:
     const char* testGetOutput();
     void testSetInput(const char* input);
 
-    template <typename... Arguments>
-    int printf(const char* format, Arguments ... arguments) {
-        const int length = SafeCString::pointerSprintf(_printBufferPointer, _printBuffer, format, arguments...);
-        _printBufferPointer += length;
-        return length;
-    }
-
-    static constexpr size_t kPrintBufferSize = 4096;
+    /**
+     * \brief Testing: replace the input by binary data, which can contain null bytes
+     */
+    void testSetInput(const uint8_t* input, size_t length);
+
+    /**
+     * \brief Testing: read input from a source (e.g. a file, pipe or pty) when the buffered input runs out
+     * \param source the source to read from (not owned), nullptr to stop reading from it
+     */
+    void testSetInputSource(SerialSource* source);
+
+    /**
+     * \brief Testing: keep only the most recent output, so long runs don't keep everything in memory
+     * \param limit the maximum number of bytes testGetOutput returns, 0 for no limit (default)
+     */
+    void testSetOutputLimit(size_t limit);
+
+    /**
+     * \brief Testing: the number of output bytes dropped because of the output limit since the last clear
+     */
+    size_t testGetDroppedOutput() const;
+
+    /**
+     * \brief Testing: send the output to a sink (e.g. a file, stdout or a pty) as well. The sink is not owned
+     * \param sink the sink to send the output to, nullptr to stop sending (the old sink gets flushed)
+     * \param capture whether to keep the output in memory for testGetOutput as well
+     */
+    void testSetOutputSink(SerialSink* sink, bool capture = true);
+
+    /**
+     * \brief Testing: let bytes take time on the line at the configured baud rate and frame format.
+     * Writes stall (moving the clock) when the TX buffer is full, and input bytes only become readable once they
+     * have arrived. Bytes arriving while the RX buffer is full are lost. Off by default.
+     * \param on whether to model the UART timing
+     */
+    void testSetUartTiming(bool on);
+
+    /**
+     * \brief Testing: get what the UART timing model measured since begin()
+     */
+    UartStatistics testGetUartStatistics() const { return _uartStatistics; }
 
 private:
-    char _printBuffer[kPrintBufferSize] = {};
-    char* _printBufferPointer = _printBuffer;
-    static constexpr size_t kInputBufferSize = 100;
-    char _inputBuffer[kInputBufferSize] = {};
-    char* _inputBufferPointer = nullptr;
+    void append(const char* data, size_t length);
+    void trimOutput();
+    void transmit(size_t length);
+
+    size_t arrivedInput() const { return _timingOn ? _rxArrived : _input.size(); }
+    void discardInput(size_t length);
+    bool fillInput();
+    size_t popInput(uint8_t* buffer, size_t length);
+    size_t readableInput();
+    void receive(const uint8_t* data, size_t length);
+    void updateArrivals();
+    bool waitForInput();
+
+    int _uartNumber;
+    std::mutex _outputMutex;
+    std::string _output;
+    size_t _outputLimit = 0;
+    size_t _droppedOutput = 0;
+    SerialSink* _sink = nullptr;
+    bool _capture = true;
+
+    static constexpr size_t kInputChunkSize = 4096;
+    ByteRing _input;
+    SerialSource* _source = nullptr;
+
+    // the ESP32 has a 128 byte hardware FIFO, and the Arduino core uses a 256 byte RX buffer by default
+    static constexpr size_t kDefaultTxBufferSize = 128;
+    static constexpr size_t kDefaultRxBufferSize = 256;
+    uint32_t _baudRate = 115200;
+    long long _byteNanos = 86806;
+    bool _timingOn = false;
+    size_t _txBufferSize = kDefaultTxBufferSize;
+    size_t _rxBufferSize = kDefaultRxBufferSize;
+    long long _txBusyUntilNanos = 0;
+    long long _rxLineStartNanos = 0;
+    size_t _rxArrived = 0;
+    UartStatistics _uartStatistics{};
 };
 
 extern HardwareSerial Serial;
+extern HardwareSerial Serial1;
+extern HardwareSerial Serial2;
+
+/**
+ * \brief Testing: cross-wire two serial ports (TX of one to RX of the other and vice versa) via lock-free pipes,
+ * so they can exchange data at full speed, also when each side runs in its own thread.
+ * The ports no longer capture output for testGetOutput while linked. Destroying the link disconnects them.
+ */
+class SerialLink {
+public:
+    /**
+     * \param first one end of the link
+     * \param second the other end of the link
+     * \param capacity the number of bytes each direction can hold before bytes get lost
+     */
+    SerialLink(HardwareSerial& first, HardwareSerial& second, size_t capacity = BytePipe::kDefaultCapacity);
+    SerialLink(const SerialLink&) = delete;
+    SerialLink(SerialLink&&) = delete;
+    SerialLink& operator=(const SerialLink&) = delete;
+    SerialLink& operator=(SerialLink&&) = delete;
+    ~SerialLink();
+
+    /**
+     * \brief The number of bytes lost because the receiving side didn't keep up
+     */
+    size_t droppedBytes() const { return _firstToSecond.droppedBytes() + _secondToFirst.droppedBytes(); }
+
+private:
+    HardwareSerial& _first;
+    HardwareSerial& _second;
+    BytePipe _firstToSecond;
+    BytePipe _secondToFirst;
+};
 
 template <typename... Arguments>
 int redirectPrintf(const char* format, Arguments ... arguments) {
@@ -124,8 +290,18 @@ void delay(unsigned long delay);
 void delayMicroseconds(unsigned long delay);
 unsigned long micros();
 unsigned long millis();
+
+/**
+ * \brief Microseconds since start like micros(), but 64 bits so it doesn't wrap (from esp_timer.h)
+ */
+int64_t esp_timer_get_time();
 void yield();
 
+/**
+ * \brief Testing: the esp_timer_get_time() clock, without moving it forward like esp_timer_get_time() does when not in real time
+ */
+int64_t testPeekMicros();
+
 /**
  * \brief Testing: shift the micros() clock
  * \param shift micros to shift 
@@ -138,6 +314,33 @@ void testShiftMicros(long long shift);
  */
 void testSetRealTime(bool on);
 
+/**
+ * \brief Testing: set whether delay() and delayMicroseconds() sleep in real time mode, so the clock tracks the wall clock.
+ * Switching pacing on also switches on real time mode.
+ * \param on true: delays sleep until an absolute deadline, false: delays shift the clock without sleeping
+ * \param timeScale how much faster than the wall clock the mock clock runs (e.g. 10 to run 10x faster than real time)
+ */
+void testSetPacedRealTime(bool on, double timeScale = 1.0);
+
+/**
+ * \brief Testing: how far paced delays overshot their deadlines (in wall clock nanoseconds)
+ */
+struct PacingStatistics {
+    unsigned long sleepCount;
+    long long totalDriftNanos;
+    long long maxDriftNanos;
+};
+
+/**
+ * \brief Testing: get the drift statistics of the paced delays since the last reset
+ */
+PacingStatistics testGetPacingStatistics();
+
+/**
+ * \brief Testing: reset the drift statistics of the paced delays
+ */
+void testResetPacingStatistics();
+
 /**
  * \brief Testing: returns whether timer alarm is enabled
  */
@@ -163,39 +366,109 @@ inline void setLogLevel(const LogLevel level) {
     minLogLevel = level;
 }
 
+// log calls go through a lock-free queue, so tasks running concurrently (as threads) can log safely
+extern LogRing logRing;
+
+/**
+ * \brief Testing: get called for every log message printed, e.g. to see which task logged it
+ * \param listener the function to call, nullptr to stop calling it
+ */
+void testSetLogListener(LogRing::Handler listener);
+
+extern DeferredLog* deferredLog;
+
+/**
+ * \brief Testing: store log calls in a binary log instead of printing them, so formatting happens later (e.g. after a
+ * performance test) via DeferredLog::format or DeferredLog::dump. The log is not owned, and not meant for concurrent use.
+ * \param log the log to store the calls in, nullptr to print them immediately again (default)
+ */
+inline void testSetDeferredLog(DeferredLog* log) {
+    deferredLog = log;
+}
+
+/**
+ * \brief Testing: also keep log messages as entries that tests can query. The capture is not owned.
+ * \param capture the capture to add the messages to, nullptr to stop capturing
+ * \param print whether to keep printing the messages to Serial as well
+ */
+void testSetLogCapture(LogCapture* capture, bool print = true);
+
+/**
+ * \brief Log with the tag of the component that logs, which ESP_LOGx does (tags must stay valid, e.g. literals)
+ */
 template <typename... Arguments>
-void log_printf(const LogLevel level, const char* format, Arguments ... arguments) {
+void log_tag_printf(const LogLevel level, const char* tag, const char* format, Arguments ... arguments) {
     if (minLogLevel >= level) {
-        Serial.printf("[%s] ", toString(level));
-        Serial.printf(format, arguments...);
-        Serial.print("\n");
+        if (deferredLog != nullptr) {
+            deferredLog->record(level, testPeekMicros(), tag, format, arguments...);
+            return;
+        }
+        logRing.log(level, xTaskGetCurrentTaskHandle(), xPortGetCoreID(), testPeekMicros(), tag, format, arguments...);
     }
 }
 
 template <typename... Arguments>
-void log_e(const char* format, Arguments ... arguments) {
-    log_printf(LogLevel::Error, format, arguments...);
+void log_printf(const LogLevel level, const char* format, Arguments ... arguments) {
+    log_tag_printf(level, nullptr, format, arguments...);
 }
 
-template <typename... Arguments>
-void log_w(const char* format, Arguments ... arguments) {
-    log_printf(LogLevel::Warning, format, arguments...);
-}
+// Like in the Arduino core, CORE_DEBUG_LEVEL is the highest level compiled in: calls above it disappear entirely.
+// Calls at or below it are also skipped at run time (without evaluating the arguments) if minLogLevel is lower.
 
-template <typename... Arguments>
-void log_i(const char* format, Arguments ... arguments) {
-    log_printf(LogLevel::Info, format, arguments...);
-}
+#define ARDUHAL_LOG_LEVEL_NONE 0
+#define ARDUHAL_LOG_LEVEL_ERROR 1
+#define ARDUHAL_LOG_LEVEL_WARN 2
+#define ARDUHAL_LOG_LEVEL_INFO 3
+#define ARDUHAL_LOG_LEVEL_DEBUG 4
+#define ARDUHAL_LOG_LEVEL_VERBOSE 5
 
-template <typename... Arguments>
-void log_d(const char* format, Arguments ... arguments) {
-    log_printf(LogLevel::Debug, format, arguments...);
-}
+#ifndef CORE_DEBUG_LEVEL
+#define CORE_DEBUG_LEVEL ARDUHAL_LOG_LEVEL_VERBOSE
+#endif
 
-template <typename... Arguments>
-void log_v(const char* format, Arguments ... arguments) {
-    log_printf(LogLevel::Verbose, format, arguments...);
-}
+#define ESP32_MOCK_LOG(level, ...) do { if (minLogLevel >= (level)) log_printf((level), __VA_ARGS__); } while (false)
+#define ESP32_MOCK_LOG_TAG(level, tag, ...) \
+    do { if (minLogLevel >= (level)) log_tag_printf((level), (tag), __VA_ARGS__); } while (false)
+
+#if CORE_DEBUG_LEVEL >= ARDUHAL_LOG_LEVEL_ERROR
+#define log_e(...) ESP32_MOCK_LOG(LogLevel::Error, __VA_ARGS__)
+#define ESP_LOGE(tag, ...) ESP32_MOCK_LOG_TAG(LogLevel::Error, tag, __VA_ARGS__)
+#else
+#define log_e(...) do {} while (false)
+#define ESP_LOGE(tag, ...) do {} while (false)
+#endif
+
+#if CORE_DEBUG_LEVEL >= ARDUHAL_LOG_LEVEL_WARN
+#define log_w(...) ESP32_MOCK_LOG(LogLevel::Warning, __VA_ARGS__)
+#define ESP_LOGW(tag, ...) ESP32_MOCK_LOG_TAG(LogLevel::Warning, tag, __VA_ARGS__)
+#else
+#define log_w(...) do {} while (false)
+#define ESP_LOGW(tag, ...) do {} while (false)
+#endif
+
+#if CORE_DEBUG_LEVEL >= ARDUHAL_LOG_LEVEL_INFO
+#define log_i(...) ESP32_MOCK_LOG(LogLevel::Info, __VA_ARGS__)
+#define ESP_LOGI(tag, ...) ESP32_MOCK_LOG_TAG(LogLevel::Info, tag, __VA_ARGS__)
+#else
+#define log_i(...) do {} while (false)
+#define ESP_LOGI(tag, ...) do {} while (false)
+#endif
+
+#if CORE_DEBUG_LEVEL >= ARDUHAL_LOG_LEVEL_DEBUG
+#define log_d(...) ESP32_MOCK_LOG(LogLevel::Debug, __VA_ARGS__)
+#define ESP_LOGD(tag, ...) ESP32_MOCK_LOG_TAG(LogLevel::Debug, tag, __VA_ARGS__)
+#else
+#define log_d(...) do {} while (false)
+#define ESP_LOGD(tag, ...) do {} while (false)
+#endif
+
+#if CORE_DEBUG_LEVEL >= ARDUHAL_LOG_LEVEL_VERBOSE
+#define log_v(...) ESP32_MOCK_LOG(LogLevel::Verbose, __VA_ARGS__)
+#define ESP_LOGV(tag, ...) ESP32_MOCK_LOG_TAG(LogLevel::Verbose, tag, __VA_ARGS__)
+#else
+#define log_v(...) do {} while (false)
+#define ESP_LOGV(tag, ...) do {} while (false)
+#endif
 
 struct hw_timer_t {
     uint8_t group;
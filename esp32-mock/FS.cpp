@@ -19,52 +19,185 @@
 #include "FS.h"
 
 #include <algorithm>
+#include <cstring>
 #include "StringArduino.h"
 
 FS SPIFFS;
 
-std::map<std::string, FileData> File::_fileMap;
+
+namespace {
+	// folders made with mkdir have an entry without content in the store
+	bool isFolderEntry(const std::shared_ptr<FileData>& content) { return content == nullptr; }
+	bool isFolderEntry(size_t /*size*/) { return false; }
+	size_t entrySize(const std::shared_ptr<FileData>& content) { return content->size(); }
+	size_t entrySize(const size_t size) { return size; }
+
+	std::string folderPrefix(const std::string& path) {
+		return path.empty() || path.back() == '/' ? path : path + "/";
+	}
+
+	// the first entry at or after from, if its path starts with prefix
+	template <typename Map>
+	typename Map::const_iterator firstWithPrefix(const Map& map, const std::string& from, const std::string& prefix) {
+		const auto entry = map.lower_bound(from);
+		if (entry == map.end() || entry->first.compare(0, prefix.size(), prefix) != 0) return map.end();
+		return entry;
+	}
+
+	// Find the next file or subfolder directly in a folder, starting at resumeKey (or the start of the folder if empty)
+	template <typename Map>
+	bool nextChild(const Map& map, const std::string& prefix, std::string& resumeKey, std::string& child, bool& childIsFolder) {
+		auto entry = firstWithPrefix(map, resumeKey.empty() ? prefix : resumeKey, prefix);
+		if (entry != map.end() && entry->first == prefix) {
+			// the entry of the folder itself
+			entry = firstWithPrefix(map, prefix + '\0', prefix);
+		}
+		if (entry == map.end()) return false;
+		const auto slash = entry->first.find('/', prefix.size());
+		childIsFolder = slash != std::string::npos;
+		child = entry->first.substr(0, slash);
+
+		// all paths in a subfolder sort before child + '0', since '0' comes right after '/'
+		resumeKey = child + (childIsFolder ? '0' : '\0');
+		return true;
+	}
+
+	template <typename Map>
+	bool nextInFolder(const Map& map, const std::string& from, const std::string& prefix, std::string& path, size_t& size) {
+		auto entry = firstWithPrefix(map, from, prefix);
+		while (entry != map.end() && isFolderEntry(entry->second)) {
+			entry = firstWithPrefix(map, entry->first + '\0', prefix);
+		}
+		if (entry == map.end()) return false;
+		path = entry->first;
+		size = entrySize(entry->second);
+		return true;
+	}
+}
 
 File::operator bool() const {
 	return _valid;
 }
 
-size_t File::available() const {
-	return _currentPosition >= size() ? 0 : size() - _currentPosition;
+int File::available() {
+	const auto lock = lockContent();
+	return _currentPosition >= contentSize() ? 0 : static_cast<int>(contentSize() - _currentPosition);
 }
 
 void File::close() {
-	if (_valid && (_mode & kOut) == kOut) {
-		_fileMap[_path] = _content;
+	if (_valid && _counters != nullptr && _closePending->exchange(false)) {
+		_counters->countClose();
+		_fs->_totals.countClose();
 	}
+	flush();
+	_host.reset();
+	_node.reset();
+	_counters.reset();
+	_closePending.reset();
 	_currentPosition = 0;
-	_content.clear();
 	_path = "";
 	_exists = false;
 	_valid = false;
+	_isDirectory = false;
+	_resumeKey.clear();
+	_hostListing.reset();
+}
+
+// The content is contiguous, so these scan it directly rather than going byte by byte
+bool File::find(const char* target, const size_t length) {
+	if ((_mode & kIn) == 0)
+		return false;
+	if (length == 0)
+		return true;
+	const auto lock = lockContent();
+	const auto size = contentSize();
+	const auto data = contentData();
+	const auto end = data + size;
+	auto start = data + std::min(_currentPosition, size);
+	while (static_cast<size_t>(end - start) >= length) {
+		const auto first = static_cast<const uint8_t*>(memchr(start, target[0], end - start - length + 1));
+		if (first == nullptr)
+			break;
+		if (memcmp(first, target, length) == 0) {
+			countRead(first + length - start);
+			_currentPosition = first + length - data;
+			return true;
+		}
+		start = first + 1;
+	}
+	countRead(size - std::min(_currentPosition, size));
+	_currentPosition = size;
+	return false;
+}
+
+void File::flush() {
+	if (_host != nullptr) {
+		_host->flush();
+	}
+	else if (_node != nullptr && (_mode & kOut) == kOut) {
+		std::lock_guard<std::mutex> lock(_node->mutex);
+		_store->publish(*_node);
+	}
+}
+
+int File::peek() {
+	if ((_mode & kIn) == 0)
+		return -1;
+	const auto lock = lockContent();
+	if (_currentPosition >= contentSize())
+		return -1;
+	return contentData()[_currentPosition];
 }
 
 int File::read() {
 	if ((_mode & kIn) == 0)
 		return -1;
-	if (_currentPosition >= size())
+	const auto lock = lockContent();
+	if (_currentPosition >= contentSize())
 		return -1;
-	return _content[_currentPosition++];
+	countRead(1);
+	return contentData()[_currentPosition++];
 }
 
 size_t File::read(uint8_t* buffer, const size_t length) {
 	if ((_mode & kIn) == 0)
 		return 0;
-	size_t bytesRead = 0;
-	while (bytesRead < length && _currentPosition < size()) {
-		buffer[bytesRead] = _content[_currentPosition];
-		bytesRead++;
-		_currentPosition++;
-	}
+	const auto lock = lockContent();
+	if (_currentPosition >= contentSize())
+		return 0;
+	const size_t bytesRead = std::min(length, contentSize() - _currentPosition);
+	memcpy(buffer, contentData() + _currentPosition, bytesRead);
+	_currentPosition += bytesRead;
+	countRead(bytesRead);
+	return bytesRead;
+}
+
+size_t File::readBytes(char* buffer, const size_t length) {
+	return read(reinterpret_cast<uint8_t*>(buffer), length);
+}
+
+size_t File::readBytesUntil(const char terminator, char* buffer, const size_t length) {
+	if ((_mode & kIn) == 0)
+		return 0;
+	const auto lock = lockContent();
+	if (_currentPosition >= contentSize())
+		return 0;
+	const auto start = contentData() + _currentPosition;
+	const auto limit = std::min(length, contentSize() - _currentPosition);
+	const auto found = static_cast<const uint8_t*>(memchr(start, terminator, limit));
+	const size_t bytesRead = found == nullptr ? limit : found - start;
+	memcpy(buffer, start, bytesRead);
+	_currentPosition += bytesRead + (found == nullptr ? 0 : 1);
+	countRead(bytesRead + (found == nullptr ? 0 : 1));
 	return bytesRead;
 }
 
 void File::seek(const int offset, const SeekMode mode) {
+	if (_counters != nullptr) {
+		_counters->countSeek();
+		_fs->_totals.countSeek();
+	}
+	const auto size = this->size();
 	long newPos;
 	switch (mode) {
 		case SeekSet: newPos = offset;
@@ -73,110 +206,198 @@ void File::seek(const int offset, const SeekMode mode) {
 			break;
 		case SeekEnd:
 		default: 
-			newPos = static_cast<long>(size()) + offset;
+			newPos = static_cast<long>(size) + offset;
 	}
 
 	newPos = std::max<long>(newPos, 0);
-	if (newPos > static_cast<long>(size())) {
-		_currentPosition = size();
+	if (newPos > static_cast<long>(size)) {
+		_currentPosition = size;
 	}
 	else {
 		_currentPosition = static_cast<size_t>(newPos);
 	}
 }
 
+void File::countRead(const size_t length) const {
+	if (_counters == nullptr) return;
+	_counters->countRead(length);
+	_fs->_totals.countRead(length);
+}
+
+void File::countWrite(const size_t length, const size_t fileSize) const {
+	if (_counters == nullptr) return;
+	_counters->countWrite(length, fileSize);
+	_fs->_totals.countWrite(length, fileSize);
+}
+
 size_t File::size() const {
-	return _content.size();
+	const auto lock = lockContent();
+	return contentSize();
+}
+
+// host files are mapped on first access, so this can't be cached
+const uint8_t* File::contentData() const {
+	if (_host != nullptr) return _host->data();
+	return _node != nullptr ? _node->content->data() : nullptr;
+}
+
+size_t File::contentSize() const {
+	if (_host != nullptr) return _host->size();
+	return _node != nullptr ? _node->content->size() : 0;
+}
+
+// Host files aren't shared between handles, so they need no lock
+std::unique_lock<std::mutex> File::lockContent() const {
+	return _node != nullptr ? std::unique_lock<std::mutex>(_node->mutex) : std::unique_lock<std::mutex>();
 }
 
 String File::readString() {
 	if ((_mode & kIn) == 0)
 		return "";
-	if (_currentPosition >= size())
+	const auto lock = lockContent();
+	if (_currentPosition >= contentSize())
 		return "";
 
-	const auto length = size() - _currentPosition;
+	const auto length = contentSize() - _currentPosition;
 
 	String result;
 	result.reserve(static_cast<unsigned int>(length));
 
-	result.concat(reinterpret_cast<const char*>(&_content[_currentPosition]), length);
-	_currentPosition = _content.size();
+	result.concat(reinterpret_cast<const char*>(contentData() + _currentPosition), length);
+	_currentPosition = contentSize();
+	countRead(length);
+	return result;
+}
+
+String File::readStringUntil(const char terminator) {
+	if ((_mode & kIn) == 0)
+		return "";
+	const auto lock = lockContent();
+	if (_currentPosition >= contentSize())
+		return "";
+	const auto start = contentData() + _currentPosition;
+	const auto remaining = contentSize() - _currentPosition;
+	const auto found = static_cast<const uint8_t*>(memchr(start, terminator, remaining));
+	const size_t length = found == nullptr ? remaining : found - start;
+
+	String result;
+	result.concat(reinterpret_cast<const char*>(start), length);
+	_currentPosition += length + (found == nullptr ? 0 : 1);
+	countRead(length + (found == nullptr ? 0 : 1));
 	return result;
 }
 
-size_t File::write(const char character) {
-	return write(&character, 1);
+size_t File::write(const uint8_t value) {
+	return write(&value, 1);
 }
 
 size_t File::write(const uint8_t* buffer, const size_t size) {
-	if ((_mode & kAppend) == kAppend) {
-		_content.insert(_content.end(), buffer, buffer + size);
-		_currentPosition = _content.size();
-		return size;
+	if (_host != nullptr) {
+		if ((_mode & kOut) == 0) return 0;
+		if ((_mode & kAppend) == kAppend) {
+			_currentPosition = _host->size();
+		}
+		const auto written = _host->write(_currentPosition, buffer, size);
+		if (_flash != nullptr) _flash->write(_path, _currentPosition, written);
+		_currentPosition += written;
+		countWrite(written, _host->size());
+		return written;
 	}
-	if ((_mode & kOut) == 0) return 0;
+	if ((_mode & kOut) == 0 || _node == nullptr) return 0;
 
-	if (_currentPosition + size > _content.size()) {
-		_content.resize(_currentPosition + size);
-	}
-	for (size_t i = 0; i < size; i++) {
-		_content[_currentPosition + i] = buffer[i];
+	// only this file's lock, so tasks writing to different files don't wait for each other
+	std::lock_guard<std::mutex> lock(_node->mutex);
+	auto& content = _node->content;
+	if ((_mode & kAppend) == kAppend) {
+		_currentPosition = content->size();
 	}
-	_currentPosition += size;
-	return size;
-}
 
-size_t File::write(const char* str, const size_t length) {
-	return write(reinterpret_cast<const uint8_t*>(str), length);
+	const auto length = _store->write(*_node, _currentPosition, buffer, size);
+	if (length == 0) return 0;
+	if (_flash != nullptr) _flash->write(_node->path, _currentPosition, length);
+	_currentPosition += length;
+	countWrite(length, content->size());
+	return length;
 }
 
 void File::testDeleteFiles() {
-	_fileMap.clear();
+	SPIFFS.testDeleteFiles();
 }
 
 void File::testDefineFile(const char* path, const char* content) {
-	_fileMap[path].assign(content, content + strlen(content));
+	SPIFFS.testDefineFile(path, content);
 }
 
 size_t File::position() const { return _currentPosition; }
 
+const char* File::name() const {
+	const auto slash = _path.rfind('/');
+	return slash == std::string::npos ? _path.c_str() : _path.c_str() + slash + 1;
+}
+
+File File::openNextFile(const char* mode) {
+	if (!_isDirectory)
+		return {};
+	const auto prefix = folderPrefix(_path);
+	std::string child;
+	bool childIsFolder;
+	bool found;
+	if (_hostRoot.empty()) {
+		// a snapshot, so other threads can change the store meanwhile
+		found = nextChild(_store->snapshot().files(), prefix, _resumeKey, child, childIsFolder);
+	}
+	else {
+		// the host folder is listed once, on the first call
+		if (_hostListing == nullptr) {
+			_hostListing = std::make_shared<const std::map<std::string, size_t>>(HostFile::listFiles(_hostRoot, prefix.c_str()));
+		}
+		found = nextChild(*_hostListing, prefix, _resumeKey, child, childIsFolder);
+	}
+	if (!found)
+		return {};
+	const auto childMode = childIsFolder ? "r" : mode;
+	File result = _hostRoot.empty() ? File(*_store, child.c_str(), childMode) : File(child.c_str(), childMode, _hostRoot);
+	result._flash = _flash;
+	if (_fs != nullptr) {
+		_fs->track(result);
+	}
+	return result;
+}
+
 std::map<std::string, size_t> File::testGetFilesInFolder(const char* folder) {
 	std::map<std::string, size_t> result;
-	for (const auto& pair : _fileMap) {
-		if (pair.first.rfind(folder, 0) == 0) {
-			result[pair.first] = static_cast<int>(pair.second.size());
+	const auto snapshot = SPIFFS._store.snapshot();
+	for (const auto& pair : snapshot.files()) {
+		if (pair.second != nullptr && pair.first.rfind(folder, 0) == 0) {
+			result[pair.first] = static_cast<int>(pair.second->size());
 		}
 	}
 	return result;
 }
 
+// continues after the current path rather than keeping an iterator, so changes to the store don't invalidate it
 bool Dir::next() {
-	if (_first) {
-		_iterator = _files.begin();
-		_first = false;
-	}
-	else {
-		++_iterator;
-	}
-	return _iterator != _files.end();
+	const auto from = _first ? _prefix : _current + '\0';
+	_first = false;
+	return _store != nullptr
+		       ? nextInFolder(_store->snapshot().files(), from, _prefix, _current, _currentSize)
+		       : nextInFolder(*_listing, from, _prefix, _current, _currentSize);
 }
 
 String Dir::fileName() const {
-	return {_iterator->first.c_str()};
+	return {_current.c_str()};
 }
 
 size_t Dir::fileSize() const {
-	return _iterator->second;
+	return _currentSize;
 }
 
-Dir::Dir(const std::map<std::string, size_t>& files) : _files(files) {
-	_iterator = _files.begin();
-}
+Dir::Dir(const FileStore& store, const char* folder) : _store(&store), _prefix(folder) {}
 
-File::File(const char* path, const char* mode) {
-	_path = path;
-	_currentPosition = 0;
+Dir::Dir(const std::map<std::string, size_t>& files) : _listing(std::make_shared<const std::map<std::string, size_t>>(files)) {}
+
+// returns whether the file must be truncated
+bool File::setMode(const char* mode) {
 	auto truncate = false;
 	_mode = 0;
 	if (strchr(mode, 'r')) {
@@ -192,29 +413,196 @@ File::File(const char* path, const char* mode) {
 	if (strchr(mode, '+')) {
 		_mode |= kIn | kOut;
 	}
+	return truncate;
+}
 
-	// if the file does not exist, or we need to truncate, clear the file
-	if (_fileMap.find(path) == _fileMap.end() || truncate) {
-		_content.clear();
-		_exists = false;
+File::File(FileStore& store, const char* path, const char* mode) : _store(&store) {
+	_path = path;
+	_currentPosition = 0;
+	const auto truncate = setMode(mode);
+	_node = store.open(_path, (_mode & kOut) == kOut, truncate);
+	if (_node == nullptr) {
+		_isDirectory = _mode == kIn && store.isFolder(_path);
+		_exists = _isDirectory;
 	}
 	else {
-		_content = _fileMap[path];
 		if ((_mode & kAppend) == kAppend) {
-			_currentPosition = _content.size();
+			_currentPosition = size();
 		}
 		_exists = true;
 	}
-	_valid = _exists || (_mode & kOut) == kOut;
+	_valid = _exists;
+}
+
+File::File(const char* path, const char* mode, const std::string& hostRoot) {
+	_path = path;
+	const auto truncate = setMode(mode);
+	_hostRoot = hostRoot;
+	_host = HostFile::open(hostRoot + path, (_mode & kOut) == kOut, truncate);
+	_isDirectory = _host == nullptr && _mode == kIn && HostFile::isDirectory(hostRoot + path);
+	_exists = _host != nullptr || _isDirectory;
+	_valid = _exists;
+	if (_valid && (_mode & kAppend) == kAppend) {
+		_currentPosition = _host->size();
+	}
 }
 
 File FS::open(const char* path, const char* mode) {
 	if (!_started)
 		return {};
-	return {path, mode};
+	File file = _hostRoot.empty() ? File(_store, path, mode) : File(path, mode, _hostRoot);
+	if (_flash != nullptr && file) {
+		// truncating gives up the old blocks
+		if (strchr(mode, 'w')) {
+			_flash->release(path);
+		}
+		file._flash = _flash;
+	}
+	track(file);
+	return file;
 }
 
 Dir FS::openDir(const char* folder) {
-	const auto files = File::testGetFilesInFolder(folder);
-	return Dir(files);
+	if (_hostRoot.empty())
+		return {_store, folder};
+	return Dir(HostFile::listFiles(_hostRoot, folder));
+}
+
+// Counters are kept per path, so they add up over all the times a file was opened
+void FS::track(File& file) {
+	file._fs = this;
+	if (!file || file.isDirectory()) return;
+	{
+		std::lock_guard<std::mutex> lock(_countersMutex);
+		auto& counters = _fileCounters[file._path];
+		if (counters == nullptr) {
+			counters = std::make_shared<FileCounters>();
+		}
+		file._counters = counters;
+	}
+	file._closePending = std::make_shared<std::atomic<bool>>(true);
+	const auto size = file.size();
+	file._counters->countOpen(size);
+	_totals.countOpen(size);
+}
+
+bool FS::exists(const char* path) {
+	if (_hostRoot.empty())
+		return _store.exists(path);
+	return HostFile::exists(_hostRoot + path);
+}
+
+bool FS::mkdir(const char* path) {
+	if (_hostRoot.empty())
+		return _store.makeFolder(path);
+	return HostFile::makeDirectory(_hostRoot + path);
+}
+
+bool FS::remove(const char* path) {
+	if (_flash != nullptr) {
+		_flash->release(path);
+	}
+	if (_hostRoot.empty())
+		return _store.remove(path);
+	return !HostFile::isDirectory(_hostRoot + path) && std::remove((_hostRoot + path).c_str()) == 0;
+}
+
+bool FS::rename(const char* pathFrom, const char* pathTo) {
+	bool renamed;
+	if (_hostRoot.empty()) {
+		renamed = _store.rename(pathFrom, pathTo);
+	}
+	else {
+		renamed = !HostFile::exists(_hostRoot + pathTo) && std::rename((_hostRoot + pathFrom).c_str(), (_hostRoot + pathTo).c_str()) == 0;
+	}
+	if (renamed && _flash != nullptr) {
+		_flash->rename(pathFrom, pathTo);
+	}
+	return renamed;
+}
+
+bool FS::rmdir(const char* path) {
+	if (_hostRoot.empty())
+		return _store.removeFolder(path);
+	return HostFile::removeDirectory(_hostRoot + path);
+}
+
+size_t FS::totalBytes() {
+	if (_hostRoot.empty())
+		return _store.capacity();
+	return std::max(_store.capacity(), usedBytes());
+}
+
+size_t FS::usedBytes() {
+	if (_hostRoot.empty())
+		return _store.usedBytes();
+	size_t used = 0;
+	for (const auto& file : HostFile::listFiles(_hostRoot, "/")) {
+		used += file.second;
+	}
+	return used;
+}
+
+FileStatistics FS::testStatistics(const char* path) const {
+	std::lock_guard<std::mutex> lock(_countersMutex);
+	const auto counters = _fileCounters.find(path);
+	return counters == _fileCounters.end() ? FileStatistics{} : counters->second->statistics();
+}
+
+void FS::testDumpStatistics(SerialSink& sink) const {
+	std::string output;
+	{
+		std::lock_guard<std::mutex> lock(_countersMutex);
+		for (const auto& counters : _fileCounters) {
+			output += counters.second->statistics().format(counters.first.c_str());
+		}
+	}
+	output += _totals.statistics().format("total");
+	sink.write(output.c_str(), output.size());
+	sink.flush();
+}
+
+void FS::testResetStatistics() {
+	// open files keep counting into their counters, so those are reset rather than dropped
+	std::lock_guard<std::mutex> lock(_countersMutex);
+	for (auto counters = _fileCounters.begin(); counters != _fileCounters.end();) {
+		if (counters->second.use_count() == 1) {
+			counters = _fileCounters.erase(counters);
+			continue;
+		}
+		counters->second->reset();
+		++counters;
+	}
+	_totals.reset();
+}
+
+void FS::testDefineFile(const char* path, const char* content) {
+	// a new buffer, so files that are open keep seeing the old content
+	_store.store(path, std::make_shared<FileData>(content, content + strlen(content)));
+}
+
+void FS::testDeleteFiles() {
+	_store.clear();
+}
+
+FS::~FS() {
+	if (!_statisticsPath.empty()) {
+		FileSerialSink sink(_statisticsPath.c_str(), true);
+		if (sink.isOpen()) {
+			testDumpStatistics(sink);
+		}
+	}
+}
+
+bool FS::testExportImage(const char* path, const size_t blockSize) const {
+	std::vector<uint8_t> image;
+	if (blockSize == 0 || !LittleFSImage::write(_store, blockSize, _store.capacity() / blockSize, image)) return false;
+	const auto file = HostFile::open(path, true, true);
+	return file != nullptr && file->write(0, image.data(), image.size()) == image.size();
+}
+
+bool FS::testMountImage(const char* path, const size_t blockSize) {
+	const auto file = HostFile::open(path, false, false);
+	// the content is copied out of the mapped image, so the image can go once mounted
+	return file != nullptr && LittleFSImage::read(file->data(), file->size(), blockSize, _store);
 }
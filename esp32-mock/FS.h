@@ -13,11 +13,22 @@
 
 #ifndef FS_H
 #define FS_H
+#include "FileStatistics.h"
+#include "FileStore.h"
+#include "FlashModel.h"
+#include "HostFile.h"
+#include "LittleFSImage.h"
+#include "SerialSink.h"
+#include "Stream.h"
 #include "StringArduino.h"
+#include <atomic>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <vector>
 #include <cstdint>
 
+class FS;
 
 enum SeekMode: uint8_t {
     SeekSet = 0,
@@ -25,65 +36,275 @@ enum SeekMode: uint8_t {
     SeekEnd = 2
 };
 
-using FileData = std::vector<uint8_t>;
-
+/**
+ * \brief ESP8266 style folder listing. Iterates lazily over the (ordered) paths that start with the folder name
+ */
 class Dir {
 public:
     bool next();
     String fileName() const;
     size_t fileSize() const;
+
+    /**
+     * \param store the store to iterate over. It is not copied, so it must outlive the Dir
+     * \param folder the prefix of the paths to list
+     */
+    Dir(const FileStore& store, const char* folder);
+
+    /**
+     * \param files paths and sizes of the files to list
+     */
     explicit Dir(const std::map<std::string, size_t>& files);
 
 private:
     bool _first = true;
-    std::map<std::string, size_t> _files;
-    std::map<std::string, size_t>::iterator _iterator;
+    const FileStore* _store = nullptr;
+    std::shared_ptr<const std::map<std::string, size_t>> _listing;
+    std::string _prefix;
+    std::string _current;
+    size_t _currentSize = 0;
 };
 
-class File {
+class File : public Stream {
 public:
-    File(const char* path, const char* mode);
+    /**
+     * \brief Open a file (or a folder, for reading) in a file store. Handles on the same path share the file,
+     * so they see each other's writes. A handle itself is not meant to be shared between threads
+     * \param store the store of the FS that opens the file
+     * \param path the path of the file, starting with '/'
+     * \param mode the open mode ("r", "w", "a", optionally followed by "+")
+     */
+    File(FileStore& store, const char* path, const char* mode);
+
+    /**
+     * \brief Testing: open a file in a host directory rather than in a file store
+     * \param path the path of the file, starting with '/'
+     * \param mode the open mode, as for the other constructor
+     * \param hostRoot the host directory that the path is relative to
+     */
+    File(const char* path, const char* mode, const std::string& hostRoot);
     File() = default;
+    using Print::write;
+    using Stream::find;
+    using Stream::readBytes;
+    using Stream::readBytesUntil;
     explicit operator bool() const;
-    size_t available() const;
+    int available() override;
     void close();
+    bool find(const char* target, size_t length) override;
+
+    /**
+     * \brief Make the changes so far visible in the FS (sizes, listings, snapshots). Other handles see them already
+     */
+    void flush() override;
+    int peek() override;
     size_t position() const;
     void seek(int offset, SeekMode mode);
     size_t size() const;
-    int read();
+    int read() override;
     size_t read(uint8_t* buffer, size_t length);
-    String readString();
-    size_t write(char character);
-    size_t write(const char* str, size_t length);
-    size_t write(const uint8_t* buffer, size_t size);
+    size_t readBytes(char* buffer, size_t length) override;
+    size_t readBytesUntil(char terminator, char* buffer, size_t length) override;
+    String readString() override;
+    String readStringUntil(char terminator) override;
+    size_t write(uint8_t value) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+
+    // ESP32 style folder access. Folders exist implicitly, as prefixes of file paths.
+
+    bool isDirectory() const { return _isDirectory; }
+
+    /**
+     * \return the name of the file or folder without the path
+     */
+    const char* name() const;
+
+    /**
+     * \brief Open the next file or subfolder of this folder, in path order
+     * \param mode the mode to open files with
+     * \return the file or folder, or an invalid file if there are no more (or this isn't a folder)
+     */
+    File openNextFile(const char* mode = "r");
 
-    // testing only
+    const char* path() const { return _path.c_str(); }
+    void rewindDirectory() { _resumeKey.clear(); }
+
+    // testing only, on the SPIFFS store. Use the FS methods for other instances
     static void testDeleteFiles();
     static void testDefineFile(const char* path, const char* content);
     static std::map<std::string, size_t> testGetFilesInFolder(const char* folder);
 
 private:
+    friend class FS;
     size_t _currentPosition = 0;
     std::string _path;
-    FileData _content;
+    void countRead(size_t length) const;
+    void countWrite(size_t length, size_t fileSize) const;
+
+    // these expect the caller to hold the content lock
+    const uint8_t* contentData() const;
+    size_t contentSize() const;
+    std::unique_lock<std::mutex> lockContent() const;
+    bool setMode(const char* mode);
+
+    // shared by all handles on the path. The content is shared with the store and snapshots, and copied on the first change
+    std::shared_ptr<FileNode> _node;
+    FileStore* _store = nullptr;
+
+    // set if the file lives in a host directory. Copies of the handle share it, so they see each other's changes
+    std::shared_ptr<HostFile> _host;
+    FlashModel* _flash = nullptr;
+
+    // the FS that opened the file, and the I/O counters for its path (not set for folders)
+    FS* _fs = nullptr;
+    std::shared_ptr<FileCounters> _counters;
+
+    // whether the open is still to be closed. Copies of the handle share it, so an open counts one close
+    std::shared_ptr<std::atomic<bool>> _closePending;
+
+    // folder state: the root of the host directory (if any), and where openNextFile continues
+    bool _isDirectory = false;
+    std::string _hostRoot;
+    std::string _resumeKey;
+    std::shared_ptr<const std::map<std::string, size_t>> _hostListing;
     int _mode = 0;
     bool _exists = false;
     bool _valid = false;
     static constexpr int kIn = 1;
     static constexpr int kOut = 2;
     static constexpr int kAppend = 4;
-    static std::map <std::string, FileData> _fileMap;
 };
 
 // ReSharper disable CppInconsistentNaming
 
 class FS {
  public:
+     FS() = default;
+     FS(const FS&) = delete;
+     FS& operator=(const FS&) = delete;
+     ~FS();
      bool begin() { _started = true; return true; }
      File open(const char* path, const char* mode);
      Dir openDir(const char* folder);
+
+     bool exists(const char* path);
+     bool mkdir(const char* path);
+
+     /**
+      * \brief Remove a file
+      * \return whether the file existed
+      */
+     bool remove(const char* path);
+
+     /**
+      * \brief Rename a file or a folder
+      * \return whether it was renamed. Fails if the source doesn't exist or the target does
+      */
+     bool rename(const char* pathFrom, const char* pathTo);
+
+     /**
+      * \brief Remove a folder
+      * \return whether the folder existed and was empty
+      */
+     bool rmdir(const char* path);
+
+     /**
+      * \return the capacity. With a host root, at least what the files there use, since the capacity doesn't limit them
+      */
+     size_t totalBytes();
+
+     /**
+      * \return the bytes in use. With a host root, the size of the files there
+      */
+     size_t usedBytes();
+
+     void testDefineFile(const char* path, const char* content);
+     void testDeleteFiles();
+
+     /**
+      * \brief Testing: write the I/O statistics per file and in total, one line each
+      * \param sink the sink to write to
+      */
+     void testDumpStatistics(SerialSink& sink) const;
+
+     /**
+      * \brief Testing: append the I/O statistics to a file when the program ends
+      * \param path the file to append to, or an empty string to stop
+      */
+     void testDumpStatisticsAtExit(const char* path) { _statisticsPath = path; }
+
+     /**
+      * \brief Testing: write the files and folders to a LittleFS image, for use with e.g. esptool or littlefs tools
+      * \param path the host path of the image. Its size is the capacity, rounded down to whole blocks
+      * \param blockSize the block size of the image
+      * \return whether the image was written
+      */
+     bool testExportImage(const char* path, size_t blockSize = LittleFSImage::kDefaultBlockSize) const;
+
+     /**
+      * \brief Testing: replace the files and folders with those in a LittleFS image, e.g. as made by mklittlefs.
+      * The capacity becomes the size of the file system in the image
+      * \param path the host path of the image
+      * \param blockSize the block size the image was made with
+      * \return whether the image could be read. If not, the files are unchanged
+      */
+     bool testMountImage(const char* path, size_t blockSize = LittleFSImage::kDefaultBlockSize);
+
+     /**
+      * \brief Testing: go back to the files of a snapshot, in constant time. Files that are open are not affected
+      * \param snapshot the snapshot, taken from this or another FS
+      */
+     void testRestore(const FileStore::Snapshot& snapshot) { _store.restore(snapshot); }
+
+     /**
+      * \brief Testing: capture the files and folders, in constant time. Build a fixture once, and restore it per test
+      */
+     FileStore::Snapshot testSnapshot() const { return _store.snapshot(); }
+
+     /**
+      * \brief Testing: set the capacity. Writes that don't fit are cut short, like on a full partition
+      * \param capacity the capacity in bytes
+      */
+     void testSetCapacity(size_t capacity) { _store.setCapacity(capacity); }
+
+     /**
+      * \brief Testing: serve files from a host directory instead of the file store. Capacity isn't enforced there.
+      * Reads are memory mapped, so large fixtures are used in place. Handles see each other's changes once flushed,
+      * but not changes by other processes, and unlike the file store they aren't safe to use from several threads
+      * \param directory the host directory, or an empty string to go back to the file store
+      */
+     void testSetHostRoot(const char* directory) { _hostRoot = directory; }
+
+     /**
+      * \brief Testing: account for the flash cost of the writes to files opened from now on
+      * \param model the flash model, or nullptr to stop accounting
+      */
+     void testSetFlashModel(FlashModel* model) { _flash = model; }
+
+     /**
+      * \brief Testing: the I/O on all files since the start or the last reset. Folders don't count
+      */
+     FileStatistics testStatistics() const { return _totals.statistics(); }
+
+     /**
+      * \brief Testing: the I/O on one file since the start or the last reset, over all the times it was opened
+      * \param path the path the file was opened with
+      */
+     FileStatistics testStatistics(const char* path) const;
+
+     void testResetStatistics();
 private:
+    friend class File;
+    void track(File& file);
+
+    FileStore _store;
+    FlashModel* _flash = nullptr;
     bool _started = false;
+    std::string _hostRoot;
+    FileCounters _totals;
+    mutable std::mutex _countersMutex;
+    std::map<std::string, std::shared_ptr<FileCounters>> _fileCounters;
+    std::string _statisticsPath;
 };
 
 extern FS SPIFFS;
@@ -0,0 +1,69 @@
+// Copyright 2026 Rik Essenius
+// 
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file
+// except in compliance with the License. You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+// I/O counters for the FS mock, to catch firmware that reopens or rewrites files too often (not part of the ESP32 API)
+
+#include "FileStatistics.h"
+
+#include <cstdio>
+
+// the label can be a path of any length, so only the numbers go through the fixed buffer
+std::string FileStatistics::format(const char* label) const {
+    char buffer[320];
+    snprintf(buffer, sizeof buffer,
+             ": opens %llu, closes %llu, reads %llu (%llu bytes), writes %llu (%llu bytes), seeks %llu, largest %zu bytes\n",
+             static_cast<unsigned long long>(opens), static_cast<unsigned long long>(closes),
+             static_cast<unsigned long long>(reads), static_cast<unsigned long long>(bytesRead),
+             static_cast<unsigned long long>(writes), static_cast<unsigned long long>(bytesWritten),
+             static_cast<unsigned long long>(seeks), largestSize);
+    return label + std::string(buffer);
+}
+
+void FileCounters::countOpen(const size_t fileSize) {
+    _opens.fetch_add(1, std::memory_order_relaxed);
+    updateLargestSize(fileSize);
+}
+
+void FileCounters::countRead(const size_t length) {
+    _reads.fetch_add(1, std::memory_order_relaxed);
+    _bytesRead.fetch_add(length, std::memory_order_relaxed);
+}
+
+void FileCounters::countWrite(const size_t length, const size_t fileSize) {
+    _writes.fetch_add(1, std::memory_order_relaxed);
+    _bytesWritten.fetch_add(length, std::memory_order_relaxed);
+    updateLargestSize(fileSize);
+}
+
+void FileCounters::reset() {
+    _opens = 0;
+    _closes = 0;
+    _reads = 0;
+    _writes = 0;
+    _seeks = 0;
+    _bytesRead = 0;
+    _bytesWritten = 0;
+    _largestSize = 0;
+}
+
+FileStatistics FileCounters::statistics() const {
+    return {
+        _opens.load(std::memory_order_relaxed), _closes.load(std::memory_order_relaxed),
+        _reads.load(std::memory_order_relaxed), _writes.load(std::memory_order_relaxed),
+        _seeks.load(std::memory_order_relaxed), _bytesRead.load(std::memory_order_relaxed),
+        _bytesWritten.load(std::memory_order_relaxed), _largestSize.load(std::memory_order_relaxed)
+    };
+}
+
+void FileCounters::updateLargestSize(const size_t fileSize) {
+    auto largest = _largestSize.load(std::memory_order_relaxed);
+    while (fileSize > largest && !_largestSize.compare_exchange_weak(largest, fileSize, std::memory_order_relaxed)) {}
+}
@@ -0,0 +1,72 @@
+// Copyright 2026 Rik Essenius
+// 
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file
+// except in compliance with the License. You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+// I/O counters for the FS mock, to catch firmware that reopens or rewrites files too often (not part of the ESP32 API)
+
+#ifndef HEADER_FILE_STATISTICS
+#define HEADER_FILE_STATISTICS
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * \brief Testing: the I/O on a file or a file system so far
+ */
+struct FileStatistics {
+    uint64_t opens;
+    uint64_t closes;
+    uint64_t reads;
+    uint64_t writes;
+    uint64_t seeks;
+    uint64_t bytesRead;
+    uint64_t bytesWritten;
+    size_t largestSize;
+
+    /**
+     * \param label what the statistics are about, e.g. a path
+     * \return a line with the label and the statistics
+     */
+    std::string format(const char* label) const;
+};
+
+/**
+ * \brief Testing: counts I/O operations. Counting doesn't lock, so handles in different tasks can share the counters
+ */
+class FileCounters {
+public:
+    FileCounters() = default;
+    FileCounters(const FileCounters&) = delete;
+    FileCounters& operator=(const FileCounters&) = delete;
+
+    void countClose() { _closes.fetch_add(1, std::memory_order_relaxed); }
+    void countOpen(size_t fileSize);
+    void countRead(size_t length);
+    void countSeek() { _seeks.fetch_add(1, std::memory_order_relaxed); }
+    void countWrite(size_t length, size_t fileSize);
+    void reset();
+    FileStatistics statistics() const;
+
+private:
+    void updateLargestSize(size_t fileSize);
+
+    std::atomic<uint64_t> _opens{0};
+    std::atomic<uint64_t> _closes{0};
+    std::atomic<uint64_t> _reads{0};
+    std::atomic<uint64_t> _writes{0};
+    std::atomic<uint64_t> _seeks{0};
+    std::atomic<uint64_t> _bytesRead{0};
+    std::atomic<uint64_t> _bytesWritten{0};
+    std::atomic<size_t> _largestSize{0};
+};
+
+#endif
@@ -0,0 +1,367 @@
+// Copyright 2026 Rik Essenius
+// 
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file
+// except in compliance with the License. You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+// In-memory file storage for the FS mock (not part of the ESP32 API)
+
+#include "FileStore.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <vector>
+
+constexpr size_t FileStore::kDefaultCapacity;
+
+namespace {
+    std::string folderPrefix(const std::string& path) {
+        return path.empty() || path.back() == '/' ? path : path + "/";
+    }
+
+    bool startsWith(const std::string& text, const std::string& prefix) {
+        return text.compare(0, prefix.size(), prefix) == 0;
+    }
+}
+
+const FileMap& FileStore::Snapshot::files() const {
+    static const FileMap noFiles;
+    return _state == nullptr ? noFiles : _state->files;
+}
+
+FileStore::FileStore(const size_t capacity) :
+    _state(std::make_shared<State>()), _capacity(capacity), _unpublishedBytes(std::make_shared<std::atomic<size_t>>(0)) {}
+
+void FileStore::clear() {
+    std::lock_guard<std::mutex> openFilesLock(_openFilesMutex);
+    unlinkAll();
+    std::lock_guard<ReadWriteLock> lock(_lock);
+    // a fresh state, so snapshots keep theirs
+    _state = std::make_shared<State>();
+}
+
+void FileStore::erase(State& state, const FileMap::iterator entry) {
+    if (entry->second != nullptr) {
+        state.usedBytes -= entry->second->size();
+        state.lookup.erase(entry->first);
+    }
+    state.files.erase(entry);
+}
+
+bool FileStore::exists(const std::string& path) const {
+    ReadWriteLock::ReadGuard lock(_lock);
+    return find(*_state, path) != nullptr || isFolder(*_state, path);
+}
+
+// for writing, since the caller can read the content while writes change it in place under the read lock
+std::shared_ptr<FileData> FileStore::find(const std::string& path) const {
+    std::lock_guard<ReadWriteLock> lock(_lock);
+    return find(*_state, path);
+}
+
+std::shared_ptr<FileData> FileStore::find(const State& state, const std::string& path) {
+    const auto entry = state.lookup.find(path);
+    return entry == state.lookup.end() ? nullptr : entry->second->second;
+}
+
+bool FileStore::isFolder(const std::string& path) const {
+    ReadWriteLock::ReadGuard lock(_lock);
+    return isFolder(*_state, path);
+}
+
+bool FileStore::isFolder(const State& state, const std::string& path) {
+    const auto prefix = folderPrefix(path);
+    if (prefix == "/") return true;
+    const auto entry = state.files.lower_bound(prefix);
+    return entry != state.files.end() && startsWith(entry->first, prefix);
+}
+
+// expects the caller to hold the lock
+bool FileStore::isInStore(const FileNode& node) const {
+    if (!node.linked) return false;
+    const auto entry = _state->lookup.find(node.path);
+    return entry != _state->lookup.end() && entry->second->second == node.content;
+}
+
+bool FileStore::makeFolder(const std::string& path) {
+    std::lock_guard<ReadWriteLock> lock(_lock);
+    if (find(*_state, path) != nullptr) return false;
+    if (!isFolder(*_state, path)) {
+        writableState().files.emplace(folderPrefix(path), nullptr);
+    }
+    return true;
+}
+
+// for writing, since writes in place resize the content under the read lock
+size_t FileStore::maxFileSize(const std::string& path) const {
+    std::lock_guard<ReadWriteLock> lock(_lock);
+    const auto content = find(*_state, path);
+    const auto otherFiles = _state->usedBytes + *_unpublishedBytes - (content == nullptr ? 0 : content->size());
+    const size_t capacity = _capacity;
+    return otherFiles >= capacity ? 0 : capacity - otherFiles;
+}
+
+std::shared_ptr<FileNode> FileStore::open(const std::string& path, const bool create, const bool truncate) {
+    std::lock_guard<std::mutex> openFilesLock(_openFilesMutex);
+    const auto openFile = _openFiles.find(path);
+    auto node = openFile == _openFiles.end() ? nullptr : openFile->second.lock();
+    if (node != nullptr) {
+        if (truncate) {
+            std::lock_guard<std::mutex> nodeLock(node->mutex);
+            node->content = std::make_shared<FileData>();
+            publish(*node);
+        }
+        return node;
+    }
+
+    // opening shares the content rather than copying it, so opening a large file is O(1)
+    std::shared_ptr<FileData> content;
+    {
+        std::lock_guard<ReadWriteLock> lock(_lock);
+        content = find(*_state, path);
+        if (content == nullptr && (!create || isFolder(*_state, path))) return nullptr;
+        if (content == nullptr || truncate) {
+            content = std::make_shared<FileData>();
+            store(writableState(), path, content);
+        }
+    }
+    node = std::make_shared<FileNode>();
+    node->path = path;
+    node->content = std::move(content);
+    node->unpublishedBytes = _unpublishedBytes;
+
+    // closed files leave expired entries behind, so clean up whenever the map doubled
+    if (_openFiles.size() >= _pruneOpenFilesAt) {
+        for (auto entry = _openFiles.begin(); entry != _openFiles.end();) {
+            entry = entry->second.expired() ? _openFiles.erase(entry) : std::next(entry);
+        }
+        _pruneOpenFilesAt = std::max<size_t>(16, 2 * _openFiles.size());
+    }
+    _openFiles[path] = node;
+    return node;
+}
+
+void FileStore::publish(FileNode& node) {
+    if (!node.linked) return;
+    std::lock_guard<ReadWriteLock> lock(_lock);
+    // written in place, the store has the content already
+    if (isInStore(node)) return;
+    store(writableState(), node.path, node.content);
+    *_unpublishedBytes -= node.unpublished;
+    node.unpublished = 0;
+}
+
+bool FileStore::remove(const std::string& path) {
+    // open files are always in the store, so unlinking first is safe. Node mutexes must be taken before the lock
+    std::lock_guard<std::mutex> openFilesLock(_openFilesMutex);
+    unlink(path);
+    std::lock_guard<ReadWriteLock> lock(_lock);
+    if (find(*_state, path) == nullptr) return false;
+    auto& state = writableState();
+    erase(state, state.lookup.at(path));
+    return true;
+}
+
+bool FileStore::removeFolder(const std::string& path) {
+    std::lock_guard<ReadWriteLock> lock(_lock);
+    const auto prefix = folderPrefix(path);
+    const auto entry = _state->files.find(prefix);
+    if (entry == _state->files.end()) return false;
+    const auto next = std::next(entry);
+    if (next != _state->files.end() && startsWith(next->first, prefix)) return false;
+    writableState().files.erase(prefix);
+    return true;
+}
+
+bool FileStore::rename(const std::string& from, const std::string& to) {
+    if (from == "/") return false;
+    const auto fromPrefix = folderPrefix(from);
+    const auto toPrefix = folderPrefix(to);
+
+    // lock the open files that move, so they can't flush to their old path halfway through
+    std::lock_guard<std::mutex> openFilesLock(_openFilesMutex);
+    std::vector<std::pair<std::shared_ptr<FileNode>, std::unique_lock<std::mutex>>> moving;
+    for (auto entry = _openFiles.lower_bound(from); entry != _openFiles.end() && startsWith(entry->first, from); ++entry) {
+        if (entry->first != from && !startsWith(entry->first, fromPrefix)) continue;
+        if (auto node = entry->second.lock()) {
+            std::unique_lock<std::mutex> nodeLock(node->mutex);
+            moving.emplace_back(std::move(node), std::move(nodeLock));
+        }
+    }
+
+    {
+        std::lock_guard<ReadWriteLock> lock(_lock);
+        if (find(*_state, to) != nullptr || isFolder(*_state, to)) return false;
+        if (const auto content = find(*_state, from)) {
+            auto& state = writableState();
+            erase(state, state.lookup.at(from));
+            store(state, to, content);
+        }
+        else {
+            if (!isFolder(*_state, from)) return false;
+
+            // a folder is a contiguous range in the ordered index, so it moves in one pass
+            auto& state = writableState();
+            std::vector<std::pair<std::string, std::shared_ptr<FileData>>> moved;
+            auto entry = state.files.lower_bound(fromPrefix);
+            while (entry != state.files.end() && startsWith(entry->first, fromPrefix)) {
+                moved.emplace_back(toPrefix + entry->first.substr(fromPrefix.size()), entry->second);
+                const auto current = entry++;
+                erase(state, current);
+            }
+            for (const auto& item : moved) {
+                if (item.second == nullptr) {
+                    state.files.emplace(item.first, nullptr);
+                }
+                else {
+                    store(state, item.first, item.second);
+                }
+            }
+        }
+    }
+    for (auto& item : moving) {
+        auto& node = *item.first;
+        _openFiles.erase(node.path);
+        node.path = node.path == from ? to : toPrefix + node.path.substr(fromPrefix.size());
+        _openFiles[node.path] = item.first;
+    }
+    return true;
+}
+
+void FileStore::restore(const Snapshot& snapshot) {
+    std::lock_guard<std::mutex> openFilesLock(_openFilesMutex);
+    unlinkAll();
+    std::lock_guard<ReadWriteLock> lock(_lock);
+    // shared until the next change
+    _state = snapshot.empty() ? std::make_shared<State>() : std::const_pointer_cast<State>(snapshot._state);
+}
+
+// for writing, so no write is changing content in place while the state gets shared
+FileStore::Snapshot FileStore::snapshot() const {
+    std::lock_guard<ReadWriteLock> lock(_lock);
+    return Snapshot(_state);
+}
+
+void FileStore::store(const std::string& path, std::shared_ptr<FileData> content) {
+    std::lock_guard<std::mutex> openFilesLock(_openFilesMutex);
+    unlink(path);
+    std::lock_guard<ReadWriteLock> lock(_lock);
+    store(writableState(), path, std::move(content));
+}
+
+void FileStore::store(State& state, const std::string& path, std::shared_ptr<FileData> content) {
+    const auto entry = state.lookup.find(path);
+    state.usedBytes += content->size();
+    if (entry != state.lookup.end()) {
+        state.usedBytes -= entry->second->second->size();
+        entry->second->second = std::move(content);
+        return;
+    }
+    const auto inserted = state.files.emplace(path, std::move(content)).first;
+    state.lookup.emplace(path, inserted);
+}
+
+void FileStore::unlink(const std::string& path) {
+    const auto entry = _openFiles.find(path);
+    if (entry == _openFiles.end()) return;
+    if (const auto node = entry->second.lock()) {
+        std::lock_guard<std::mutex> nodeLock(node->mutex);
+        unlink(*node);
+    }
+    _openFiles.erase(entry);
+}
+
+// the growth of an unlinked file no longer takes space
+void FileStore::unlink(FileNode& node) {
+    node.linked = false;
+    *_unpublishedBytes -= node.unpublished;
+    node.unpublished = 0;
+}
+
+void FileStore::unlinkAll() {
+    for (const auto& entry : _openFiles) {
+        if (const auto node = entry.second.lock()) {
+            std::lock_guard<std::mutex> nodeLock(node->mutex);
+            unlink(*node);
+        }
+    }
+    _openFiles.clear();
+}
+
+// expects the caller to hold the lock. Takes what still fits from the capacity
+size_t FileStore::reserve(const size_t growth) {
+    const size_t capacity = _capacity;
+    auto unpublished = _unpublishedBytes->load();
+    size_t granted;
+    do {
+        const auto used = _state->usedBytes + unpublished;
+        granted = used >= capacity ? 0 : std::min(growth, capacity - used);
+    } while (granted > 0 && !_unpublishedBytes->compare_exchange_weak(unpublished, unpublished + granted));
+    return granted;
+}
+
+size_t FileStore::usedBytes() const {
+    ReadWriteLock::ReadGuard lock(_lock);
+    return _state->usedBytes + *_unpublishedBytes;
+}
+
+size_t FileStore::write(FileNode& node, const size_t position, const uint8_t* buffer, const size_t size) {
+    ReadWriteLock::ReadGuard lock(_lock);
+    auto& content = node.content;
+
+    // Only the node and the current state having the content means it's not shared.
+    // Snapshots share the state rather than the content, so that needs checking too.
+    auto inStore = isInStore(node);
+    if (content.use_count() > (inStore && _state.use_count() == 1 ? 2 : 1)) {
+        content = std::make_shared<FileData>(*content);
+        inStore = false;
+    }
+
+    // like on a full partition, only what still fits gets written. Other open files count with their unpublished growth.
+    // Unlinked files are no longer in the partition, so they can grow as they like
+    const auto currentSize = content->size();
+    const auto growth = position + size > currentSize ? position + size - currentSize : 0;
+    const auto granted = node.linked ? reserve(growth) : growth;
+    const auto newSize = currentSize + granted;
+    if (position >= newSize) {
+        *_unpublishedBytes -= node.linked ? granted : 0;
+        return 0;
+    }
+    if (inStore) {
+        // the store has the content, so its used bytes count the growth right away
+        _state->usedBytes += granted;
+        *_unpublishedBytes -= granted;
+    }
+    else if (node.linked) {
+        node.unpublished += granted;
+    }
+    const auto length = std::min(size, newSize - position);
+    if (newSize > currentSize) {
+        content->resize(newSize);
+    }
+    memcpy(content->data() + position, buffer, length);
+    return length;
+}
+
+// Snapshots share the state, so it is copied before the first change. That copies the index entries, not the content.
+FileStore::State& FileStore::writableState() {
+    if (_state.use_count() > 1) {
+        const auto copy = std::make_shared<State>();
+        copy->files = _state->files;
+        copy->lookup.reserve(_state->lookup.size());
+        for (auto entry = copy->files.begin(); entry != copy->files.end(); ++entry) {
+            if (entry->second != nullptr) {
+                copy->lookup.emplace(entry->first, entry);
+            }
+        }
+        copy->usedBytes = _state->usedBytes.load();
+        _state = copy;
+    }
+    return *_state;
+}
@@ -0,0 +1,240 @@
+// Copyright 2026 Rik Essenius
+// 
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file
+// except in compliance with the License. You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+// In-memory file storage for the FS mock (not part of the ESP32 API)
+
+#ifndef HEADER_FILE_STORE
+#define HEADER_FILE_STORE
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "ReadWriteLock.h"
+
+using FileData = std::vector<uint8_t>;
+
+// Ordered by path, so a folder is a contiguous range. Folders made with makeFolder have an entry
+// of their own: their path with a trailing '/', without content.
+using FileMap = std::map<std::string, std::shared_ptr<FileData>>;
+
+/**
+ * \brief Testing: a file that is open. All handles on its path share it, so they see each other's changes right away.
+ * Hold the mutex while using the content. The content gets to the store when a handle flushes or closes.
+ */
+struct FileNode {
+    FileNode() = default;
+    FileNode(const FileNode&) = delete;
+    FileNode& operator=(const FileNode&) = delete;
+
+    // a handle dropped without flushing or closing gives back what its copy reserved
+    ~FileNode() {
+        if (unpublishedBytes != nullptr) {
+            *unpublishedBytes -= unpublished;
+        }
+    }
+
+    std::mutex mutex;
+    std::string path;
+    std::shared_ptr<FileData> content;
+
+    // false once the file was removed or replaced in the store; then flushing no longer changes the store
+    bool linked = true;
+
+    // how much a copy of the content that the store doesn't have yet grew, as counted in the store's unpublished bytes
+    size_t unpublished = 0;
+
+    // the store's count of unpublished bytes, shared so it outlives the store if the node does
+    std::shared_ptr<std::atomic<size_t>> unpublishedBytes;
+};
+
+/**
+ * \brief Testing: the files of one FS instance. Paths are looked up via a hash index, and listed via an ordered index.
+ * The indexes are shared with snapshots, and copied on the first change after taking or restoring one.
+ * Safe to use from several threads: the indexes are under a reader-writer lock, open files each have their own mutex.
+ * Writes to an open file hold the lock for reading, so taking a snapshot (for writing) can't see a write halfway.
+ */
+class FileStore {
+    struct State;
+public:
+    /**
+     * \brief Testing: the files and folders of a store at one moment. Shares the content with the store
+     */
+    class Snapshot {
+    public:
+        Snapshot() = default;
+        bool empty() const { return _state == nullptr; }
+
+        /**
+         * \return the ordered index. It doesn't change, so it can be iterated while the store changes
+         */
+        const FileMap& files() const;
+    private:
+        friend class FileStore;
+        explicit Snapshot(std::shared_ptr<const State> state) : _state(std::move(state)) {}
+        std::shared_ptr<const State> _state;
+    };
+
+    // the SPIFFS partition size in the default ESP32 partition table
+    static constexpr size_t kDefaultCapacity = 0x160000;
+
+    explicit FileStore(size_t capacity = kDefaultCapacity);
+    FileStore(const FileStore&) = delete;
+    FileStore& operator=(const FileStore&) = delete;
+
+    size_t capacity() const { return _capacity; }
+    void setCapacity(const size_t capacity) { _capacity = capacity; }
+
+    /**
+     * \brief Remove all files and folders. Files that are open get unlinked
+     */
+    void clear();
+
+    /**
+     * \return whether path is a file or a folder
+     */
+    bool exists(const std::string& path) const;
+
+    /**
+     * \return the content of a file, or nullptr if there is no such file. Holding on to it makes writes copy the content
+     */
+    std::shared_ptr<FileData> find(const std::string& path) const;
+
+    /**
+     * \return the ordered index. Only valid until the next change; use snapshot().files() if other threads may change it
+     */
+    const FileMap& files() const { return _state->files; }
+
+    /**
+     * \return whether path is a folder: the root, made with makeFolder, or containing files
+     */
+    bool isFolder(const std::string& path) const;
+
+    /**
+     * \brief Make a folder. Its parents exist implicitly
+     * \return whether the folder exists now (false if there is a file with that path)
+     */
+    bool makeFolder(const std::string& path);
+
+    /**
+     * \return the largest size a file that isn't open can grow to without exceeding the capacity
+     */
+    size_t maxFileSize(const std::string& path) const;
+
+    /**
+     * \brief Open a file, sharing the node with the other handles that have it open
+     * \param path the path of the file
+     * \param create whether to create the file if it doesn't exist. New files are stored right away
+     * \param truncate whether to empty the file, for all handles
+     * \return the node, or nullptr if the file doesn't exist and isn't created (or a folder has that path)
+     */
+    std::shared_ptr<FileNode> open(const std::string& path, bool create, bool truncate);
+
+    /**
+     * \brief Store the content of an open file, unless it got unlinked. The caller holds the node's mutex
+     */
+    void publish(FileNode& node);
+
+    /**
+     * \brief Remove a file. If it is open, it gets unlinked: its handles keep the content
+     * \return whether the file existed
+     */
+    bool remove(const std::string& path);
+
+    /**
+     * \brief Remove an empty folder
+     * \return whether the folder existed and was empty
+     */
+    bool removeFolder(const std::string& path);
+
+    /**
+     * \brief Go back to the files and folders of a snapshot, in constant time. Files that are open get unlinked
+     * \param snapshot the snapshot to restore. An empty snapshot clears the store
+     */
+    void restore(const Snapshot& snapshot);
+
+    /**
+     * \brief Rename a file or a folder (with everything in it). Open files move along
+     * \return whether it was renamed. Fails if the source doesn't exist or the target does
+     */
+    bool rename(const std::string& from, const std::string& to);
+
+    /**
+     * \brief Create or replace a file. Capacity is enforced when writing, not here. If it is open, it gets unlinked
+     * \param path the path of the file
+     * \param content the new content, which is shared rather than copied
+     */
+    void store(const std::string& path, std::shared_ptr<FileData> content);
+
+    /**
+     * \brief Take a snapshot, in constant time
+     */
+    Snapshot snapshot() const;
+
+    /**
+     * \return the bytes in use, including what open files wrote but didn't publish yet, so capacity holds over all writers
+     */
+    size_t usedBytes() const;
+
+    /**
+     * \brief Write to an open file, as far as the capacity allows. The caller holds the node's mutex.
+     * The content is changed in place if only the store has it too, so appending and flushing is O(1) per write.
+     * If a snapshot, an older state or a caller of find still has it, the file gets its own copy first
+     * \param node the open file
+     * \param position where to write. Beyond the end of the file, the gap is filled with zeros
+     * \param buffer the data to write
+     * \param size the number of bytes to write
+     * \return the number of bytes written
+     */
+    size_t write(FileNode& node, size_t position, const uint8_t* buffer, size_t size);
+
+private:
+    struct State {
+        FileMap files;
+        std::unordered_map<std::string, FileMap::iterator> lookup;
+        // the sizes of the stored content. Writes in place add to it while holding the lock for reading
+        std::atomic<size_t> usedBytes{0};
+    };
+
+    // these expect the caller to hold the lock
+    static void erase(State& state, FileMap::iterator entry);
+    static std::shared_ptr<FileData> find(const State& state, const std::string& path);
+    static bool isFolder(const State& state, const std::string& path);
+    bool isInStore(const FileNode& node) const;
+    size_t reserve(size_t growth);
+    static void store(State& state, const std::string& path, std::shared_ptr<FileData> content);
+    State& writableState();
+
+    // these expect the caller to hold the open files mutex
+    void unlink(const std::string& path);
+    void unlinkAll();
+
+    // this expects the caller to hold the node's mutex
+    void unlink(FileNode& node);
+
+    mutable ReadWriteLock _lock;
+    std::shared_ptr<State> _state;
+    std::atomic<size_t> _capacity;
+
+    // what open files that have their own copy of the content grew, but didn't publish yet
+    std::shared_ptr<std::atomic<size_t>> _unpublishedBytes;
+
+    // the files that are open, so new handles can share their node
+    std::mutex _openFilesMutex;
+    std::map<std::string, std::weak_ptr<FileNode>> _openFiles;
+    size_t _pruneOpenFilesAt = 16;
+};
+
+#endif
@@ -0,0 +1,162 @@
+// Copyright 2026 Rik Essenius
+// 
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file
+// except in compliance with the License. You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+// Flash cost model for the FS mock, to compare write strategies by wear and stall time (not part of the ESP32 API)
+
+#include "FlashModel.h"
+
+#include <algorithm>
+#include "ESP.h"
+
+double FlashStatistics::writeAmplification() const {
+    return bytesWritten == 0 ? 0.0 : static_cast<double>(bytesProgrammed) / static_cast<double>(bytesWritten);
+}
+
+FlashModel::FlashModel(const size_t blockCount, const size_t blockSize, const size_t pageSize, const size_t programSize,
+                       const unsigned long pageProgramMicros, const unsigned long blockEraseMicros) :
+    _initialBlockCount(blockCount),
+    _blockSize(blockSize),
+    _pageSize(pageSize),
+    _programSize(programSize),
+    _pageProgramMicros(pageProgramMicros),
+    _blockEraseMicros(blockEraseMicros) {
+    reset();
+}
+
+// Prefers the least worn free block, like the wear leveling of LittleFS and SPIFFS does
+size_t FlashModel::allocate() {
+    size_t best = _blocks.size();
+    for (size_t i = 0; i < _blocks.size(); i++) {
+        if (!_blocks[i].inUse && (best == _blocks.size() || _blocks[i].eraseCount < _blocks[best].eraseCount)) {
+            best = i;
+        }
+    }
+    if (best == _blocks.size()) {
+        _blocks.push_back(Block{0, false, std::vector<bool>(_blockSize / _programSize, false)});
+    }
+    auto& block = _blocks[best];
+    block.inUse = true;
+
+    // a released block still holds the old data, so it needs an erase before it can be used
+    if (std::find(block.programmed.begin(), block.programmed.end(), true) != block.programmed.end()) {
+        erase(block);
+        _statistics.busyMicros += _blockEraseMicros;
+        delayMicroseconds(_blockEraseMicros);
+    }
+    return best;
+}
+
+void FlashModel::erase(Block& block) {
+    block.eraseCount++;
+    std::fill(block.programmed.begin(), block.programmed.end(), false);
+    _statistics.blockErases++;
+    _statistics.maxBlockErases = std::max(_statistics.maxBlockErases, block.eraseCount);
+}
+
+uint32_t FlashModel::eraseCount(const size_t block) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return block < _blocks.size() ? _blocks[block].eraseCount : 0;
+}
+
+size_t FlashModel::physicalBlock(const std::string& path, const size_t logicalBlock) {
+    auto& blocks = _fileBlocks[path];
+    while (blocks.size() <= logicalBlock) {
+        blocks.push_back(allocate());
+    }
+    return blocks[logicalBlock];
+}
+
+void FlashModel::release(const std::string& path) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    releaseBlocks(path);
+}
+
+void FlashModel::releaseBlocks(const std::string& path) {
+    const auto entry = _fileBlocks.find(path);
+    if (entry == _fileBlocks.end()) return;
+    for (const auto block : entry->second) {
+        _blocks[block].inUse = false;
+    }
+    _fileBlocks.erase(entry);
+}
+
+void FlashModel::rename(const std::string& from, const std::string& to) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    const auto entry = _fileBlocks.find(from);
+    if (entry == _fileBlocks.end()) return;
+    releaseBlocks(to);
+    auto blocks = std::move(entry->second);
+    _fileBlocks.erase(entry);
+    _fileBlocks[to] = std::move(blocks);
+}
+
+void FlashModel::reset() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _blocks.assign(_initialBlockCount, Block{0, false, std::vector<bool>(_blockSize / _programSize, false)});
+    _fileBlocks.clear();
+    _statistics = FlashStatistics{};
+}
+
+FlashStatistics FlashModel::statistics() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _statistics;
+}
+
+void FlashModel::write(const std::string& path, const size_t offset, const size_t length) {
+    if (length == 0) return;
+
+    // one flash chip does one thing at a time, so writes from different tasks queue up here
+    std::lock_guard<std::mutex> lock(_mutex);
+    const auto unitsPerBlock = _blockSize / _programSize;
+    uint64_t busyMicros = 0;
+    uint64_t pagesProgrammed = 0;
+    uint64_t unitsProgrammed = 0;
+    const auto end = offset + length;
+    for (auto logicalBlock = offset / _blockSize; logicalBlock * _blockSize < end; logicalBlock++) {
+        const auto blockStart = logicalBlock * _blockSize;
+        const auto firstUnit = (std::max(offset, blockStart) - blockStart) / _programSize;
+        const auto lastUnit = (std::min(end, blockStart + _blockSize) - 1 - blockStart) / _programSize;
+        auto& block = _blocks[physicalBlock(path, logicalBlock)];
+
+        // programming only clears bits, so rewriting a unit means erasing the block and restoring the rest of it
+        bool needsErase = false;
+        for (auto unit = firstUnit; unit <= lastUnit && !needsErase; unit++) {
+            needsErase = block.programmed[unit];
+        }
+        std::vector<bool> holdsData;
+        if (needsErase) {
+            holdsData = block.programmed;
+            erase(block);
+            busyMicros += _blockEraseMicros;
+        }
+
+        // after an erase, the whole block gets programmed again; otherwise just the written units
+        const auto from = needsErase ? 0 : firstUnit;
+        const auto to = needsErase ? unitsPerBlock - 1 : lastUnit;
+        auto previousPage = _blockSize;
+        for (auto unit = from; unit <= to; unit++) {
+            if ((unit < firstUnit || unit > lastUnit) && !holdsData[unit]) continue;
+            block.programmed[unit] = true;
+            unitsProgrammed++;
+            const auto page = unit * _programSize / _pageSize;
+            if (page != previousPage) {
+                pagesProgrammed++;
+                previousPage = page;
+            }
+        }
+    }
+    busyMicros += pagesProgrammed * _pageProgramMicros;
+    _statistics.bytesWritten += length;
+    _statistics.pagesProgrammed += pagesProgrammed;
+    _statistics.bytesProgrammed += unitsProgrammed * _programSize;
+    _statistics.busyMicros += busyMicros;
+    delayMicroseconds(static_cast<unsigned long>(busyMicros));
+}
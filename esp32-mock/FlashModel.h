@@ -0,0 +1,126 @@
+// Copyright 2026 Rik Essenius
+// 
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file
+// except in compliance with the License. You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+// Flash cost model for the FS mock, to compare write strategies by wear and stall time (not part of the ESP32 API)
+
+#ifndef HEADER_FLASH_MODEL
+#define HEADER_FLASH_MODEL
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * \brief Testing: what the writes cost so far
+ */
+struct FlashStatistics {
+    uint64_t bytesWritten;
+    uint64_t bytesProgrammed;
+    uint64_t pagesProgrammed;
+    uint64_t blockErases;
+    uint32_t maxBlockErases;
+    uint64_t busyMicros;
+
+    /**
+     * \return programmed bytes per byte written, or 0 if nothing was written yet
+     */
+    double writeAmplification() const;
+};
+
+/**
+ * \brief Testing: NOR flash under a file system. Files get whole blocks. Erased bytes can be programmed in units of
+ * the program size, so appending to a page needs no erase. Writing to a unit that was programmed already erases
+ * its block, and reprograms the rest of the data in it. Programming costs the page program time for every page
+ * it touches. Program and erase time is charged to the mock clock via delayMicroseconds().
+ * Safe to share between threads.
+ */
+class FlashModel {
+public:
+    /**
+     * \param blockCount the number of erase blocks. More are added if the files need them
+     * \param blockSize the erase block size in bytes
+     * \param pageSize the program page size in bytes, a divisor of blockSize
+     * \param programSize the smallest unit that can be programmed, a divisor of pageSize. NOR flash programs single
+     * bytes; use e.g. the prog_size of LittleFS to model a file system that programs larger units
+     * \param pageProgramMicros the time to program (part of) a page
+     * \param blockEraseMicros the time to erase a block
+     */
+    explicit FlashModel(size_t blockCount = 256, size_t blockSize = 4096, size_t pageSize = 256, size_t programSize = 1,
+                        unsigned long pageProgramMicros = 700, unsigned long blockEraseMicros = 45000);
+
+    size_t blockCount() const { return _blocks.size(); }
+    size_t blockSize() const { return _blockSize; }
+    size_t pageSize() const { return _pageSize; }
+    size_t programSize() const { return _programSize; }
+
+    /**
+     * \param block the (physical) block number
+     * \return the number of times the block was erased
+     */
+    uint32_t eraseCount(size_t block) const;
+
+    /**
+     * \brief Forget the blocks of a file, e.g. when it is truncated or removed. They get erased when reused
+     * \param path the file path
+     */
+    void release(const std::string& path);
+
+    /**
+     * \brief Move the blocks of a renamed file to its new name
+     * \param from the old path
+     * \param to the new path
+     */
+    void rename(const std::string& from, const std::string& to);
+
+    /**
+     * \brief Start over with fresh blocks and zero statistics
+     */
+    void reset();
+
+    FlashStatistics statistics() const;
+
+    /**
+     * \brief Account for writing to a file
+     * \param path the file path
+     * \param offset the position in the file
+     * \param length the number of bytes written
+     */
+    void write(const std::string& path, size_t offset, size_t length);
+
+private:
+    struct Block {
+        uint32_t eraseCount;
+        bool inUse;
+        // by program unit
+        std::vector<bool> programmed;
+    };
+
+    size_t allocate();
+    void erase(Block& block);
+    size_t physicalBlock(const std::string& path, size_t logicalBlock);
+    void releaseBlocks(const std::string& path);
+
+    size_t _initialBlockCount;
+    size_t _blockSize;
+    size_t _pageSize;
+    size_t _programSize;
+    unsigned long _pageProgramMicros;
+    unsigned long _blockEraseMicros;
+    std::vector<Block> _blocks;
+    std::map<std::string, std::vector<size_t>> _fileBlocks;
+    FlashStatistics _statistics{};
+    mutable std::mutex _mutex;
+};
+
+#endif
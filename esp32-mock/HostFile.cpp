@@ -0,0 +1,290 @@
+// Copyright 2026 Rik Essenius
+// 
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file
+// except in compliance with the License. You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+// Host file backing for the FS mock, so fixtures can be used in place (not targeting the ESP32)
+
+#include "HostFile.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <mutex>
+
+#ifdef _WIN32
+#include <direct.h>
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+constexpr size_t HostFile::kWriteBufferSize;
+
+namespace {
+    void createParentFolders(const std::string& path) {
+        for (auto separator = path.find('/', 1); separator != std::string::npos; separator = path.find('/', separator + 1)) {
+            const auto folder = path.substr(0, separator);
+#ifdef _WIN32
+            _mkdir(folder.c_str());
+#else
+            mkdir(folder.c_str(), 0777);
+#endif
+        }
+    }
+
+    // the version counter of a path, shared by all handles on it
+    std::shared_ptr<std::atomic<unsigned long>> versionOf(const std::string& path) {
+        static std::mutex mutex;
+        static std::map<std::string, std::weak_ptr<std::atomic<unsigned long>>> versions;
+        std::lock_guard<std::mutex> lock(mutex);
+        auto& entry = versions[path];
+        auto result = entry.lock();
+        if (result == nullptr) {
+            result = std::make_shared<std::atomic<unsigned long>>(0);
+            entry = result;
+        }
+        return result;
+    }
+
+    void addFiles(const std::string& root, const std::string& relative, const char* folder, std::map<std::string, size_t>& result) {
+#ifdef _WIN32
+        WIN32_FIND_DATAA entry;
+        const HANDLE search = FindFirstFileA((root + relative + "/*").c_str(), &entry);
+        if (search == INVALID_HANDLE_VALUE) return;
+        do {
+            const std::string name = entry.cFileName;
+            if (name == "." || name == "..") continue;
+            const auto path = relative + "/" + name;
+            if ((entry.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0) {
+                addFiles(root, path, folder, result);
+            }
+            else if (path.rfind(folder, 0) == 0) {
+                result[path] = static_cast<size_t>(entry.nFileSizeHigh) << 32 | entry.nFileSizeLow;
+            }
+        } while (FindNextFileA(search, &entry));
+        FindClose(search);
+#else
+        DIR* directory = opendir((root + relative).c_str());
+        if (directory == nullptr) return;
+        while (const dirent* entry = readdir(directory)) {
+            const std::string name = entry->d_name;
+            if (name == "." || name == "..") continue;
+            const auto path = relative + "/" + name;
+            struct stat status{};
+            if (stat((root + path).c_str(), &status) != 0) continue;
+            if (S_ISDIR(status.st_mode)) {
+                addFiles(root, path, folder, result);
+            }
+            else if (S_ISREG(status.st_mode) && path.rfind(folder, 0) == 0) {
+                result[path] = static_cast<size_t>(status.st_size);
+            }
+        }
+        closedir(directory);
+#endif
+    }
+}
+
+std::shared_ptr<HostFile> HostFile::open(const std::string& path, const bool write, const bool truncate) {
+    if (write) {
+        createParentFolders(path);
+    }
+    std::shared_ptr<HostFile> file(new HostFile());
+#ifdef _WIN32
+    if (write && !truncate) {
+        file->_stream = std::fopen(path.c_str(), "r+b");
+    }
+    if (file->_stream == nullptr) {
+        file->_stream = std::fopen(path.c_str(), write ? "w+b" : "rb");
+    }
+    if (file->_stream == nullptr) return nullptr;
+    _fseeki64(file->_stream, 0, SEEK_END);
+    file->_fileSize = static_cast<size_t>(_ftelli64(file->_stream));
+#else
+    int flags = write ? O_RDWR | O_CREAT : O_RDONLY;
+    if (truncate) {
+        flags |= O_TRUNC;
+    }
+    file->_descriptor = ::open(path.c_str(), flags, 0666);
+    if (file->_descriptor < 0) return nullptr;
+    struct stat status{};
+    if (fstat(file->_descriptor, &status) != 0 || !S_ISREG(status.st_mode)) return nullptr;
+    file->_fileSize = static_cast<size_t>(status.st_size);
+#endif
+    file->_version = versionOf(path);
+    file->_seenVersion = file->_version->load();
+    if (truncate) {
+        file->changed();
+    }
+    return file;
+}
+
+bool HostFile::exists(const std::string& path) {
+#ifdef _WIN32
+    return GetFileAttributesA(path.c_str()) != INVALID_FILE_ATTRIBUTES;
+#else
+    struct stat status{};
+    return stat(path.c_str(), &status) == 0;
+#endif
+}
+
+bool HostFile::isDirectory(const std::string& path) {
+#ifdef _WIN32
+    const auto attributes = GetFileAttributesA(path.c_str());
+    return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+#else
+    struct stat status{};
+    return stat(path.c_str(), &status) == 0 && S_ISDIR(status.st_mode);
+#endif
+}
+
+bool HostFile::makeDirectory(const std::string& path) {
+    createParentFolders(path + "/");
+    return isDirectory(path);
+}
+
+bool HostFile::removeDirectory(const std::string& path) {
+#ifdef _WIN32
+    return _rmdir(path.c_str()) == 0;
+#else
+    return rmdir(path.c_str()) == 0;
+#endif
+}
+
+std::map<std::string, size_t> HostFile::listFiles(const std::string& root, const char* folder) {
+    std::map<std::string, size_t> result;
+    addFiles(root, "", folder, result);
+    return result;
+}
+
+HostFile::~HostFile() {
+    flush();
+    unmap();
+#ifdef _WIN32
+    if (_stream != nullptr) {
+        std::fclose(_stream);
+    }
+#else
+    if (_descriptor >= 0) {
+        close(_descriptor);
+    }
+#endif
+}
+
+// tell the other handles on the path that the file changed
+void HostFile::changed() {
+    _seenVersion = ++*_version;
+}
+
+const uint8_t* HostFile::data() {
+    flush();
+    refresh();
+    if (_fileSize == 0) return nullptr;
+#ifdef _WIN32
+    if (!_cacheValid) {
+        _cache.resize(_fileSize);
+        _fseeki64(_stream, 0, SEEK_SET);
+        _cache.resize(std::fread(_cache.data(), 1, _fileSize, _stream));
+        _cacheValid = true;
+    }
+    return _cache.empty() ? nullptr : _cache.data();
+#else
+    // the map is shared with the page cache, so it only needs renewing when the size changed
+    if (_mapSize != _fileSize) {
+        unmap();
+        void* map = mmap(nullptr, _fileSize, PROT_READ, MAP_SHARED, _descriptor, 0);
+        if (map == MAP_FAILED) return nullptr;
+        _map = static_cast<uint8_t*>(map);
+        _mapSize = _fileSize;
+    }
+    return _map;
+#endif
+}
+
+void HostFile::flush() {
+    if (_pending.empty()) return;
+    writeThrough(_pendingOffset, _pending.data(), _pending.size());
+    _pending.clear();
+}
+
+// Another handle changed the file, so read its size again. The map gets renewed on the next access.
+// Pending writes extend the size anyway.
+void HostFile::refresh() const {
+    const auto version = _version->load();
+    if (version == _seenVersion) return;
+    _seenVersion = version;
+#ifdef _WIN32
+    _fseeki64(_stream, 0, SEEK_END);
+    _fileSize = static_cast<size_t>(_ftelli64(_stream));
+    _cacheValid = false;
+#else
+    struct stat status{};
+    if (fstat(_descriptor, &status) == 0) {
+        _fileSize = static_cast<size_t>(status.st_size);
+    }
+#endif
+}
+
+size_t HostFile::size() const {
+    refresh();
+    return _pending.empty() ? _fileSize : std::max(_fileSize, _pendingOffset + _pending.size());
+}
+
+void HostFile::unmap() {
+#ifndef _WIN32
+    if (_map != nullptr) {
+        munmap(_map, _mapSize);
+        _map = nullptr;
+        _mapSize = 0;
+    }
+#endif
+}
+
+size_t HostFile::write(const size_t offset, const uint8_t* buffer, const size_t length) {
+    if (length == 0) return 0;
+    // the buffer only holds one contiguous range
+    if (!_pending.empty() && (offset != _pendingOffset + _pending.size() || _pending.size() + length > kWriteBufferSize)) {
+        flush();
+    }
+    if (length >= kWriteBufferSize) {
+        return writeThrough(offset, buffer, length);
+    }
+    if (_pending.empty()) {
+        _pendingOffset = offset;
+    }
+    _pending.insert(_pending.end(), buffer, buffer + length);
+    return length;
+}
+
+size_t HostFile::writeThrough(const size_t offset, const uint8_t* buffer, const size_t length) {
+    size_t written = 0;
+#ifdef _WIN32
+    _fseeki64(_stream, static_cast<long long>(offset), SEEK_SET);
+    written = std::fwrite(buffer, 1, length, _stream);
+    std::fflush(_stream);
+    _cacheValid = false;
+#else
+    while (written < length) {
+        const auto result = pwrite(_descriptor, buffer + written, length - written, static_cast<off_t>(offset + written));
+        if (result < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        written += static_cast<size_t>(result);
+    }
+#endif
+    _fileSize = std::max(_fileSize, offset + written);
+    changed();
+    return written;
+}
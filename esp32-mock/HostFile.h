@@ -0,0 +1,134 @@
+// Copyright 2026 Rik Essenius
+// 
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file
+// except in compliance with the License. You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+// Host file backing for the FS mock, so fixtures can be used in place (not targeting the ESP32)
+
+#ifndef HEADER_HOST_FILE
+#define HEADER_HOST_FILE
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * \brief Testing: a file in a host directory. Reads are served from a memory map (on Windows from a copy loaded
+ * on first access), writes are collected in a buffer and written with pwrite when they stop being contiguous.
+ * Handles on the same path in this process see each other's changes (including truncating and growing) once they are flushed,
+ * so a stale handle reads less rather than faulting. Changes by other processes aren't noticed while a handle is open,
+ * and handles aren't meant to be used from several threads
+ */
+class HostFile {
+public:
+    /**
+     * \brief Open a host file
+     * \param path the host path of the file
+     * \param write whether the file is opened for writing. If so, it (and its parent folders) are created if needed
+     * \param truncate whether to clear the file
+     * \return the open file, or nullptr if it can't be opened
+     */
+    static std::shared_ptr<HostFile> open(const std::string& path, bool write, bool truncate);
+
+    /**
+     * \param path the host path
+     * \return whether path is an existing file or folder
+     */
+    static bool exists(const std::string& path);
+
+    /**
+     * \param path the host path
+     * \return whether path is an existing folder
+     */
+    static bool isDirectory(const std::string& path);
+
+    /**
+     * \brief Create a folder, and its parents if needed
+     * \param path the host path
+     * \return whether the folder exists now
+     */
+    static bool makeDirectory(const std::string& path);
+
+    /**
+     * \param path the host path
+     * \return whether the folder existed and was empty
+     */
+    static bool removeDirectory(const std::string& path);
+
+    /**
+     * \brief List the files under a host directory
+     * \param root the host directory
+     * \param folder only include files whose (mock) path starts with this
+     * \return the mock paths (starting with '/') and sizes of the files
+     */
+    static std::map<std::string, size_t> listFiles(const std::string& root, const char* folder);
+
+    HostFile(const HostFile&) = delete;
+    HostFile(HostFile&&) = delete;
+    HostFile& operator=(const HostFile&) = delete;
+    HostFile& operator=(HostFile&&) = delete;
+    ~HostFile();
+
+    /**
+     * \brief Get the content. Pending writes are flushed first
+     * \return a pointer to the content (valid until the next write), nullptr if the file is empty
+     */
+    const uint8_t* data();
+
+    /**
+     * \brief Write pending changes to the host file
+     */
+    void flush();
+
+    /**
+     * \return the size of the file, including pending writes
+     */
+    size_t size() const;
+
+    /**
+     * \brief Write to the file
+     * \param offset the position to write at
+     * \param buffer the data to write
+     * \param length the number of bytes to write
+     * \return the number of bytes written
+     */
+    size_t write(size_t offset, const uint8_t* buffer, size_t length);
+
+private:
+    HostFile() = default;
+    void changed();
+    void refresh() const;
+    void unmap();
+    size_t writeThrough(size_t offset, const uint8_t* buffer, size_t length);
+
+    // writes that are at least this big go straight to the file
+    static constexpr size_t kWriteBufferSize = 64 * 1024;
+    mutable size_t _fileSize = 0;
+
+    // counts the flushes and truncations by all handles on the path, so the others know to check the size again
+    std::shared_ptr<std::atomic<unsigned long>> _version;
+    mutable unsigned long _seenVersion = 0;
+    std::vector<uint8_t> _pending;
+    size_t _pendingOffset = 0;
+#ifdef _WIN32
+    FILE* _stream = nullptr;
+    std::vector<uint8_t> _cache;
+    mutable bool _cacheValid = false;
+#else
+    int _descriptor = -1;
+    uint8_t* _map = nullptr;
+    size_t _mapSize = 0;
+#endif
+};
+
+#endif
@@ -0,0 +1,560 @@
+// Copyright 2026 Rik Essenius
+// 
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file
+// except in compliance with the License. You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+// LittleFS image reader and writer for the FS mock (not part of the ESP32 API)
+
+// The layout follows the LittleFS specification (SPEC.md in the littlefs repository):
+// - the image is a sequence of blocks. Metadata lives in pairs of blocks; the root pair is blocks 0 and 1.
+// - a metadata block is a revision count followed by commits. A commit is a list of tags (with data), closed by a CRC tag.
+// - tags are big endian, and stored xor-ed with the previous tag. Data is little endian.
+// - a file is either inline (in its struct tag) or a reverse skip list of blocks ("CTZ" list).
+
+#include "LittleFSImage.h"
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <string>
+
+constexpr size_t LittleFSImage::kDefaultBlockSize;
+
+namespace {
+    constexpr uint32_t kVersion = 0x00020000;
+    constexpr uint32_t kNoTag = 0xffffffff;
+    constexpr uint32_t kInvalidBit = 0x80000000;
+    constexpr uint32_t kDeletedSize = 0x3ff;
+    constexpr size_t kMaxDepth = 128;
+
+    constexpr uint16_t kTypeFile = 0x001;
+    constexpr uint16_t kTypeFolder = 0x002;
+    constexpr uint16_t kTypeSuperblock = 0x0ff;
+    constexpr uint16_t kTypeCreate = 0x401;
+    constexpr uint16_t kTypeDelete = 0x4ff;
+    constexpr uint16_t kTypeFolderStruct = 0x200;
+    constexpr uint16_t kTypeInlineStruct = 0x201;
+    constexpr uint16_t kTypeCtzStruct = 0x202;
+    constexpr uint16_t kTypeSoftTail = 0x600;
+    constexpr uint16_t kTypeHardTail = 0x601;
+    constexpr uint16_t kTypeCommitCrc = 0x500;
+
+    // the abstract types, i.e. the top 3 bits of the type
+    constexpr uint16_t kGroupMask = 0x700;
+    constexpr uint16_t kGroupName = 0x000;
+    constexpr uint16_t kGroupStruct = 0x200;
+    constexpr uint16_t kGroupSplice = 0x400;
+    constexpr uint16_t kGroupTail = 0x600;
+
+    // CRC-32 without the final inversion, as LittleFS uses it
+    uint32_t crc32(uint32_t crc, const uint8_t* data, const size_t size) {
+        for (size_t i = 0; i < size; i++) {
+            crc ^= data[i];
+            for (int bit = 0; bit < 8; bit++) {
+                crc = (crc >> 1) ^ (0xedb88320 & (0 - (crc & 1)));
+            }
+        }
+        return crc;
+    }
+
+    uint32_t readLe32(const uint8_t* data) {
+        return data[0] | data[1] << 8 | data[2] << 16 | static_cast<uint32_t>(data[3]) << 24;
+    }
+
+    uint32_t readBe32(const uint8_t* data) {
+        return static_cast<uint32_t>(data[0]) << 24 | data[1] << 16 | data[2] << 8 | data[3];
+    }
+
+    void writeLe32(uint8_t* data, const uint32_t value) {
+        for (int i = 0; i < 4; i++) {
+            data[i] = static_cast<uint8_t>(value >> (8 * i));
+        }
+    }
+
+    void writeBe32(uint8_t* data, const uint32_t value) {
+        for (int i = 0; i < 4; i++) {
+            data[i] = static_cast<uint8_t>(value >> (24 - 8 * i));
+        }
+    }
+
+    uint16_t tagType(const uint32_t tag) { return static_cast<uint16_t>(tag >> 20 & 0x7ff); }
+    uint16_t tagId(const uint32_t tag) { return static_cast<uint16_t>(tag >> 10 & 0x3ff); }
+    uint32_t tagSize(const uint32_t tag) { return (tag & 0x3ff) == kDeletedSize ? 0 : tag & 0x3ff; }
+
+    uint32_t makeTag(const uint16_t type, const uint16_t id, const size_t size) {
+        return static_cast<uint32_t>(type) << 20 | static_cast<uint32_t>(id) << 10 | static_cast<uint32_t>(size);
+    }
+
+    unsigned trailingZeros(size_t value) {
+        unsigned count = 0;
+        for (; (value & 1) == 0; value >>= 1) count++;
+        return count;
+    }
+
+    unsigned bitCount(size_t value) {
+        unsigned count = 0;
+        for (; value != 0; value &= value - 1) count++;
+        return count;
+    }
+
+    // Block n of a CTZ list starts with pointers to blocks n - 2^i, for i from 0 to the number of trailing zeros in n.
+    // Returns the index of the block that holds offset, and makes offset relative to that block (lfs_ctz_index).
+    size_t ctzIndex(const size_t blockSize, size_t& offset) {
+        const auto usable = blockSize - 2 * 4;
+        auto index = offset / usable;
+        if (index == 0) return 0;
+        index = (offset - 4 * (bitCount(index - 1) + 2)) / usable;
+        offset = offset - usable * index - 4 * bitCount(index);
+        return index;
+    }
+
+    size_t ctzHeaderSize(const size_t index) {
+        return index == 0 ? 0 : 4 * (trailingZeros(index) + 1);
+    }
+
+    struct Entry {
+        uint16_t type = 0;
+        std::string name;
+        uint16_t structType = 0;
+        const uint8_t* structData = nullptr;
+        size_t structSize = 0;
+    };
+
+    struct MetadataState {
+        std::vector<Entry> entries;
+        bool hasTail = false;
+        bool tailIsSplit = false;
+        uint32_t tail[2] = {0, 0};
+    };
+
+    class Reader {
+    public:
+        Reader(const uint8_t* image, const size_t blockSize, const size_t blockCount) :
+            _image(image), _blockSize(blockSize), _blockCount(blockCount) {}
+
+        bool readFolder(const uint32_t* pair, const std::string& path, FileStore& store, const size_t depth) {
+            if (depth > kMaxDepth) return false;
+            uint32_t current[2] = {pair[0], pair[1]};
+
+            // a folder with more entries than fit in one pair continues in the pair its hard tail points to
+            for (size_t pairCount = 0; pairCount < _blockCount; pairCount++) {
+                MetadataState state;
+                if (!fetchPair(current, state)) return false;
+                for (const auto& entry : state.entries) {
+                    if (!readEntry(entry, path, store, depth)) return false;
+                }
+                if (!state.hasTail || !state.tailIsSplit) return true;
+                current[0] = state.tail[0];
+                current[1] = state.tail[1];
+            }
+            return false;
+        }
+
+        bool fetchPair(const uint32_t* pair, MetadataState& state) const {
+            if (pair[0] >= _blockCount || pair[1] >= _blockCount) return false;
+            const auto revision0 = readLe32(block(pair[0]));
+            const auto revision1 = readLe32(block(pair[1]));
+
+            // try the most recent block first: revisions are compared as sequence numbers, so they can wrap
+            const auto first = static_cast<int32_t>(revision1 - revision0) > 0 ? 1 : 0;
+            return fetchBlock(pair[first], state) || fetchBlock(pair[1 - first], state);
+        }
+
+    private:
+        const uint8_t* block(const uint32_t number) const { return _image + static_cast<size_t>(number) * _blockSize; }
+
+        static void apply(MetadataState& state, const uint32_t tag, const uint8_t* data, const uint32_t size) {
+            const auto type = tagType(tag);
+            const auto id = tagId(tag);
+            auto& entries = state.entries;
+            switch (type & kGroupMask) {
+            case kGroupSplice:
+                if (type == kTypeCreate && id <= entries.size()) {
+                    entries.insert(entries.begin() + id, Entry());
+                }
+                else if (type == kTypeDelete && id < entries.size()) {
+                    entries.erase(entries.begin() + id);
+                }
+                break;
+            case kGroupName:
+                if ((tag & 0x3ff) == kDeletedSize) break;
+                if (id >= entries.size()) entries.resize(id + 1);
+                entries[id].type = type;
+                entries[id].name.assign(reinterpret_cast<const char*>(data), size);
+                break;
+            case kGroupStruct:
+                if ((tag & 0x3ff) == kDeletedSize) break;
+                if (id >= entries.size()) entries.resize(id + 1);
+                entries[id].structType = type;
+                entries[id].structData = data;
+                entries[id].structSize = size;
+                break;
+            case kGroupTail:
+                if (size < 8) break;
+                state.hasTail = true;
+                state.tailIsSplit = (type & 1) != 0;
+                state.tail[0] = readLe32(data);
+                state.tail[1] = readLe32(data + 4);
+                break;
+            default:
+                // user attributes, global state and erase CRCs don't matter here
+                break;
+            }
+        }
+
+        // Replays the commits of a block; only commits with a valid CRC count
+        bool fetchBlock(const uint32_t number, MetadataState& state) const {
+            const auto* data = block(number);
+            auto crc = crc32(0xffffffff, data, 4);
+            uint32_t previousTag = kNoTag;
+            MetadataState working;
+            bool valid = false;
+            size_t offset = 4;
+            while (offset + 4 <= _blockSize) {
+                const auto tag = readBe32(data + offset) ^ previousTag;
+                if ((tag & kInvalidBit) != 0) break;
+                const auto size = tagSize(tag);
+                if (offset + 4 + size > _blockSize) break;
+                crc = crc32(crc, data + offset, 4);
+                previousTag = tag;
+                const auto* tagData = data + offset + 4;
+                if ((tagType(tag) & 0x780) == kTypeCommitCrc) {
+                    if (size < 4 || readLe32(tagData) != crc) break;
+                    // the lowest type bit tells whether the valid bit of the next commit is inverted
+                    previousTag ^= static_cast<uint32_t>(tagType(tag) & 1) << 31;
+                    state = working;
+                    valid = true;
+                    crc = 0xffffffff;
+                }
+                else {
+                    crc = crc32(crc, tagData, size);
+                    apply(working, tag, tagData, size);
+                }
+                offset += 4 + size;
+            }
+            return valid;
+        }
+
+        bool readCtz(const uint32_t head, const size_t size, FileData& content) const {
+            content.clear();
+            if (size == 0) return true;
+
+            // the size comes from the image, so check it fits before allocating for it
+            if (size > _blockCount * _blockSize) return false;
+            size_t lastOffset = size - 1;
+            const auto lastIndex = ctzIndex(_blockSize, lastOffset);
+            if (lastIndex >= _blockCount) return false;
+            content.resize(size);
+
+            // walk back from the head to find all blocks; the first pointer in a block goes to the one before it
+            std::vector<uint32_t> blocks(lastIndex + 1);
+            blocks[lastIndex] = head;
+            for (auto index = lastIndex; index > 0; index--) {
+                if (blocks[index] >= _blockCount) return false;
+                blocks[index - 1] = readLe32(block(blocks[index]));
+            }
+            if (blocks[0] >= _blockCount) return false;
+            size_t position = 0;
+            for (size_t index = 0; index <= lastIndex && position < size; index++) {
+                const auto header = ctzHeaderSize(index);
+                const auto length = std::min(_blockSize - header, size - position);
+                memcpy(content.data() + position, block(blocks[index]) + header, length);
+                position += length;
+            }
+            return position == size;
+        }
+
+        bool readEntry(const Entry& entry, const std::string& folder, FileStore& store, const size_t depth) {
+            if (entry.type != kTypeFile && entry.type != kTypeFolder) return true;
+            const auto path = folder + "/" + entry.name;
+            if (entry.type == kTypeFolder) {
+                if (entry.structType != kTypeFolderStruct || entry.structSize < 8) return false;
+                const uint32_t pair[2] = {readLe32(entry.structData), readLe32(entry.structData + 4)};
+                store.makeFolder(path);
+                return readFolder(pair, path, store, depth + 1);
+            }
+            const auto content = std::make_shared<FileData>();
+            if (entry.structType == kTypeInlineStruct) {
+                content->assign(entry.structData, entry.structData + entry.structSize);
+            }
+            else if (entry.structType != kTypeCtzStruct || entry.structSize < 8 ||
+                     !readCtz(readLe32(entry.structData), readLe32(entry.structData + 4), *content)) {
+                return false;
+            }
+            store.store(path, content);
+            return true;
+        }
+
+        const uint8_t* _image;
+        size_t _blockSize;
+        size_t _blockCount;
+    };
+
+    struct Folder {
+        std::map<std::string, Folder> folders;
+        std::map<std::string, std::shared_ptr<FileData>> files;
+    };
+
+    struct Item {
+        std::string name;
+        bool isFolder;
+        size_t layout;
+        std::shared_ptr<FileData> content;
+        uint32_t head;
+    };
+
+    // a folder as it is written: its entries, split over as many metadata pairs as needed
+    struct Layout {
+        std::vector<Item> items;
+        std::vector<size_t> chunkStarts;
+        std::vector<uint32_t> pairs;
+    };
+
+    class Writer {
+    public:
+        Writer(const size_t blockSize, const size_t blockCount, std::vector<uint8_t>& image) :
+            _blockSize(blockSize), _blockCount(blockCount), _image(image) {}
+
+        bool write(const FileStore& store) {
+            Folder root;
+            if (!buildTree(store, root)) return false;
+            addLayout(root);
+            for (size_t i = 0; i < _layouts.size(); i++) {
+                splitIntoPairs(_layouts[i], i == 0);
+            }
+            _image.assign(_blockSize * _blockCount, 0xff);
+            // a pair is two consecutive blocks, so it is known by its first one
+            for (auto& layout : _layouts) {
+                for (auto& pair : layout.pairs) {
+                    uint32_t second;
+                    if (!allocate(pair) || !allocate(second)) return false;
+                }
+            }
+            for (auto& layout : _layouts) {
+                for (auto& item : layout.items) {
+                    if (!item.isFolder && !isInline(item) && !writeCtz(*item.content, item.head)) return false;
+                }
+            }
+            for (size_t i = 0; i < _layouts.size(); i++) {
+                for (size_t chunk = 0; chunk < _layouts[i].pairs.size(); chunk++) {
+                    writeMetadata(i, chunk);
+                }
+            }
+            return true;
+        }
+
+    private:
+        size_t addLayout(const Folder& folder) {
+            const auto index = _layouts.size();
+            _layouts.emplace_back();
+            std::vector<Item> items;
+            for (const auto& child : folder.folders) {
+                // sub folders come right after their parent, which is the order the metadata pairs get linked in
+                items.push_back(Item{child.first, true, addLayout(child.second), nullptr, 0});
+            }
+            for (const auto& file : folder.files) {
+                items.push_back(Item{file.first, false, 0, file.second, 0});
+            }
+            std::sort(items.begin(), items.end(), [](const Item& a, const Item& b) { return a.name < b.name; });
+            _layouts[index].items = std::move(items);
+            return index;
+        }
+
+        bool allocate(uint32_t& block) {
+            if (_nextBlock >= _blockCount) return false;
+            block = _nextBlock++;
+            return true;
+        }
+
+        bool buildTree(const FileStore& store, Folder& root) const {
+            const auto snapshot = store.snapshot();
+            for (const auto& entry : snapshot.files()) {
+                const auto& path = entry.first;
+                auto* folder = &root;
+                size_t start = 1;
+                for (auto slash = path.find('/', start); slash != std::string::npos; slash = path.find('/', start)) {
+                    if (slash > start) {
+                        const auto name = path.substr(start, slash - start);
+                        if (folder->files.count(name) != 0 || name.size() > _nameMax) return false;
+                        folder = &folder->folders[name];
+                    }
+                    start = slash + 1;
+                }
+                if (start < path.size() && entry.second != nullptr) {
+                    const auto name = path.substr(start);
+                    if (folder->folders.count(name) != 0 || name.size() > _nameMax) return false;
+                    folder->files[name] = entry.second;
+                }
+            }
+            return true;
+        }
+
+        size_t entrySize(const Item& item) const {
+            const size_t structSize = item.isFolder || !isInline(item) ? 8 : item.content->size();
+            return 4 + item.name.size() + 4 + structSize;
+        }
+
+        // Small files go into the metadata, like LittleFS does with its default inline limit
+        bool isInline(const Item& item) const {
+            return item.content->size() <= std::min<size_t>(kDeletedSize - 1, _blockSize / 8);
+        }
+
+        // Keeps each pair at most half full, like LittleFS does when it compacts, so appends fit after mounting
+        void splitIntoPairs(Layout& layout, const bool isRoot) const {
+            constexpr size_t kOverhead = 4 + 12 + 8;
+            constexpr size_t kSuperblockSize = 4 + 8 + 4 + 24;
+            size_t used = kOverhead + (isRoot ? kSuperblockSize : 0);
+            layout.chunkStarts.push_back(0);
+            for (size_t i = 0; i < layout.items.size(); i++) {
+                const auto size = entrySize(layout.items[i]);
+                if (used + size > _blockSize / 2 && i > layout.chunkStarts.back()) {
+                    layout.chunkStarts.push_back(i);
+                    used = kOverhead;
+                }
+                used += size;
+            }
+            layout.pairs.resize(layout.chunkStarts.size());
+        }
+
+        bool writeCtz(const FileData& content, uint32_t& head) {
+            std::vector<uint32_t> blocks;
+            size_t position = 0;
+            for (size_t index = 0; position < content.size(); index++) {
+                uint32_t number;
+                if (!allocate(number)) return false;
+                auto* data = &_image[static_cast<size_t>(number) * _blockSize];
+                const auto header = ctzHeaderSize(index);
+                for (size_t pointer = 0; pointer * 4 < header; pointer++) {
+                    writeLe32(data + pointer * 4, blocks[index - (static_cast<size_t>(1) << pointer)]);
+                }
+                const auto length = std::min(_blockSize - header, content.size() - position);
+                memcpy(data + header, content.data() + position, length);
+                position += length;
+                blocks.push_back(number);
+            }
+            head = blocks.back();
+            return true;
+        }
+
+        void writeMetadata(const size_t layoutIndex, const size_t chunk) {
+            const auto& layout = _layouts[layoutIndex];
+            auto* data = &_image[static_cast<size_t>(layout.pairs[chunk]) * _blockSize];
+            writeLe32(data, 1);
+            _crc = crc32(0xffffffff, data, 4);
+            _previousTag = kNoTag;
+            _offset = 4;
+            uint16_t id = 0;
+            uint8_t buffer[24];
+            if (layoutIndex == 0 && chunk == 0) {
+                appendTag(data, makeTag(kTypeSuperblock, id, 8), reinterpret_cast<const uint8_t*>("littlefs"));
+                const uint32_t superblock[] = {
+                    kVersion, static_cast<uint32_t>(_blockSize), static_cast<uint32_t>(_blockCount), _nameMax, 0x7fffffff, 1022
+                };
+                for (size_t i = 0; i < 6; i++) {
+                    writeLe32(buffer + 4 * i, superblock[i]);
+                }
+                appendTag(data, makeTag(kTypeInlineStruct, id, 24), buffer);
+                id++;
+            }
+            const auto end = chunk + 1 < layout.chunkStarts.size() ? layout.chunkStarts[chunk + 1] : layout.items.size();
+            for (auto i = layout.chunkStarts[chunk]; i < end; i++, id++) {
+                const auto& item = layout.items[i];
+                const auto* name = reinterpret_cast<const uint8_t*>(item.name.data());
+                appendTag(data, makeTag(item.isFolder ? kTypeFolder : kTypeFile, id, item.name.size()), name);
+                if (item.isFolder) {
+                    const auto pair = _layouts[item.layout].pairs[0];
+                    writeLe32(buffer, pair);
+                    writeLe32(buffer + 4, pair + 1);
+                    appendTag(data, makeTag(kTypeFolderStruct, id, 8), buffer);
+                }
+                else if (isInline(item)) {
+                    appendTag(data, makeTag(kTypeInlineStruct, id, item.content->size()), item.content->data());
+                }
+                else {
+                    writeLe32(buffer, item.head);
+                    writeLe32(buffer + 4, static_cast<uint32_t>(item.content->size()));
+                    appendTag(data, makeTag(kTypeCtzStruct, id, 8), buffer);
+                }
+            }
+
+            // the pairs of one folder are linked with hard tails, and all folders are linked with soft tails
+            uint32_t tail = kNoTag;
+            uint16_t tailType = kTypeHardTail;
+            if (chunk + 1 < layout.pairs.size()) {
+                tail = layout.pairs[chunk + 1];
+            }
+            else if (layoutIndex + 1 < _layouts.size()) {
+                tail = _layouts[layoutIndex + 1].pairs[0];
+                tailType = kTypeSoftTail;
+            }
+            if (tail != kNoTag) {
+                writeLe32(buffer, tail);
+                writeLe32(buffer + 4, tail + 1);
+                appendTag(data, makeTag(tailType, 0x3ff, 8), buffer);
+            }
+
+            // close the commit. The byte after it is erased, so the valid bit of the next commit isn't inverted
+            const auto crcTag = makeTag(kTypeCommitCrc, 0x3ff, 4);
+            writeBe32(data + _offset, crcTag ^ _previousTag);
+            _crc = crc32(_crc, data + _offset, 4);
+            writeLe32(data + _offset + 4, _crc);
+        }
+
+        void appendTag(uint8_t* data, const uint32_t tag, const uint8_t* tagData) {
+            const auto size = tagSize(tag);
+            writeBe32(data + _offset, tag ^ _previousTag);
+            // empty files have no data, and passing their null pointer to memcpy is undefined even for size 0
+            if (size > 0) {
+                memcpy(data + _offset + 4, tagData, size);
+            }
+            _crc = crc32(_crc, data + _offset, 4 + size);
+            _previousTag = tag;
+            _offset += 4 + size;
+        }
+
+        // names up to this size can be read by any LittleFS build
+        static constexpr uint32_t _nameMax = 32;
+        size_t _blockSize;
+        size_t _blockCount;
+        std::vector<uint8_t>& _image;
+        std::vector<Layout> _layouts;
+        uint32_t _nextBlock = 0;
+        uint32_t _crc = 0;
+        uint32_t _previousTag = kNoTag;
+        size_t _offset = 0;
+    };
+}
+
+bool LittleFSImage::read(const uint8_t* image, const size_t size, const size_t blockSize, FileStore& store) {
+    if (image == nullptr || blockSize < 128 || size < 2 * blockSize) return false;
+    Reader reader(image, blockSize, size / blockSize);
+    const uint32_t root[2] = {0, 1};
+    MetadataState state;
+    if (!reader.fetchPair(root, state) || state.entries.empty()) return false;
+    const auto& superblock = state.entries[0];
+    if (superblock.type != kTypeSuperblock || superblock.name != "littlefs" ||
+        superblock.structType != kTypeInlineStruct || superblock.structSize < 12) return false;
+    const auto version = readLe32(superblock.structData);
+    const auto imageBlockSize = readLe32(superblock.structData + 4);
+    const auto blockCount = readLe32(superblock.structData + 8);
+    if (version >> 16 != kVersion >> 16 || imageBlockSize != blockSize || blockCount > size / blockSize) return false;
+
+    FileStore result(static_cast<size_t>(blockCount) * blockSize);
+    reader = Reader(image, blockSize, blockCount);
+    if (!reader.readFolder(root, "", result, 0)) return false;
+    store.restore(result.snapshot());
+    store.setCapacity(result.capacity());
+    return true;
+}
+
+bool LittleFSImage::write(const FileStore& store, const size_t blockSize, const size_t blockCount, std::vector<uint8_t>& image) {
+    if (blockSize < 128 || blockCount < 2) return false;
+    Writer writer(blockSize, blockCount, image);
+    return writer.write(store);
+}
@@ -0,0 +1,51 @@
+// Copyright 2026 Rik Essenius
+// 
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file
+// except in compliance with the License. You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+// LittleFS image reader and writer for the FS mock (not part of the ESP32 API)
+
+#ifndef HEADER_LITTLE_FS_IMAGE
+#define HEADER_LITTLE_FS_IMAGE
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "FileStore.h"
+
+/**
+ * \brief Testing: convert between a file store and a LittleFS (on-disk version 2) image, as made by mklittlefs.
+ * Moves that were interrupted by a power loss are not repaired, and user attributes are ignored.
+ */
+class LittleFSImage {
+public:
+    static constexpr size_t kDefaultBlockSize = 4096;
+
+    /**
+     * \brief Read the files and folders of an image
+     * \param image the image content
+     * \param size the size of the image
+     * \param blockSize the block size the image was made with
+     * \param store the store to fill. Its capacity becomes the size of the file system in the image
+     * \return whether the image could be read. If not, the store is unchanged
+     */
+    static bool read(const uint8_t* image, size_t size, size_t blockSize, FileStore& store);
+
+    /**
+     * \brief Make an image with the files and folders of a store
+     * \param store the store to write
+     * \param blockSize the block size of the image
+     * \param blockCount the number of blocks in the image
+     * \param image receives the image, blockSize * blockCount bytes
+     * \return whether the content fit into the image
+     */
+    static bool write(const FileStore& store, size_t blockSize, size_t blockCount, std::vector<uint8_t>& image);
+};
+
+#endif
@@ -0,0 +1,85 @@
+// Copyright 2026 Rik Essenius
+// 
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file
+// except in compliance with the License. You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+// Structured capture of log messages, to assert on logging in tests (not part of the ESP32 API)
+
+#include "LogCapture.h"
+#include <algorithm>
+#include <cstring>
+
+constexpr size_t LogCapture::npos;
+constexpr uint8_t LogCapture::kLevelCount;
+
+namespace {
+    size_t levelIndex(const LogLevel level) {
+        return std::min<size_t>(static_cast<size_t>(level), LogCapture::kLevelCount - 1);
+    }
+}
+
+void LogCapture::add(const LogRecord& record) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _entries.push_back({
+        record.level, record.tag != nullptr ? record.tag : "", std::string(record.message, record.length),
+        record.timestamp, record.task
+    });
+    _levelIndex[levelIndex(record.level)].push_back(_nextSequence);
+    _nextSequence++;
+}
+
+void LogCapture::clear(const size_t upTo) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    const size_t end = std::min(upTo, _nextSequence);
+    if (end <= firstSequence()) return;
+    _entries.erase(_entries.begin(), _entries.begin() + static_cast<std::ptrdiff_t>(end - firstSequence()));
+    for (auto& index : _levelIndex) {
+        index.erase(index.begin(), std::lower_bound(index.begin(), index.end(), end));
+    }
+}
+
+size_t LogCapture::count(const LogLevel level, const size_t since) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    const auto& index = _levelIndex[levelIndex(level)];
+    return static_cast<size_t>(index.end() - std::lower_bound(index.begin(), index.end(), since));
+}
+
+const LogEntry* LogCapture::find(const char* pattern, const size_t since, const char* tag) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    const size_t start = std::max(since, firstSequence()) - firstSequence();
+    for (size_t i = start; i < _entries.size(); i++) {
+        if (matches(_entries[i], pattern, tag)) return &_entries[i];
+    }
+    return nullptr;
+}
+
+const LogEntry* LogCapture::find(const LogLevel level, const char* pattern, const size_t since, const char* tag) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    const auto& index = _levelIndex[levelIndex(level)];
+    for (auto sequence = std::lower_bound(index.begin(), index.end(), since); sequence != index.end(); ++sequence) {
+        const LogEntry& entry = _entries[*sequence - firstSequence()];
+        if (matches(entry, pattern, tag)) return &entry;
+    }
+    return nullptr;
+}
+
+size_t LogCapture::mark() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _nextSequence;
+}
+
+size_t LogCapture::size() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _entries.size();
+}
+
+bool LogCapture::matches(const LogEntry& entry, const char* pattern, const char* tag) const {
+    if (tag != nullptr && entry.tag != tag) return false;
+    return strstr(entry.message.c_str(), pattern) != nullptr;
+}
@@ -0,0 +1,91 @@
+// Copyright 2026 Rik Essenius
+// 
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file
+// except in compliance with the License. You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+// Structured capture of log messages, to assert on logging in tests (not part of the ESP32 API)
+
+#ifndef HEADER_LOG_CAPTURE
+#define HEADER_LOG_CAPTURE
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include "LogRing.h"
+
+/**
+ * \brief Testing: a captured log message
+ */
+struct LogEntry {
+    LogLevel level;
+    std::string tag;
+    std::string message;
+    int64_t timestamp;
+    TaskHandle_t task;
+};
+
+/**
+ * \brief Testing: keeps log messages as entries, indexed by level. Marks are sequence numbers: mark() returns the
+ * sequence number the next entry gets, so queries since a mark only look at what was logged after it.
+ * Entries stay valid until they get cleared.
+ */
+class LogCapture {
+public:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+    static constexpr uint8_t kLevelCount = 6;
+
+    void add(const LogRecord& record);
+
+    /**
+     * \brief Remove entries (and their index) logged before a mark, or all entries
+     * \param upTo the mark to clear up to, npos to clear everything
+     */
+    void clear(size_t upTo = npos);
+
+    /**
+     * \brief The number of entries of a level logged since a mark (and not cleared)
+     */
+    size_t count(LogLevel level, size_t since = 0) const;
+
+    /**
+     * \brief Find the first entry since a mark with a message containing a pattern
+     * \param pattern the text to look for
+     * \param since the mark to search from
+     * \param tag only look at entries with this tag, nullptr for all entries
+     * \return the entry, or nullptr if there is none
+     */
+    const LogEntry* find(const char* pattern, size_t since = 0, const char* tag = nullptr) const;
+
+    /**
+     * \brief Like find, but only looking at entries of one level, via the level index
+     */
+    const LogEntry* find(LogLevel level, const char* pattern, size_t since = 0, const char* tag = nullptr) const;
+
+    /**
+     * \return the sequence number the next entry gets
+     */
+    size_t mark() const;
+
+    /**
+     * \brief The number of entries held
+     */
+    size_t size() const;
+
+private:
+    bool matches(const LogEntry& entry, const char* pattern, const char* tag) const;
+    size_t firstSequence() const { return _nextSequence - _entries.size(); }
+
+    mutable std::mutex _mutex;
+    std::deque<LogEntry> _entries;
+    std::deque<size_t> _levelIndex[kLevelCount];
+    size_t _nextSequence = 0;
+};
+
+#endif
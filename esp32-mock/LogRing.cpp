@@ -0,0 +1,112 @@
+// Copyright 2026 Rik Essenius
+// 
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file
+// except in compliance with the License. You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+// Queue that lets concurrent tasks log without interleaving (not part of the ESP32 API)
+
+// The slot sequence numbers follow Dmitry Vyukov's bounded queue: a slot is free for the producer claiming
+// position p when its sequence is p, and holds a published record for the consumer at position p when it is p + 1.
+
+#include "LogRing.h"
+#include <cstring>
+
+constexpr size_t LogRing::kDefaultSlotCount;
+constexpr size_t LogRing::kMessageSize;
+
+LogRing::LogRing(const Handler handler, const size_t slotCount) : _handler(handler) {
+    size_t count = 1;
+    while (count < slotCount) {
+        count *= 2;
+    }
+    _slots.reset(new Slot[count]);
+    _mask = count - 1;
+    for (size_t i = 0; i < count; i++) {
+        _slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+LogRing::~LogRing() {
+    drain();
+}
+
+LogRing::Slot& LogRing::claim(size_t& position) {
+    position = _enqueuePosition.load(std::memory_order_relaxed);
+    for (;;) {
+        Slot& slot = _slots[position & _mask];
+        const size_t sequence = slot.sequence.load(std::memory_order_acquire);
+        const auto difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+        if (difference == 0) {
+            if (_enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                return slot;
+            }
+        }
+        else if (difference < 0) {
+            // full: help empty the queue, or give the thread that is doing that a chance.
+            // If that is this thread (logging from the handler), nobody else can, so handle the queued records here
+            if (isDraining()) {
+                drainQueued();
+            }
+            else {
+                drain();
+            }
+            std::this_thread::yield();
+            position = _enqueuePosition.load(std::memory_order_relaxed);
+        }
+        else {
+            position = _enqueuePosition.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void LogRing::publish(Slot& slot, const size_t position) {
+    slot.sequence.store(position + 1, std::memory_order_release);
+}
+
+bool LogRing::hasPublished() const {
+    const size_t position = _dequeuePosition.load(std::memory_order_acquire);
+    return _slots[position & _mask].sequence.load(std::memory_order_acquire) == position + 1;
+}
+
+void LogRing::drain() {
+    // the handler logged: the loop in drainQueued handles the new record after the current one returns.
+    // Trying to lock again here would be undefined behavior, since this thread holds the lock already
+    if (isDraining()) return;
+
+    // A producer that publishes while we hold the lock fails to get it, so we check again after unlocking
+    while (_drainMutex.try_lock()) {
+        _drainingThread.store(std::this_thread::get_id(), std::memory_order_relaxed);
+        drainQueued();
+        _drainingThread.store(std::thread::id(), std::memory_order_relaxed);
+        _drainMutex.unlock();
+        if (!hasPublished()) return;
+    }
+}
+
+// Only called by the thread that holds the drain lock. Slots are freed before the handler runs,
+// so a handler that logs always finds room eventually, and the position is read again after it returns.
+void LogRing::drainQueued() {
+    char message[kMessageSize];
+    for (;;) {
+        const size_t position = _dequeuePosition.load(std::memory_order_relaxed);
+        Slot& slot = _slots[position & _mask];
+        if (slot.sequence.load(std::memory_order_acquire) != position + 1) break;
+        const std::unique_ptr<std::string> longMessage(slot.longMessage.release());
+        if (!longMessage) {
+            memcpy(message, slot.message, slot.length + 1);
+        }
+        const LogRecord record{
+            slot.level, slot.task, slot.core, slot.timestamp, slot.tag,
+            longMessage ? longMessage->c_str() : message, slot.length
+        };
+        slot.sequence.store(position + _mask + 1, std::memory_order_release);
+        _dequeuePosition.store(position + 1, std::memory_order_release);
+        _handler(record);
+    }
+}
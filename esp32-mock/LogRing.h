@@ -0,0 +1,133 @@
+// Copyright 2026 Rik Essenius
+// 
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file
+// except in compliance with the License. You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+// Queue that lets concurrent tasks log without interleaving (not part of the ESP32 API)
+
+#ifndef HEADER_LOG_RING
+#define HEADER_LOG_RING
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "freertos/freeRTOS.h"
+
+// defined in ESP.h
+enum class LogLevel : uint8_t;
+
+/**
+ * \brief A formatted log message with where and when it came from
+ */
+struct LogRecord {
+    LogLevel level;
+    TaskHandle_t task;
+    BaseType_t core;
+    int64_t timestamp;
+    const char* tag;
+    const char* message;
+    size_t length;
+};
+
+/**
+ * \brief Bounded lock-free queue of log records for many producers (e.g. threads standing in for tasks).
+ * Producers format into their own slot, so messages never interleave, and only contend on claiming a slot.
+ * After publishing, a producer hands the queued records to the handler unless another producer is already doing that,
+ * so records reach the handler one at a time and in the order their slots were claimed.
+ * The handler may log too: its records get queued and handled after the current one.
+ */
+class LogRing {
+public:
+    using Handler = void (*)(const LogRecord& record);
+    static constexpr size_t kDefaultSlotCount = 256;
+
+    /**
+     * \param handler the function that processes the records
+     * \param slotCount the number of records that can be queued, rounded up to a power of two
+     */
+    explicit LogRing(Handler handler, size_t slotCount = kDefaultSlotCount);
+
+    LogRing(const LogRing&) = delete;
+    LogRing(LogRing&&) = delete;
+    LogRing& operator=(const LogRing&) = delete;
+    LogRing& operator=(LogRing&&) = delete;
+    ~LogRing();
+
+    /**
+     * \brief Format a message, queue it and process the queue
+     * \param tag the component that logs (nullptr if none). Only the pointer gets queued, like ESP-IDF expects
+     * tags to live on (e.g. string literals)
+     */
+    template <typename... Arguments>
+    void log(const LogLevel level, const TaskHandle_t task, const BaseType_t core, const int64_t timestamp,
+             const char* tag, const char* format, Arguments ... arguments) {
+        size_t position;
+        Slot& slot = claim(position);
+        slot.level = level;
+        slot.task = task;
+        slot.core = core;
+        slot.timestamp = timestamp;
+        slot.tag = tag;
+        const int length = std::snprintf(slot.message, sizeof slot.message, format, arguments...);
+        slot.length = length > 0 ? static_cast<size_t>(length) : 0;
+        if (slot.length >= sizeof slot.message) {
+            // rare, so we take the allocation rather than making every slot big
+            slot.longMessage.reset(new std::string(slot.length + 1, '\0'));
+            std::snprintf(&(*slot.longMessage)[0], slot.longMessage->size(), format, arguments...);
+        }
+        publish(slot, position);
+        drain();
+    }
+
+    /**
+     * \brief Hand the queued records to the handler, unless another thread is already doing that.
+     * Called from the handler it does nothing, since the drain that called the handler picks up the new records
+     */
+    void drain();
+
+    size_t slotCount() const { return _mask + 1; }
+
+private:
+    static constexpr size_t kMessageSize = 200;
+
+    struct Slot {
+        std::atomic<size_t> sequence{0};
+        LogLevel level;
+        TaskHandle_t task = nullptr;
+        BaseType_t core = 0;
+        int64_t timestamp = 0;
+        const char* tag = nullptr;
+        size_t length = 0;
+        std::unique_ptr<std::string> longMessage;
+        char message[kMessageSize];
+    };
+
+    Slot& claim(size_t& position);
+    void publish(Slot& slot, size_t position);
+    bool hasPublished() const;
+    void drainQueued();
+    bool isDraining() const { return _drainingThread.load(std::memory_order_relaxed) == std::this_thread::get_id(); }
+
+    static constexpr size_t kCacheLineSize = 64;
+    std::unique_ptr<Slot[]> _slots;
+    size_t _mask;
+    Handler _handler;
+    char _producerPadding[kCacheLineSize] = {};
+    std::atomic<size_t> _enqueuePosition{0};
+    char _consumerPadding[kCacheLineSize - sizeof(std::atomic<size_t>)] = {};
+    std::atomic<size_t> _dequeuePosition{0};
+    std::mutex _drainMutex;
+    std::atomic<std::thread::id> _drainingThread{};
+};
+
+#endif
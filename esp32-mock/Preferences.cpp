@@ -19,129 +19,472 @@
 #include "Preferences.h"
 
 #include <fstream>
-#include <sstream>
+#include <mutex>
 #include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
 
-bool Preferences::begin(const char* name, bool /*readOnly*/) {
-    _started = true;
-    load();
-    _currentPreference = &_preferences[name];
-    return true;
+/**
+ * \brief A typed value. Numbers are kept as their bits (signed ones sign extended), strings and blobs as their bytes
+ */
+struct Preferences::Value {
+    PreferenceType type = PT_INVALID;
+    uint64_t number = 0;
+    std::string bytes;
+
+    // An untagged string from a preferences.txt of an older mock, which stored everything as text. It can be read as a blob,
+    // and if it is a whole number (parsed on load into number), also as a number of a type it fits in.
+    bool legacy = false;
+    bool legacyNumber = false;
+
+    bool operator==(const Value& other) const {
+        return type == other.type && number == other.number && bytes == other.bytes;
+    }
+};
+
+struct Preferences::Namespace {
+    std::map<std::string, Value> entries;
+
+    // the namespace as it appears in preferences.txt, valid if not dirty
+    std::string text;
+    bool dirty = false;
+};
+
+namespace {
+    constexpr auto kPreferencesFile = "preferences.txt";
+
+    // the default NVS partition has 5 pages of 126 entries, and one page is kept free for garbage collection
+    constexpr size_t kEntryCapacity = 4 * 126;
+    constexpr size_t kEntrySize = 32;
+
+    // type tags in preferences.txt, by PreferenceType. Every value gets one, except legacy values read from an untagged line
+    constexpr const char* kTags[] = { "i8", "u8", "i16", "u16", "i32", "u32", "i64", "u64", "str", "blob" };
+
+    /**
+     * \brief The parsed content of preferences.txt, shared by all Preferences instances
+     */
+    struct Cache {
+        std::mutex mutex;
+        bool loaded = false;
+        bool dirty = false;
+        std::map<std::string, Preferences::Namespace> namespaces;
+    };
+
+    Cache& cache() {
+        static Cache instance;
+        return instance;
+    }
+
+    bool isSigned(const PreferenceType type) {
+        return type == PT_I8 || type == PT_I16 || type == PT_I32 || type == PT_I64;
+    }
+
+    size_t entriesOf(const Preferences::Value& value) {
+        switch (value.type) {
+        case PT_STR:
+            return 1 + (value.bytes.size() + 1 + kEntrySize - 1) / kEntrySize;
+        case PT_BLOB:
+            return 1 + (value.bytes.size() + kEntrySize - 1) / kEntrySize;
+        default:
+            return 1;
+        }
+    }
+
+    // expects the caller to hold the cache mutex
+    size_t usedEntries(const Cache& source) {
+        size_t result = 0;
+        for (const auto& space : source.namespaces) {
+            result++;
+            for (const auto& entry : space.second.entries) {
+                result += entriesOf(entry.second);
+            }
+        }
+        return result;
+    }
+
+    std::string formatString(const std::string& value) {
+        std::string result;
+        size_t newlineCount = std::count(value.begin(), value.end(), '\n');
+        if (!value.empty() && value.back() != '\n') {
+            newlineCount++;
+        }
+        if (newlineCount > 1 || value[0] == '#') {
+            result += "#" + std::to_string(newlineCount) + "\n";
+        }
+        return result + value + "\n";
+    }
+
+    std::string format(const std::string& name, const std::map<std::string, Preferences::Value>& entries) {
+        static constexpr char kHex[] = "0123456789abcdef";
+        std::string result = name + "\n";
+        for (const auto& entry : entries) {
+            const auto& value = entry.second;
+            result += entry.first;
+            // legacy values stay untagged, so they can still be read as numbers after saving
+            if (!value.legacy) {
+                result += std::string(":") + kTags[value.type];
+            }
+            result += "=";
+            if (value.type == PT_STR) {
+                result += formatString(value.bytes);
+                continue;
+            }
+            if (value.type == PT_BLOB) {
+                for (const auto byte : value.bytes) {
+                    result += kHex[static_cast<uint8_t>(byte) >> 4];
+                    result += kHex[byte & 0x0f];
+                }
+            }
+            else {
+                result += isSigned(value.type)
+                    ? std::to_string(static_cast<int64_t>(value.number))
+                    : std::to_string(value.number);
+            }
+            result += "\n";
+        }
+        return result + "\n";
+    }
+
+    int hexDigit(const char digit) {
+        if (digit >= '0' && digit <= '9') return digit - '0';
+        if (digit >= 'a' && digit <= 'f') return digit - 'a' + 10;
+        if (digit >= 'A' && digit <= 'F') return digit - 'A' + 10;
+        return -1;
+    }
+
+    /**
+     * \brief Parse a number or blob from preferences.txt. Strings are dealt with by the caller
+     * \return whether the text was valid for the type. If not, the entry is skipped
+     */
+    bool parse(const std::string& text, Preferences::Value& value) {
+        if (value.type == PT_BLOB) {
+            if (text.size() % 2 != 0) return false;
+            for (size_t i = 0; i < text.size(); i += 2) {
+                const auto high = hexDigit(text[i]);
+                const auto low = hexDigit(text[i + 1]);
+                if (high < 0 || low < 0) return false;
+                value.bytes += static_cast<char>(high << 4 | low);
+            }
+            return true;
+        }
+        if (text.empty()) return false;
+        char* end = nullptr;
+        errno = 0;
+        value.number = isSigned(value.type)
+            ? static_cast<uint64_t>(std::strtoll(text.c_str(), &end, 10))
+            : std::strtoull(text.c_str(), &end, 10);
+        return errno == 0 && *end == '\0';
+    }
+
+    PreferenceType typeOf(const std::string& tag) {
+        for (int i = PT_I8; i < PT_INVALID; i++) {
+            if (tag == kTags[i]) return static_cast<PreferenceType>(i);
+        }
+        return PT_INVALID;
+    }
+
+    // expects the caller to hold the cache mutex
+    void load(Cache& target) {
+        target.namespaces.clear();
+        std::ifstream stream(kPreferencesFile);
+        std::string categoryKey;
+        std::string line;
+        while (std::getline(stream, line)) {
+            if (line.length() == 0) continue;
+            const size_t equalsSign = line.find('=');
+            if (equalsSign == std::string::npos) {
+                categoryKey = line;
+                continue;
+            }
+            std::string key = line.substr(0, equalsSign);
+            std::string text = line.substr(equalsSign + 1);
+            Preferences::Value value;
+            value.type = PT_STR;
+            value.legacy = true;
+            const auto colon = key.rfind(':');
+            if (colon != std::string::npos) {
+                const auto type = typeOf(key.substr(colon + 1));
+                if (type != PT_INVALID) {
+                    value.type = type;
+                    value.legacy = false;
+                    key.erase(colon);
+                }
+            }
+            if (value.type != PT_STR) {
+                if (parse(text, value)) {
+                    target.namespaces[categoryKey].entries[key] = value;
+                }
+                continue;
+            }
+            char* end = nullptr;
+            const auto numberOfLines = text[0] == '#' ? std::strtol(text.c_str() + 1, &end, 10) : 0;
+            if (end != nullptr && *end == '\0' && end != text.c_str() + 1) {
+                text = "";
+                for (long i = 0; i < numberOfLines; i++) {
+                    std::string valueLine;
+                    if (!std::getline(stream, valueLine)) break;
+                    text += valueLine + (numberOfLines > 1 ? "\n" : "");
+                }
+            }
+            value.bytes = text;
+            if (value.legacy && !text.empty()) {
+                char* numberEnd = nullptr;
+                errno = 0;
+                value.number = static_cast<uint64_t>(std::strtoll(text.c_str(), &numberEnd, 10));
+                value.legacyNumber = errno == 0 && *numberEnd == '\0';
+            }
+            target.namespaces[categoryKey].entries[key] = value;
+        }
+        for (auto& entry : target.namespaces) {
+            entry.second.text = format(entry.first, entry.second.entries);
+        }
+        target.loaded = true;
+        target.dirty = false;
+    }
+    // expects the caller to hold the cache mutex. Unchanged namespaces are written as they were read
+    void save(Cache& source) {
+        if (!source.dirty) return;
+        std::ofstream stream(kPreferencesFile);
+        for (auto& entry : source.namespaces) {
+            if (entry.second.dirty) {
+                entry.second.text = format(entry.first, entry.second.entries);
+                entry.second.dirty = false;
+            }
+            stream << entry.second.text;
+        }
+        source.dirty = false;
+    }
 }
 
-void Preferences::clear() {
-    if (!_started) return;
-    _currentPreference->clear();
+bool Preferences::begin(const char* name, const bool readOnly, const char* /*partitionLabel*/) {
+    if (_started) return false;
+    auto& shared = cache();
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    if (!shared.loaded) load(shared);
+    shared.namespaces[name];
+    _name = name;
+    _readOnly = readOnly;
+    _started = true;
+    return true;
 }
 
 void Preferences::end() {
-    save();
+    testCommit();
     _started = false;
-    _currentPreference = nullptr;
 }
 
-bool Preferences::getBool(const char* key, const bool defaultValue) {
-    return getUInt(key, defaultValue);
+// Expects the caller to hold the cache mutex. Looked up every time, since testReload and testReset may drop the cache
+// while instances are begun (e.g. a global instance in the code under test)
+Preferences::Namespace& Preferences::current() const {
+    auto& shared = cache();
+    if (!shared.loaded) load(shared);
+    return shared.namespaces[_name];
+}
+
+bool Preferences::clear() {
+    if (!_started || _readOnly) return false;
+    auto& shared = cache();
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    auto& space = current();
+    if (space.entries.empty()) return true;
+    space.entries.clear();
+    space.dirty = true;
+    shared.dirty = true;
+    return true;
 }
 
-void Preferences::getBytes(const char* key, void* buf, const size_t maxLen) {
-    if (!isKey(key)) {
-        static_cast<char *>(buf)[0] = '\0';
-        return;
+bool Preferences::remove(const char* key) {
+    if (!_started || _readOnly) return false;
+    auto& shared = cache();
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    auto& space = current();
+    if (space.entries.erase(key) == 0) return false;
+    space.dirty = true;
+    shared.dirty = true;
+    return true;
+}
+
+// expects the caller to hold the cache mutex. PT_INVALID matches any type, and PT_BLOB matches legacy strings too
+const Preferences::Value* Preferences::find(const char* key, const PreferenceType type) const {
+    const auto& entries = current().entries;
+    const auto entry = entries.find(key);
+    if (entry == entries.end()) return nullptr;
+    if (type == PT_INVALID || entry->second.type == type) return &entry->second;
+    if (type == PT_BLOB && entry->second.legacy) return &entry->second;
+    return nullptr;
+}
+
+size_t Preferences::put(const char* key, Value value) {
+    if (!_started || _readOnly || key == nullptr) return 0;
+    auto& shared = cache();
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    auto& space = current();
+    const auto entry = space.entries.find(key);
+    // the numeric types come in signed/unsigned pairs of 1, 2, 4 and 8 bytes
+    const size_t size = value.type == PT_STR || value.type == PT_BLOB ? value.bytes.size() : 1u << (value.type / 2);
+    size_t existingEntries = 0;
+    if (entry != space.entries.end()) {
+        if (entry->second == value) return size;
+        existingEntries = entriesOf(entry->second);
     }
-    (*_currentPreference)[key].copy(static_cast<char*>(buf), maxLen);
+    if (usedEntries(shared) - existingEntries + entriesOf(value) > kEntryCapacity) return 0;
+    space.entries[key] = std::move(value);
+    space.dirty = true;
+    shared.dirty = true;
+    return size;
+}
+
+template <typename T>
+size_t Preferences::putNumber(const char* key, const PreferenceType type, const T value) {
+    Value entry;
+    entry.type = type;
+    entry.number = isSigned(type) ? static_cast<uint64_t>(static_cast<int64_t>(value)) : static_cast<uint64_t>(value);
+    return put(key, entry);
+}
+
+size_t Preferences::putChar(const char* key, const int8_t value) { return putNumber(key, PT_I8, value); }
+size_t Preferences::putUChar(const char* key, const uint8_t value) { return putNumber(key, PT_U8, value); }
+size_t Preferences::putShort(const char* key, const int16_t value) { return putNumber(key, PT_I16, value); }
+size_t Preferences::putUShort(const char* key, const uint16_t value) { return putNumber(key, PT_U16, value); }
+size_t Preferences::putInt(const char* key, const int32_t value) { return putNumber(key, PT_I32, value); }
+size_t Preferences::putUInt(const char* key, const uint32_t value) { return putNumber(key, PT_U32, value); }
+size_t Preferences::putLong(const char* key, const int32_t value) { return putNumber(key, PT_I32, value); }
+size_t Preferences::putULong(const char* key, const uint32_t value) { return putNumber(key, PT_U32, value); }
+size_t Preferences::putLong64(const char* key, const int64_t value) { return putNumber(key, PT_I64, value); }
+size_t Preferences::putULong64(const char* key, const uint64_t value) { return putNumber(key, PT_U64, value); }
+size_t Preferences::putFloat(const char* key, const float value) { return putBytes(key, &value, sizeof value); }
+size_t Preferences::putDouble(const char* key, const double value) { return putBytes(key, &value, sizeof value); }
+size_t Preferences::putBool(const char* key, const bool value) { return putUChar(key, value ? 1 : 0); }
+
+size_t Preferences::putString(const char* key, const char* value) {
+    if (value == nullptr) return 0;
+    Value entry;
+    entry.type = PT_STR;
+    entry.bytes = value;
+    return put(key, entry);
 }
 
-String Preferences::getString(const char* key) {
-    if (!_started) return "";
-    return {(*_currentPreference)[key].c_str()};
+size_t Preferences::putString(const char* key, const String& value) {
+    return putString(key, value.c_str());
 }
 
-unsigned Preferences::getUInt(const char* key, const int defaultValue) {
-    if (!isKey(key)) return defaultValue;
-    return std::stoi((*_currentPreference)[key]);
+size_t Preferences::putBytes(const char* key, const void* value, const size_t len) {
+    if (value == nullptr || len == 0) return 0;
+    Value entry;
+    entry.type = PT_BLOB;
+    entry.bytes.assign(static_cast<const char*>(value), len);
+    return put(key, entry);
 }
 
 bool Preferences::isKey(const char* key) {
-    if (!_started) return false;
-    return _currentPreference->find(key) != _currentPreference->end();
+    return getType(key) != PT_INVALID;
 }
 
-void Preferences::putString(const char* key, const char* value) {
-    if (!_started) return;
-    (*_currentPreference)[key] = value;
+PreferenceType Preferences::getType(const char* key) {
+    if (!_started || key == nullptr) return PT_INVALID;
+    std::lock_guard<std::mutex> lock(cache().mutex);
+    const auto value = find(key, PT_INVALID);
+    return value == nullptr ? PT_INVALID : value->type;
 }
 
-void Preferences::putBool(const char* key, bool value) {
-    putUInt(key, value);
+template <typename T>
+T Preferences::getNumber(const char* key, const PreferenceType type, const T defaultValue) {
+    if (!_started || key == nullptr) return defaultValue;
+    std::lock_guard<std::mutex> lock(cache().mutex);
+    const auto value = find(key, PT_INVALID);
+    if (value == nullptr) return defaultValue;
+    if (value->type == type) return static_cast<T>(value->number);
+    if (!value->legacyNumber) return defaultValue;
+    const auto number = static_cast<int64_t>(value->number);
+    const auto fits = number >= static_cast<int64_t>(std::numeric_limits<T>::min()) &&
+        (number < 0 || static_cast<uint64_t>(number) <= static_cast<uint64_t>(std::numeric_limits<T>::max()));
+    return fits ? static_cast<T>(number) : defaultValue;
 }
 
-void Preferences::putBytes(const char* key, const void* value, size_t len) {
-    if (!_started) return;
+int8_t Preferences::getChar(const char* key, const int8_t defaultValue) { return getNumber(key, PT_I8, defaultValue); }
+uint8_t Preferences::getUChar(const char* key, const uint8_t defaultValue) { return getNumber(key, PT_U8, defaultValue); }
+int16_t Preferences::getShort(const char* key, const int16_t defaultValue) { return getNumber(key, PT_I16, defaultValue); }
+uint16_t Preferences::getUShort(const char* key, const uint16_t defaultValue) { return getNumber(key, PT_U16, defaultValue); }
+int32_t Preferences::getInt(const char* key, const int32_t defaultValue) { return getNumber(key, PT_I32, defaultValue); }
+uint32_t Preferences::getUInt(const char* key, const uint32_t defaultValue) { return getNumber(key, PT_U32, defaultValue); }
+int32_t Preferences::getLong(const char* key, const int32_t defaultValue) { return getNumber(key, PT_I32, defaultValue); }
+uint32_t Preferences::getULong(const char* key, const uint32_t defaultValue) { return getNumber(key, PT_U32, defaultValue); }
+int64_t Preferences::getLong64(const char* key, const int64_t defaultValue) { return getNumber(key, PT_I64, defaultValue); }
+uint64_t Preferences::getULong64(const char* key, const uint64_t defaultValue) { return getNumber(key, PT_U64, defaultValue); }
 
-    (*_currentPreference)[key] = std::string(len, 0);
-    const auto p = static_cast<const char*>(value);
-    (*_currentPreference)[key].assign(p, len);
+float Preferences::getFloat(const char* key, const float defaultValue) {
+    float result;
+    return getValue(key, PT_BLOB, &result, sizeof result) == sizeof result ? result : defaultValue;
 }
 
-void Preferences::putUInt(const char* key, uint32_t value) {
-    if (!_started) return;
-    (*_currentPreference)[key] = std::to_string(value);
+double Preferences::getDouble(const char* key, const double defaultValue) {
+    double result;
+    return getValue(key, PT_BLOB, &result, sizeof result) == sizeof result ? result : defaultValue;
 }
 
-void Preferences::testReset() {
-    (void)std::remove("preferences.txt");
-}
-
-void Preferences::save() {
-    std::ofstream stream;
-    stream.open("preferences.txt");
-    for (const auto& categories : _preferences) {
-        stream << categories.first << "\n";
-        for (auto& entry : categories.second) {
-            stream << entry.first << "=";
-            size_t newlineCount = std::count(entry.second.begin(), entry.second.end(), '\n');
-            if (!entry.second.empty() && entry.second.back() != '\n') {
-                newlineCount++;
-            }
-            if (newlineCount > 1 || entry.second[0] == '#') {
-                stream << "#" << newlineCount << "\n";
-            }
-            stream << entry.second << "\n";
-        }
-        stream << "\n";
-    }
-    stream.close();
-}
-
-void Preferences::load() {
-    std::ifstream stream;
-    _preferences.clear();
-    std::string categoryKey;
-    stream.open("preferences.txt");
-    std::string line;
-    while (std::getline(stream, line)) {
-        if (line.length() == 0) continue;
-        const size_t equalsSign = line.find('=');
-        if (equalsSign == std::string::npos) {
-            categoryKey = line;
-            continue;
-        }
-        std::string key = line.substr(0, equalsSign);
-        std::string value = line.substr(equalsSign + 1);
+bool Preferences::getBool(const char* key, const bool defaultValue) {
+    return getUChar(key, defaultValue ? 1 : 0) != 0;
+}
 
-        if (value[0] == '#') {
-            const auto numberOfLines = std::stoi(value.substr(1));
-            value = "";
+// copy a string (with terminator) or a blob. Returns its size, or 0 if it doesn't fit
+size_t Preferences::getValue(const char* key, const PreferenceType type, void* buf, const size_t maxLen) {
+    if (!_started || key == nullptr || buf == nullptr) return 0;
+    std::lock_guard<std::mutex> lock(cache().mutex);
+    const auto value = find(key, type);
+    if (value == nullptr) return 0;
+    const auto size = value->bytes.size() + (type == PT_STR ? 1 : 0);
+    if (size > maxLen) return 0;
+    memcpy(buf, value->bytes.c_str(), size);
+    return size;
+}
 
-            for (int i = 0; i < numberOfLines; i++) {
-                std::string valueLine;
-                if (!std::getline(stream, valueLine)) break;
-                value += valueLine + (numberOfLines > 1 ? "\n" : "");
-            }
-        }
-        _preferences[categoryKey].insert(std::pair<std::string, std::string>(key, value));
-    }
-    stream.close();
+size_t Preferences::getString(const char* key, char* value, const size_t maxLen) {
+    return getValue(key, PT_STR, value, maxLen);
+}
+
+String Preferences::getString(const char* key, const String& defaultValue) {
+    if (!_started || key == nullptr) return defaultValue;
+    std::lock_guard<std::mutex> lock(cache().mutex);
+    const auto value = find(key, PT_STR);
+    return value == nullptr ? defaultValue : value->bytes.c_str();
 }
 
+size_t Preferences::getBytesLength(const char* key) {
+    if (!_started || key == nullptr) return 0;
+    std::lock_guard<std::mutex> lock(cache().mutex);
+    const auto value = find(key, PT_BLOB);
+    return value == nullptr ? 0 : value->bytes.size();
+}
+
+size_t Preferences::getBytes(const char* key, void* buf, const size_t maxLen) {
+    return getValue(key, PT_BLOB, buf, maxLen);
+}
+
+size_t Preferences::freeEntries() {
+    auto& shared = cache();
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    if (!shared.loaded) load(shared);
+    const auto used = usedEntries(shared);
+    return used >= kEntryCapacity ? 0 : kEntryCapacity - used;
+}
+
+void Preferences::testCommit() {
+    auto& shared = cache();
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    save(shared);
+}
+
+void Preferences::testReload() {
+    auto& shared = cache();
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    shared.namespaces.clear();
+    shared.loaded = false;
+    shared.dirty = false;
+}
+
+void Preferences::testReset() {
+    testReload();
+    (void)std::remove(kPreferencesFile);
+}
@@ -16,37 +16,117 @@
 #ifndef HEADER_PREFERENCES
 #define HEADER_PREFERENCES
 #include <map>
+#include <string>
 
+#include <cmath>
 #include <cstdint>
 #include "StringArduino.h"
 
+typedef enum {
+    PT_I8, PT_U8, PT_I16, PT_U16, PT_I32, PT_U32, PT_I64, PT_U64, PT_STR, PT_BLOB, PT_INVALID
+} PreferenceType;
+
 /**
- * \brief Mock implementation of the Preferences driver for unit testing (not targeting the ESP32)
+ * \brief Mock implementation of the Preferences driver for unit testing (not targeting the ESP32).
+ * All instances share a process-wide cache of preferences.txt, which is read on the first begin.
+ * The file is only written by end (or testCommit) if a namespace changed, and only changed namespaces are formatted again.
+ * Values are typed like in NVS: getting a value with another type than it was put with returns the default.
+ * Untagged values in preferences.txt, as older versions of the mock wrote them, can still be read as numbers or blobs
  */
 class Preferences {
 public:
-    bool begin(const char* name, bool readOnly = false);
-    void clear();
+    bool begin(const char* name, bool readOnly = false, const char* partitionLabel = nullptr);
     void end();
-    bool getBool(const char* key, bool defaultValue);
-    void getBytes(const char* key, void* buf, size_t maxLen);
-    String getString(const char* key);
-    unsigned getUInt(const char* key, int defaultValue);
+
+    bool clear();
+    bool remove(const char* key);
+
+    size_t putChar(const char* key, int8_t value);
+    size_t putUChar(const char* key, uint8_t value);
+    size_t putShort(const char* key, int16_t value);
+    size_t putUShort(const char* key, uint16_t value);
+    size_t putInt(const char* key, int32_t value);
+    size_t putUInt(const char* key, uint32_t value);
+    size_t putLong(const char* key, int32_t value);
+    size_t putULong(const char* key, uint32_t value);
+    size_t putLong64(const char* key, int64_t value);
+    size_t putULong64(const char* key, uint64_t value);
+
+    // floats and doubles are stored as blobs, like on the ESP32
+    size_t putFloat(const char* key, float value);
+    size_t putDouble(const char* key, double value);
+    size_t putBool(const char* key, bool value);
+    size_t putString(const char* key, const char* value);
+    size_t putString(const char* key, const String& value);
+    size_t putBytes(const char* key, const void* value, size_t len);
+
     bool isKey(const char* key);
-    void putString(const char* key, const char* value);
-    void putBool(const char* key, bool value);
-    void putBytes(const char* key, const void* value, size_t len);
-    void putUInt(const char* key, uint32_t value);
+    PreferenceType getType(const char* key);
+
+    int8_t getChar(const char* key, int8_t defaultValue = 0);
+    uint8_t getUChar(const char* key, uint8_t defaultValue = 0);
+    int16_t getShort(const char* key, int16_t defaultValue = 0);
+    uint16_t getUShort(const char* key, uint16_t defaultValue = 0);
+    int32_t getInt(const char* key, int32_t defaultValue = 0);
+    uint32_t getUInt(const char* key, uint32_t defaultValue = 0);
+    int32_t getLong(const char* key, int32_t defaultValue = 0);
+    uint32_t getULong(const char* key, uint32_t defaultValue = 0);
+    int64_t getLong64(const char* key, int64_t defaultValue = 0);
+    uint64_t getULong64(const char* key, uint64_t defaultValue = 0);
+    float getFloat(const char* key, float defaultValue = NAN);
+    double getDouble(const char* key, double defaultValue = NAN);
+    bool getBool(const char* key, bool defaultValue = false);
+
+    /**
+     * \brief Get a string into a buffer
+     * \return the length including the terminator, or 0 if the key isn't a string or the buffer is too small
+     */
+    size_t getString(const char* key, char* value, size_t maxLen);
+    String getString(const char* key, const String& defaultValue = String());
+
+    /**
+     * \return the size of a blob without copying it, or 0 if the key isn't a blob
+     */
+    size_t getBytesLength(const char* key);
+
+    /**
+     * \return the number of bytes copied, or 0 if the key isn't a blob or the buffer is too small
+     */
+    size_t getBytes(const char* key, void* buf, size_t maxLen);
+
+    /**
+     * \return the number of free 32 byte entries, as in the default 20 KiB NVS partition.
+     * A number takes one entry, a string or blob one plus one per 32 bytes, and a namespace one
+     */
+    size_t freeEntries();
+
+    /**
+     * \brief Testing: write the changed namespaces to preferences.txt now rather than at end
+     */
+    static void testCommit();
+
+    /**
+     * \brief Testing: drop the cache without saving, so the next begin reads preferences.txt again (like after a reboot)
+     */
+    static void testReload();
 
     // testing only, to reset the entire preferences content
     static void testReset();
+
+    // a namespace in the shared cache, and a value in it
+    struct Namespace;
+    struct Value;
 private:
-    std::map<std::string, std::map<std::string, std::string>> _preferences;
+    Namespace& current() const;
+    const Value* find(const char* key, PreferenceType type) const;
+    template <typename T> T getNumber(const char* key, PreferenceType type, T defaultValue);
+    size_t getValue(const char* key, PreferenceType type, void* buf, size_t maxLen);
+    size_t put(const char* key, Value value);
+    template <typename T> size_t putNumber(const char* key, PreferenceType type, T value);
 
-    std::map<std::string, std::string>* _currentPreference = nullptr;
+    std::string _name;
+    bool _readOnly = false;
     bool _started = false;
-    void save();
-    void load();
 };
 
 #endif
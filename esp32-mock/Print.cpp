@@ -0,0 +1,122 @@
+// Copyright 2026 Rik Essenius
+// 
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file
+// except in compliance with the License. You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+// Mock implementation of the Arduino Print class for unit testing (not targeting the ESP32)
+
+#include "Print.h"
+#include <cmath>
+
+namespace {
+    // enough for a 64 bit number in binary, and for the integer part and decimals of a float
+    constexpr size_t kNumberBufferSize = 72;
+    constexpr int kMaxFloatDigits = 32;
+
+    // Writes the digits backwards from the end of the buffer, and returns where they start
+    char* formatNumber(unsigned long long value, int base, char* end) {
+        if (base < 2 || base > 36) base = 10;
+        char* start = end;
+        do {
+            const auto digit = static_cast<char>(value % static_cast<unsigned long long>(base));
+            value /= static_cast<unsigned long long>(base);
+            *--start = static_cast<char>(digit < 10 ? '0' + digit : 'A' + digit - 10);
+        } while (value > 0);
+        return start;
+    }
+}
+
+constexpr size_t Print::kPrintfBufferSize;
+
+size_t Print::write(const uint8_t* buffer, const size_t size) {
+    size_t count = 0;
+    while (count < size && write(buffer[count]) == 1) {
+        count++;
+    }
+    return count;
+}
+
+// Like Arduino, only decimal numbers get a sign. Other bases show the bits of the unsigned type
+
+size_t Print::print(const unsigned char value, const int base) {
+    return printNumber(value, base, false);
+}
+
+size_t Print::print(const int value, const int base) {
+    if (base == DEC && value < 0) return printNumber(0ULL - static_cast<unsigned long long>(value), base, true);
+    return printNumber(static_cast<unsigned int>(value), base, false);
+}
+
+size_t Print::print(const unsigned int value, const int base) {
+    return printNumber(value, base, false);
+}
+
+size_t Print::print(const long value, const int base) {
+    if (base == DEC && value < 0) return printNumber(0ULL - static_cast<unsigned long long>(value), base, true);
+    return printNumber(static_cast<unsigned long>(value), base, false);
+}
+
+size_t Print::print(const unsigned long value, const int base) {
+    return printNumber(value, base, false);
+}
+
+size_t Print::print(const long long value, const int base) {
+    if (base == DEC && value < 0) return printNumber(0ULL - static_cast<unsigned long long>(value), base, true);
+    return printNumber(static_cast<unsigned long long>(value), base, false);
+}
+
+size_t Print::print(const unsigned long long value, const int base) {
+    return printNumber(value, base, false);
+}
+
+size_t Print::print(double value, int digits) {
+    if (std::isnan(value)) return write("nan", 3);
+    if (std::isinf(value)) return write("inf", 3);
+    // the integer part must fit in 32 bits, as on the device
+    if (value > 4294967040.0 || value < -4294967040.0) return write("ovf", 3);
+
+    char buffer[kNumberBufferSize];
+    char* end = buffer + sizeof buffer;
+    digits = std::max(0, std::min(digits, kMaxFloatDigits));
+    const bool negative = value < 0.0;
+    if (negative) value = -value;
+
+    // round to the number of decimals, e.g. 1.999 with 2 digits becomes 2.00
+    double rounding = 0.5;
+    for (int i = 0; i < digits; i++) {
+        rounding /= 10.0;
+    }
+    value += rounding;
+    const auto integerPart = static_cast<unsigned long long>(value);
+    double remainder = value - static_cast<double>(integerPart);
+
+    // the integer part goes right in front of the decimals, which start after the kMaxFloatDigits + 1 positions
+    char* decimals = end - kMaxFloatDigits - 1;
+    char* start = formatNumber(integerPart, DEC, decimals);
+    if (negative) *--start = '-';
+    char* current = decimals;
+    if (digits > 0) {
+        *current++ = '.';
+    }
+    for (int i = 0; i < digits; i++) {
+        remainder *= 10.0;
+        const auto digit = static_cast<int>(remainder);
+        *current++ = static_cast<char>('0' + digit);
+        remainder -= digit;
+    }
+    return write(start, static_cast<size_t>(current - start));
+}
+
+size_t Print::printNumber(const unsigned long long value, const int base, const bool negative) {
+    char buffer[kNumberBufferSize];
+    char* end = buffer + sizeof buffer;
+    char* start = formatNumber(value, base, end);
+    if (negative) *--start = '-';
+    return write(start, static_cast<size_t>(end - start));
+}
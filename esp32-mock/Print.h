@@ -0,0 +1,112 @@
+// Copyright 2026 Rik Essenius
+// 
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file
+// except in compliance with the License. You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+// Mock implementation of the Arduino Print class for unit testing (not targeting the ESP32)
+
+// Disabling warnings caused by mimicking existing interfaces
+// ReSharper disable CppInconsistentNaming
+
+#ifndef HEADER_PRINT
+#define HEADER_PRINT
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include "StringArduino.h"
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+/**
+ * \brief Mock implementation of the Print class for unit testing (not targeting the ESP32).
+ * Everything ends up in write(const uint8_t*, size_t), so derived classes only need to override that (and the single
+ * byte write) to get bulk writes. Numbers are formatted on the stack and written in one go.
+ */
+class Print {
+public:
+    Print() = default;
+    Print(const Print&) = default;
+    Print(Print&&) = default;
+    Print& operator=(const Print&) = default;
+    Print& operator=(Print&&) = default;
+    virtual ~Print() = default;
+
+    virtual size_t write(uint8_t value) = 0;
+
+    /**
+     * \brief Write a buffer. The default writes byte by byte, so derived classes should override it
+     * \return the number of bytes written
+     */
+    virtual size_t write(const uint8_t* buffer, size_t size);
+
+    size_t write(const char* text) { return text == nullptr ? 0 : write(text, strlen(text)); }
+    size_t write(const char* buffer, const size_t size) { return write(reinterpret_cast<const uint8_t*>(buffer), size); }
+
+    virtual int availableForWrite() { return 0; }
+    virtual void flush() { /* nothing buffered by default */ }
+
+    size_t print(const char* text) { return write(text); }
+    size_t print(const String& text) { return write(text.c_str(), text.length()); }
+    size_t print(char value) { return write(static_cast<uint8_t>(value)); }
+    size_t print(unsigned char value, int base = DEC);
+    size_t print(int value, int base = DEC);
+    size_t print(unsigned int value, int base = DEC);
+    size_t print(long value, int base = DEC);
+    size_t print(unsigned long value, int base = DEC);
+    size_t print(long long value, int base = DEC);
+    size_t print(unsigned long long value, int base = DEC);
+
+    /**
+     * \brief Print a floating point number like Arduino does: "nan", "inf", "ovf" beyond 32 bit integers
+     * \param value the value to print
+     * \param digits the number of decimals
+     */
+    size_t print(double value, int digits = 2);
+
+    // unlike on the device, lines end with just \n, which keeps expected output in tests simple
+    size_t println() { return write("\n", 1); }
+    size_t println(const char* text) { return print(text) + println(); }
+    size_t println(const String& text) { return print(text) + println(); }
+    size_t println(char value) { return print(value) + println(); }
+    size_t println(unsigned char value, int base = DEC) { return print(value, base) + println(); }
+    size_t println(int value, int base = DEC) { return print(value, base) + println(); }
+    size_t println(unsigned int value, int base = DEC) { return print(value, base) + println(); }
+    size_t println(long value, int base = DEC) { return print(value, base) + println(); }
+    size_t println(unsigned long value, int base = DEC) { return print(value, base) + println(); }
+    size_t println(long long value, int base = DEC) { return print(value, base) + println(); }
+    size_t println(unsigned long long value, int base = DEC) { return print(value, base) + println(); }
+    size_t println(double value, int digits = 2) { return print(value, digits) + println(); }
+
+    template <typename... Arguments>
+    int printf(const char* format, Arguments ... arguments) {
+        // most output fits in the stack buffer, so we only format twice for long output
+        char buffer[kPrintfBufferSize];
+        const int length = std::snprintf(buffer, sizeof buffer, format, arguments...);
+        if (length < 0) return length;
+        if (static_cast<size_t>(length) < sizeof buffer) {
+            write(buffer, static_cast<size_t>(length));
+            return length;
+        }
+        std::string longBuffer(static_cast<size_t>(length) + 1, '\0');
+        std::snprintf(&longBuffer[0], longBuffer.size(), format, arguments...);
+        write(longBuffer.c_str(), static_cast<size_t>(length));
+        return length;
+    }
+
+private:
+    static constexpr size_t kPrintfBufferSize = 256;
+    size_t printNumber(unsigned long long value, int base, bool negative);
+};
+
+#endif
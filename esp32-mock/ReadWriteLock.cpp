@@ -0,0 +1,47 @@
+// Copyright 2026 Rik Essenius
+// 
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file
+// except in compliance with the License. You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+// Reader-writer lock for the mocks, since std::shared_mutex needs C++17 (not part of the ESP32 API)
+
+#include "ReadWriteLock.h"
+
+void ReadWriteLock::lock() {
+    std::unique_lock<std::mutex> guard(_mutex);
+    _waitingWriters++;
+    _condition.wait(guard, [this] { return !_writing && _readers == 0; });
+    _waitingWriters--;
+    _writing = true;
+}
+
+void ReadWriteLock::lockShared() {
+    std::unique_lock<std::mutex> guard(_mutex);
+    _condition.wait(guard, [this] { return !_writing && _waitingWriters == 0; });
+    _readers++;
+}
+
+void ReadWriteLock::unlock() {
+    {
+        std::lock_guard<std::mutex> guard(_mutex);
+        _writing = false;
+    }
+    _condition.notify_all();
+}
+
+void ReadWriteLock::unlockShared() {
+    bool last;
+    {
+        std::lock_guard<std::mutex> guard(_mutex);
+        last = --_readers == 0;
+    }
+    if (last) {
+        _condition.notify_all();
+    }
+}
@@ -0,0 +1,57 @@
+// Copyright 2026 Rik Essenius
+// 
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file
+// except in compliance with the License. You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+// Reader-writer lock for the mocks, since std::shared_mutex needs C++17 (not part of the ESP32 API)
+
+#ifndef HEADER_READ_WRITE_LOCK
+#define HEADER_READ_WRITE_LOCK
+
+#include <condition_variable>
+#include <mutex>
+
+/**
+ * \brief Testing: a lock that any number of readers can hold at once, or a single writer.
+ * Waiting writers go first, so a steady stream of readers can't starve them.
+ * lock() and unlock() take it for writing, so it works with std::lock_guard.
+ */
+class ReadWriteLock {
+public:
+    /**
+     * \brief Holds the lock for reading while in scope
+     */
+    class ReadGuard {
+    public:
+        explicit ReadGuard(ReadWriteLock& lock) : _lock(lock) { _lock.lockShared(); }
+        ~ReadGuard() { _lock.unlockShared(); }
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+    private:
+        ReadWriteLock& _lock;
+    };
+
+    ReadWriteLock() = default;
+    ReadWriteLock(const ReadWriteLock&) = delete;
+    ReadWriteLock& operator=(const ReadWriteLock&) = delete;
+
+    void lock();
+    void lockShared();
+    void unlock();
+    void unlockShared();
+
+private:
+    std::mutex _mutex;
+    std::condition_variable _condition;
+    unsigned _readers = 0;
+    unsigned _waitingWriters = 0;
+    bool _writing = false;
+};
+
+#endif
@@ -0,0 +1,63 @@
+// Copyright 2026 Rik Essenius
+// 
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file
+// except in compliance with the License. You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+// Output destinations for the HardwareSerial mock, for long running simulations (not targeting the ESP32)
+
+#include "SerialSink.h"
+#include <cstring>
+
+FileSerialSink::FileSerialSink(const char* path, const bool append, const size_t bufferSize) :
+    _stream(std::fopen(path, append ? "ab" : "wb")),
+    _ownsStream(true),
+    _buffer(bufferSize > 0 ? bufferSize : 1) {
+    // we do our own batching, so stdio buffering would only add a copy
+    if (_stream != nullptr) {
+        std::setvbuf(_stream, nullptr, _IONBF, 0);
+    }
+}
+
+FileSerialSink::FileSerialSink(FILE* stream, const size_t bufferSize) :
+    _stream(stream),
+    _ownsStream(false),
+    _buffer(bufferSize > 0 ? bufferSize : 1) {}
+
+FileSerialSink::~FileSerialSink() {
+    flush();
+    if (_ownsStream && _stream != nullptr) {
+        std::fclose(_stream);
+    }
+}
+
+void FileSerialSink::write(const char* data, const size_t length) {
+    if (_stream == nullptr) return;
+    if (_bufferUsed + length > _buffer.size()) {
+        writeBuffer();
+    }
+    // writes that don't fit in an empty buffer go out directly
+    if (length > _buffer.size()) {
+        std::fwrite(data, 1, length, _stream);
+        return;
+    }
+    memcpy(_buffer.data() + _bufferUsed, data, length);
+    _bufferUsed += length;
+}
+
+void FileSerialSink::flush() {
+    if (_stream == nullptr) return;
+    writeBuffer();
+    std::fflush(_stream);
+}
+
+void FileSerialSink::writeBuffer() {
+    if (_bufferUsed == 0) return;
+    std::fwrite(_buffer.data(), 1, _bufferUsed, _stream);
+    _bufferUsed = 0;
+}
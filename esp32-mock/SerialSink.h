@@ -0,0 +1,76 @@
+// Copyright 2026 Rik Essenius
+// 
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file
+// except in compliance with the License. You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+// Output destinations for the HardwareSerial mock, for long running simulations (not targeting the ESP32)
+
+#ifndef HEADER_SERIAL_SINK
+#define HEADER_SERIAL_SINK
+
+#include <cstdio>
+#include <vector>
+
+/**
+ * \brief Testing: destination for Serial output, next to or instead of the in-memory output
+ */
+class SerialSink {
+public:
+    SerialSink() = default;
+    SerialSink(const SerialSink&) = delete;
+    SerialSink(SerialSink&&) = delete;
+    SerialSink& operator=(const SerialSink&) = delete;
+    SerialSink& operator=(SerialSink&&) = delete;
+    virtual ~SerialSink() = default;
+    virtual void write(const char* data, size_t length) = 0;
+    virtual void flush() = 0;
+};
+
+/**
+ * \brief Testing: Serial output to a file, stdout, a pipe or a pty, written in batches
+ */
+class FileSerialSink : public SerialSink {
+public:
+    static constexpr size_t kDefaultBufferSize = 65536;
+
+    /**
+     * \brief Open (and own) a file. Named pipes and pty devices (e.g. /dev/pts/3) can be opened this way too
+     * \param path the path of the file
+     * \param append whether to append to an existing file rather than overwrite it
+     * \param bufferSize the number of bytes collected before writing a batch
+     */
+    explicit FileSerialSink(const char* path, bool append = false, size_t bufferSize = kDefaultBufferSize);
+
+    /**
+     * \brief Use a stream that is already open (e.g. stdout, or the result of popen). The stream is not closed
+     * \param stream the stream to write to
+     * \param bufferSize the number of bytes collected before writing a batch
+     */
+    explicit FileSerialSink(FILE* stream, size_t bufferSize = kDefaultBufferSize);
+
+    FileSerialSink(const FileSerialSink&) = delete;
+    FileSerialSink(FileSerialSink&&) = delete;
+    FileSerialSink& operator=(const FileSerialSink&) = delete;
+    FileSerialSink& operator=(FileSerialSink&&) = delete;
+    ~FileSerialSink() override;
+
+    bool isOpen() const { return _stream != nullptr; }
+    void write(const char* data, size_t length) override;
+    void flush() override;
+
+private:
+    void writeBuffer();
+
+    FILE* _stream;
+    bool _ownsStream;
+    std::vector<char> _buffer;
+    size_t _bufferUsed = 0;
+};
+
+#endif
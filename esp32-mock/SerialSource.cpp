@@ -0,0 +1,61 @@
+// Copyright 2026 Rik Essenius
+// 
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file
+// except in compliance with the License. You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+// Input origins for the HardwareSerial mock, to replay captured input (not targeting the ESP32)
+
+#include "SerialSource.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    FILE* openSource(const char* path) {
+#ifdef _WIN32
+        return std::fopen(path, "rb");
+#else
+        // Non-blocking, so opening a pipe doesn't wait for a writer and reading doesn't wait for data
+        const int descriptor = open(path, O_RDONLY | O_NONBLOCK);
+        if (descriptor < 0) return nullptr;
+        FILE* stream = fdopen(descriptor, "rb");
+        if (stream == nullptr) {
+            close(descriptor);
+        }
+        return stream;
+#endif
+    }
+}
+
+FileSerialSource::FileSerialSource(const char* path) : _stream(openSource(path)), _ownsStream(true) {
+    // the serial mock reads in chunks, so stdio buffering would only add a copy
+    if (_stream != nullptr) {
+        std::setvbuf(_stream, nullptr, _IONBF, 0);
+    }
+}
+
+FileSerialSource::FileSerialSource(FILE* stream) : _stream(stream), _ownsStream(false) {}
+
+FileSerialSource::~FileSerialSource() {
+    if (_ownsStream && _stream != nullptr) {
+        std::fclose(_stream);
+    }
+}
+
+size_t FileSerialSource::read(uint8_t* buffer, const size_t length) {
+    if (_stream == nullptr) return 0;
+    const size_t bytesRead = std::fread(buffer, 1, length, _stream);
+    if (bytesRead < length) {
+        // end of file or no data yet on a pipe. Either way more data may come later
+        std::clearerr(_stream);
+    }
+    return bytesRead;
+}
@@ -0,0 +1,72 @@
+// Copyright 2026 Rik Essenius
+// 
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file
+// except in compliance with the License. You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+// Input origins for the HardwareSerial mock, to replay captured input (not targeting the ESP32)
+
+#ifndef HEADER_SERIAL_SOURCE
+#define HEADER_SERIAL_SOURCE
+
+#include <cstdint>
+#include <cstdio>
+
+/**
+ * \brief Testing: origin of Serial input, read when the Serial input buffer runs empty
+ */
+class SerialSource {
+public:
+    SerialSource() = default;
+    SerialSource(const SerialSource&) = delete;
+    SerialSource(SerialSource&&) = delete;
+    SerialSource& operator=(const SerialSource&) = delete;
+    SerialSource& operator=(SerialSource&&) = delete;
+    virtual ~SerialSource() = default;
+
+    /**
+     * \brief Read the bytes that are available now, without waiting for more
+     * \param buffer the buffer to read into
+     * \param length the maximum number of bytes to read
+     * \return the number of bytes read, 0 if nothing is available (yet)
+     */
+    virtual size_t read(uint8_t* buffer, size_t length) = 0;
+};
+
+/**
+ * \brief Testing: Serial input from a file, a pipe or a pty
+ */
+class FileSerialSource : public SerialSource {
+public:
+    /**
+     * \brief Open (and own) a file. Named pipes and pty devices are opened non-blocking, so reads return what is there
+     * \param path the path of the file
+     */
+    explicit FileSerialSource(const char* path);
+
+    /**
+     * \brief Use a stream that is already open (e.g. stdin, or the result of popen). The stream is not closed
+     * \param stream the stream to read from
+     */
+    explicit FileSerialSource(FILE* stream);
+
+    FileSerialSource(const FileSerialSource&) = delete;
+    FileSerialSource(FileSerialSource&&) = delete;
+    FileSerialSource& operator=(const FileSerialSource&) = delete;
+    FileSerialSource& operator=(FileSerialSource&&) = delete;
+    ~FileSerialSource() override;
+
+    bool isOpen() const { return _stream != nullptr; }
+    size_t read(uint8_t* buffer, size_t length) override;
+
+private:
+    FILE* _stream;
+    bool _ownsStream;
+};
+
+#endif
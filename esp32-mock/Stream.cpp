@@ -0,0 +1,68 @@
+// Copyright 2026 Rik Essenius
+// 
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file
+// except in compliance with the License. You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+// Mock implementation of the Arduino Stream class for unit testing (not targeting the ESP32)
+
+#include "Stream.h"
+#include <string>
+
+// Keeps the last bytes read, so a partial match that fails can still overlap with the real one
+bool Stream::find(const char* target, const size_t length) {
+    if (length == 0) return true;
+    std::string window;
+    int value;
+    while ((value = read()) >= 0) {
+        window += static_cast<char>(value);
+        if (window.size() > length) {
+            window.erase(0, 1);
+        }
+        if (window.size() == length && memcmp(window.data(), target, length) == 0) return true;
+    }
+    return false;
+}
+
+size_t Stream::readBytes(char* buffer, const size_t length) {
+    size_t count = 0;
+    while (count < length) {
+        const int value = read();
+        if (value < 0) break;
+        buffer[count++] = static_cast<char>(value);
+    }
+    return count;
+}
+
+size_t Stream::readBytesUntil(const char terminator, char* buffer, const size_t length) {
+    size_t count = 0;
+    while (count < length) {
+        const int value = read();
+        if (value < 0 || static_cast<char>(value) == terminator) break;
+        buffer[count++] = static_cast<char>(value);
+    }
+    return count;
+}
+
+String Stream::readString() {
+    String result;
+    int value;
+    while ((value = read()) >= 0) {
+        result += static_cast<char>(value);
+    }
+    return result;
+}
+
+String Stream::readStringUntil(const char terminator) {
+    String result;
+    int value;
+    while ((value = read()) >= 0 && static_cast<char>(value) != terminator) {
+        result += static_cast<char>(value);
+    }
+    return result;
+}
@@ -0,0 +1,69 @@
+// Copyright 2026 Rik Essenius
+// 
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file
+// except in compliance with the License. You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+// Mock implementation of the Arduino Stream class for unit testing (not targeting the ESP32)
+
+// Disabling warnings caused by mimicking existing interfaces
+// ReSharper disable CppInconsistentNaming
+
+#ifndef HEADER_STREAM
+#define HEADER_STREAM
+
+#include <cstring>
+#include "Print.h"
+
+/**
+ * \brief Mock implementation of the Stream class for unit testing (not targeting the ESP32).
+ * The bulk reads default to reading byte by byte, and derived classes can override them with something faster.
+ * Reads don't wait for the timeout: what isn't there is not coming in a mock.
+ */
+class Stream : public Print {
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    /**
+     * \brief Read until just after the target
+     * \param target the bytes to look for
+     * \param length the number of bytes in the target
+     * \return whether the target was found. If not, everything was read
+     */
+    virtual bool find(const char* target, size_t length);
+    bool find(const char* target) { return find(target, strlen(target)); }
+    bool find(const char target) { return find(&target, 1); }
+
+    void setTimeout(const unsigned long timeout) { _timeout = timeout; }
+    unsigned long getTimeout() const { return _timeout; }
+
+    virtual size_t readBytes(char* buffer, size_t length);
+    size_t readBytes(uint8_t* buffer, const size_t length) { return readBytes(reinterpret_cast<char*>(buffer), length); }
+
+    /**
+     * \brief Read until the terminator or until length bytes are read. The terminator is consumed but not stored
+     */
+    virtual size_t readBytesUntil(char terminator, char* buffer, size_t length);
+    size_t readBytesUntil(const char terminator, uint8_t* buffer, const size_t length) {
+        return readBytesUntil(terminator, reinterpret_cast<char*>(buffer), length);
+    }
+
+    virtual String readString();
+
+    /**
+     * \brief Read until the terminator, which is consumed but not included
+     */
+    virtual String readStringUntil(char terminator);
+
+private:
+    unsigned long _timeout = 1000;
+};
+
+#endif
@@ -15,6 +15,8 @@
 #ifndef HEADER_WIFI_CLIENT
 #define HEADER_WIFI_CLIENT
 
+#include <algorithm>
+#include <string>
 #include "Client.h"
 
 /**
@@ -26,8 +28,43 @@ public:
     bool isConnected() { return true; }
     void stop() { /* no-op */ }
 
+    using Print::write;
+    int available() override { return static_cast<int>(_input.size() - _inputPosition); }
+    int peek() override { return _inputPosition < _input.size() ? static_cast<uint8_t>(_input[_inputPosition]) : -1; }
+    int read() override { return _inputPosition < _input.size() ? static_cast<uint8_t>(_input[_inputPosition++]) : -1; }
+
+    size_t readBytes(char* buffer, const size_t length) override {
+        const size_t count = std::min(length, _input.size() - _inputPosition);
+        _input.copy(buffer, count, _inputPosition);
+        _inputPosition += count;
+        return count;
+    }
+
+    size_t write(const uint8_t value) override { _output.push_back(static_cast<char>(value)); return 1; }
+
+    size_t write(const uint8_t* buffer, const size_t size) override {
+        _output.append(reinterpret_cast<const char*>(buffer), size);
+        return size;
+    }
+
     //testing
     const char* testGetType() override { return "WifiClient"; }
+
+    /**
+     * \brief Testing: what was written to the client (binary safe)
+     */
+    const std::string& testGetOutput() const { return _output; }
+    void testClearOutput() { _output.clear(); }
+
+    /**
+     * \brief Testing: replace what the client has to read (binary safe)
+     */
+    void testSetInput(const std::string& input) { _input = input; _inputPosition = 0; }
+
+private:
+    std::string _output;
+    std::string _input;
+    size_t _inputPosition = 0;
 };
 
 #endif
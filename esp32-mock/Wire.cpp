@@ -18,6 +18,8 @@
 // ReSharper disable CppParameterMayBeConst
 
 #include "Wire.h"
+#include <algorithm>
+#include <cstring>
 
 TwoWire Wire;
 TwoWire Wire1;
@@ -59,6 +61,10 @@ int TwoWire::read() {
     return _nextResult++;
 }
 
+int TwoWire::peek() {
+    return _nextResult;
+}
+
 uint8_t TwoWire::requestFrom(uint8_t /*address*/, uint8_t /*size*/, bool /*stop*/) {
     return 0;
 }
@@ -75,6 +81,13 @@ size_t TwoWire::write(uint8_t value) {
     return 0;
 }
 
+size_t TwoWire::write(const uint8_t* buffer, const size_t size) {
+    const size_t count = std::min(size, static_cast<size_t>(kWriteBufferSize - _writeIndex));
+    memcpy(_written + _writeIndex, buffer, count);
+    _writeIndex = static_cast<short>(_writeIndex + count);
+    return count;
+}
+
 short TwoWire::testWriteMismatchIndex(const uint8_t* expected, const short length) const {
     if (length != _writeIndex) return -1;
     for (short i = 0; i < length; i++) {
@@ -20,13 +20,15 @@
 /**
  * \brief Mock implementation of the Wire protocol driver for unit testing (not targeting the ESP32)
  */
-class TwoWire {
+class TwoWire : public Stream {
 public:
+    using Print::write;
+
     /**
      * \brief 
      * \return number of bytes available for reading 
      */
-    int available();
+    int available() override;
 
     /**
      * \brief Initialize the Wire library with a given I2C address and pins
@@ -45,9 +47,20 @@ public:
      * \brief read a byte from the I2C bus
      * \return byte read from the I2C bus
      */
-    int read();
+    int read() override;
+
+    /**
+     * \brief peek at the next byte from the I2C bus without consuming it
+     */
+    int peek() override;
 
-    size_t write(uint8_t value);
+    size_t write(uint8_t value) override;
+
+    /**
+     * \brief write a buffer in one go
+     * \return the number of bytes that fit in the write buffer
+     */
+    size_t write(const uint8_t* buffer, size_t size) override;
 
     uint8_t endTransmission();
     /**
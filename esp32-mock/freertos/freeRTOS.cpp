@@ -122,6 +122,8 @@ namespace {
     unsigned long taskHandle = 100;
     auto testHandle = reinterpret_cast<TaskHandle_t>(42);
     bool taskNotifyLocked = true;
+    thread_local TaskHandle_t currentTaskHandle = nullptr;
+    thread_local BaseType_t currentCoreId = 0;
 }
 
 BaseType_t xTaskCreatePinnedToCore(
@@ -137,7 +139,14 @@ BaseType_t xTaskCreatePinnedToCore(
     return pdTRUE;
 }
 
-TaskHandle_t xTaskGetCurrentTaskHandle() { return testHandle; }
+TaskHandle_t xTaskGetCurrentTaskHandle() { return currentTaskHandle != nullptr ? currentTaskHandle : testHandle; }
+
+BaseType_t xPortGetCoreID() { return currentCoreId; }
+
+void testSetCurrentTask(TaskHandle_t handle, BaseType_t coreId) {
+    currentTaskHandle = handle;
+    currentCoreId = coreId;
+}
 
 
 void vTaskNotifyGiveFromISR(TaskHandle_t /*xTaskToNotify*/, BaseType_t* /*pxHigherPriorityTaskWoken*/) {
@@ -149,3 +158,38 @@ uint32_t ulTaskNotifyTake(BaseType_t /*xClearCountOnExit*/, TickType_t /*xTicksT
     taskNotifyLocked = true;
     return 1;
 }
+
+// Ticks
+
+namespace {
+    constexpr int64_t kMicrosPerTick = 1000000 / configTICK_RATE_HZ;
+}
+
+TickType_t xTaskGetTickCount() {
+    // TickType_t is 32 bits, so the tick count wraps like it does on the device
+    return static_cast<TickType_t>(esp_timer_get_time() / kMicrosPerTick);
+}
+
+TickType_t xTaskGetTickCountFromISR() {
+    return xTaskGetTickCount();
+}
+
+void vTaskDelay(TickType_t xTicksToDelay) {
+    delay(pdTICKS_TO_MS(xTicksToDelay));
+}
+
+BaseType_t xTaskDelayUntil(TickType_t* pxPreviousWakeTime, TickType_t xTimeIncrement) {
+    const int64_t now = esp_timer_get_time();
+    const auto nowTicks = static_cast<TickType_t>(now / kMicrosPerTick);
+
+    // unsigned arithmetic takes care of the tick count wrapping around
+    const TickType_t elapsed = nowTicks - *pxPreviousWakeTime;
+    *pxPreviousWakeTime += xTimeIncrement;
+    if (elapsed >= xTimeIncrement) return pdFALSE;
+
+    // Wake up at the start of the wake tick rather than after a number of whole ticks,
+    // so the time spent within the current tick doesn't accumulate over the periods
+    const int64_t wakeMicros = (now / kMicrosPerTick + (xTimeIncrement - elapsed)) * kMicrosPerTick;
+    delayMicroseconds(static_cast<unsigned long>(wakeMicros - now));
+    return pdTRUE;
+}
@@ -35,6 +35,7 @@ constexpr TickType_t portMAX_DELAY = 0xffff;
 #define configTICK_RATE_HZ			(1000)
 #define portTICK_PERIOD_MS			((TickType_t)1000 / configTICK_RATE_HZ)
 #define pdMS_TO_TICKS(xTimeInMs)    ((TickType_t)(((TickType_t)(xTimeInMs)*(TickType_t)configTICK_RATE_HZ)/(TickType_t)1000U))
+#define pdTICKS_TO_MS(xTicks)       ((TickType_t)((uint64_t)(xTicks) * 1000 / configTICK_RATE_HZ))
 
 QueueHandle_t xQueueCreate(UBaseType_t uxQueueLength, UBaseType_t uxItemSize);
 
@@ -63,11 +64,43 @@ BaseType_t xTaskCreatePinnedToCore(
 
 TaskHandle_t xTaskGetCurrentTaskHandle();
 
+/**
+ * \brief The core the calling task runs on (from freertos/portmacro.h). 0 unless set via testSetCurrentTask
+ */
+BaseType_t xPortGetCoreID();
+
+// The tick count is derived from the mock clock (esp_timer_get_time), so it follows testSetRealTime and delay()
+
+TickType_t xTaskGetTickCount();
+TickType_t xTaskGetTickCountFromISR();
+
+void vTaskDelay(TickType_t xTicksToDelay);
+
+/**
+ * \brief Delay until a fixed number of ticks after the previous wake time, so periodic tasks don't drift
+ * \param pxPreviousWakeTime the previous wake time, updated to the new wake time
+ * \param xTimeIncrement the period in ticks
+ * \return pdTRUE if the task was delayed, pdFALSE if the wake time had already passed
+ */
+BaseType_t xTaskDelayUntil(TickType_t* pxPreviousWakeTime, TickType_t xTimeIncrement);
+
+inline void vTaskDelayUntil(TickType_t* pxPreviousWakeTime, const TickType_t xTimeIncrement) {
+    (void)xTaskDelayUntil(pxPreviousWakeTime, xTimeIncrement);
+}
+
 void vTaskNotifyGiveFromISR(TaskHandle_t xTaskToNotify, BaseType_t* pxHigherPriorityTaskWoken);
 uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait);
 
 // testing only, does not exist in FreeRTOS
 void testUxQueueReset();
+
+/**
+ * \brief Testing: set the task handle and core that xTaskGetCurrentTaskHandle and xPortGetCoreID return for the
+ * calling thread, so threads standing in for tasks can be told apart
+ * \param handle the task handle, nullptr for the default handle
+ * \param coreId the core the task runs on
+ */
+void testSetCurrentTask(TaskHandle_t handle, BaseType_t coreId = 0);
 constexpr short kMaxQueues = 7;
 
 #endif